@@ -1,6 +1,6 @@
 ﻿#pragma once
 
-#include "Sprite.h"
+#include "TextRenderer.h"
 #include <Windows.h>
 #include <string>
 
@@ -9,8 +9,7 @@
 /// </summary>
 class DebugText {
 public:
-  // デバッグテキスト用のテクスチャ番号を指定
-  static const int kMaxCharCount = 256; // 最大文字数
+  // デバッグテキスト用のフォント画像の設定
   static const int kFontWidth = 9;      // フォント画像内1文字分の横幅
   static const int kFontHeight = 18;    // フォント画像内1文字分の縦幅
   static const int kFontLineCount = 14; // フォント画像内1行分の文字数
@@ -20,14 +19,24 @@ public:
 
   void Initialize();
 
-  void Print(const std::string& text, float x, float y, float size);
+  void Print(const std::string& text, float x, float y, float size = 1.0f);
 
+  /// <summary>
+  /// まとめて描画（Sprite::PreDraw～PostDrawの間で呼べば、後に続くSprite::Drawもそのまま描ける）
+  /// </summary>
+  /// <param name="cmdList">コマンドリスト</param>
   void DrawAll(ID3D12GraphicsCommandList* cmdList);
 
+  /// <summary>
+  /// 文字列描画の取得（フォントを追加して使う場合など）
+  /// </summary>
+  /// <returns>文字列描画</returns>
+  TextRenderer* GetTextRenderer() { return &textRenderer_; }
+
 private:
   uint32_t textureHandle_ = 0;
-  // スプライトデータの配列
-  Sprite* spriteDatas_[kMaxCharCount] = {};
-  // スプライトデータ配列の添え字番号
-  int spriteIndex_ = 0;
+  // 文字列描画
+  TextRenderer textRenderer_;
+  // デバッグフォントのフォント番号
+  uint32_t fontIndex_ = 0;
 };
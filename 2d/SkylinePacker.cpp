@@ -0,0 +1,110 @@
+﻿#include "SkylinePacker.h"
+#include <algorithm>
+#include <limits>
+
+void SkylinePacker::Initialize(uint32_t width, uint32_t height) {
+  width_ = width;
+  height_ = height;
+  usedArea_ = 0;
+
+  // 最初は幅いっぱいの高さ0の区間だけ
+  skyline_.clear();
+  skyline_.push_back({0, 0, width});
+}
+
+bool SkylinePacker::Insert(uint32_t width, uint32_t height, Rect& rect) {
+  if (width == 0 || height == 0) {
+	return false;
+  }
+
+  // 全区間を左端の候補として、最も低く置ける位置を探す
+  size_t bestIndex = skyline_.size();
+  uint32_t bestBottom = (std::numeric_limits<uint32_t>::max)();
+  uint64_t bestWastedArea = (std::numeric_limits<uint64_t>::max)();
+  for (size_t i = 0; i < skyline_.size(); i++) {
+	uint32_t y = 0;
+	uint64_t wastedArea = 0;
+	if (!Fit(i, width, height, y, wastedArea)) {
+	  continue;
+	}
+
+	uint32_t bottom = y + height;
+	if (bottom < bestBottom || (bottom == bestBottom && wastedArea < bestWastedArea)) {
+	  bestIndex = i;
+	  bestBottom = bottom;
+	  bestWastedArea = wastedArea;
+	  rect = {skyline_[i].x, y, width, height};
+	}
+  }
+
+  if (bestIndex == skyline_.size()) {
+	return false;
+  }
+
+  AddSkylineLevel(bestIndex, rect);
+  usedArea_ += static_cast<uint64_t>(width) * height;
+  return true;
+}
+
+float SkylinePacker::GetOccupancy() const {
+  uint64_t area = static_cast<uint64_t>(width_) * height_;
+  return area == 0 ? 0.0f : static_cast<float>(usedArea_) / area;
+}
+
+bool SkylinePacker::Fit(
+  size_t nodeIndex, uint32_t width, uint32_t height, uint32_t& y, uint64_t& wastedArea) const {
+  uint32_t x = skyline_[nodeIndex].x;
+  if (x + width > width_) {
+	return false;
+  }
+
+  // 矩形の幅にかかる区間のうち最も高いところに載せる
+  y = 0;
+  uint32_t remaining = width;
+  for (size_t i = nodeIndex; remaining > 0; i++) {
+	y = (std::max)(y, skyline_[i].y);
+	remaining -= (std::min)(remaining, skyline_[i].width);
+  }
+  if (y + height > height_) {
+	return false;
+  }
+
+  // 載せた矩形の下にできる隙間
+  wastedArea = 0;
+  remaining = width;
+  for (size_t i = nodeIndex; remaining > 0; i++) {
+	uint32_t spanWidth = (std::min)(remaining, skyline_[i].width);
+	wastedArea += static_cast<uint64_t>(y - skyline_[i].y) * spanWidth;
+	remaining -= spanWidth;
+  }
+  return true;
+}
+
+void SkylinePacker::AddSkylineLevel(size_t nodeIndex, const Rect& rect) {
+  // 矩形の上端を新しい区間として挿入
+  skyline_.insert(skyline_.begin() + nodeIndex, {rect.x, rect.y + rect.height, rect.width});
+
+  // 矩形に隠れた区間を削るか縮める
+  uint32_t right = rect.x + rect.width;
+  size_t i = nodeIndex + 1;
+  while (i < skyline_.size() && skyline_[i].x < right) {
+	uint32_t nodeRight = skyline_[i].x + skyline_[i].width;
+	if (nodeRight <= right) {
+	  skyline_.erase(skyline_.begin() + i);
+	} else {
+	  skyline_[i].width = nodeRight - right;
+	  skyline_[i].x = right;
+	  break;
+	}
+  }
+
+  // 同じ高さで隣り合う区間をまとめる
+  for (size_t j = 0; j + 1 < skyline_.size();) {
+	if (skyline_[j].y == skyline_[j + 1].y) {
+	  skyline_[j].width += skyline_[j + 1].width;
+	  skyline_.erase(skyline_.begin() + j + 1);
+	} else {
+	  j++;
+	}
+  }
+}
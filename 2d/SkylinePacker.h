@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// スカイライン法による矩形の詰め込み
+/// 置いた矩形の上端を左から右への折れ線（スカイライン）として持ち、
+/// 新しい矩形は最も低く置ける位置（同じ高さなら無駄な隙間が少ない位置）に置く
+/// GPUに触れないので単体で動作確認・計測できる
+/// </summary>
+class SkylinePacker {
+public:
+  /// <summary>
+  /// 矩形
+  /// </summary>
+  struct Rect {
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+  };
+
+  /// <summary>
+  /// 初期化（空にする）
+  /// </summary>
+  /// <param name="width">詰め込み先の幅</param>
+  /// <param name="height">詰め込み先の高さ</param>
+  void Initialize(uint32_t width, uint32_t height);
+
+  /// <summary>
+  /// 矩形の配置
+  /// </summary>
+  /// <param name="width">幅</param>
+  /// <param name="height">高さ</param>
+  /// <param name="rect">配置した矩形</param>
+  /// <returns>置ける場所が無ければfalse</returns>
+  bool Insert(uint32_t width, uint32_t height, Rect& rect);
+
+  /// <summary>
+  /// 使用率の取得
+  /// </summary>
+  /// <returns>配置した矩形の面積の合計 / 詰め込み先の面積</returns>
+  float GetOccupancy() const;
+
+  uint32_t GetWidth() const { return width_; }
+  uint32_t GetHeight() const { return height_; }
+
+private:
+  /// <summary>
+  /// スカイラインの1区間
+  /// </summary>
+  struct Node {
+	// 左端
+	uint32_t x;
+	// 高さ
+	uint32_t y;
+	// 幅
+	uint32_t width;
+  };
+
+  /// <summary>
+  /// 指定した区間から右に矩形を置いたときの下端を求める
+  /// </summary>
+  /// <param name="nodeIndex">左端の区間番号</param>
+  /// <param name="width">幅</param>
+  /// <param name="height">高さ</param>
+  /// <param name="y">下端</param>
+  /// <param name="wastedArea">矩形の下にできる隙間の面積</param>
+  /// <returns>置けなければfalse</returns>
+  bool Fit(
+    size_t nodeIndex, uint32_t width, uint32_t height, uint32_t& y, uint64_t& wastedArea) const;
+
+  /// <summary>
+  /// 配置した矩形でスカイラインを更新する
+  /// </summary>
+  /// <param name="nodeIndex">左端の区間番号</param>
+  /// <param name="rect">配置した矩形</param>
+  void AddSkylineLevel(size_t nodeIndex, const Rect& rect);
+
+  // 詰め込み先の幅
+  uint32_t width_ = 0;
+  // 詰め込み先の高さ
+  uint32_t height_ = 0;
+  // 配置した矩形の面積の合計
+  uint64_t usedArea_ = 0;
+  // スカイライン（左から順）
+  std::vector<Node> skyline_;
+};
@@ -1,6 +1,8 @@
 ﻿#include "Sprite.h"
 #include "TextureManager.h"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <d3dcompiler.h>
 #include <d3dx12.h>
 
@@ -12,6 +14,7 @@ using namespace Microsoft::WRL;
 /// <summary>
 /// 静的メンバ変数の実体
 /// </summary>
+DirectXCommon* Sprite::sDxCommon = nullptr;
 ID3D12Device* Sprite::sDevice = nullptr;
 UINT Sprite::sDescriptorHandleIncrementSize;
 ID3D12GraphicsCommandList* Sprite::sCommandList = nullptr;
@@ -19,11 +22,12 @@ ComPtr<ID3D12RootSignature> Sprite::sRootSignature;
 ComPtr<ID3D12PipelineState> Sprite::sPipelineState;
 XMMATRIX Sprite::sMatProjection;
 
-void Sprite::StaticInitialize(ID3D12Device* device, int window_width, int window_height) {
+void Sprite::StaticInitialize(DirectXCommon* dxCommon, int window_width, int window_height) {
   // nullptrチェック
-  assert(device);
+  assert(dxCommon);
 
-  sDevice = device;
+  sDxCommon = dxCommon;
+  sDevice = dxCommon->GetDevice();
 
   // デスクリプタサイズを取得
   sDescriptorHandleIncrementSize =
@@ -179,6 +183,19 @@ void Sprite::PreDraw(ID3D12GraphicsCommandList* commandList) {
   // コマンドリストをセット
   sCommandList = commandList;
 
+  RestorePipeline();
+}
+
+void Sprite::PostDraw() {
+  // コマンドリストを解除
+  Sprite::sCommandList = nullptr;
+}
+
+void Sprite::RestorePipeline() {
+  if (!sCommandList) {
+	return;
+  }
+
   // パイプラインステートの設定
   sCommandList->SetPipelineState(sPipelineState.Get());
   // ルートシグネチャの設定
@@ -187,11 +204,6 @@ void Sprite::PreDraw(ID3D12GraphicsCommandList* commandList) {
   sCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
 }
 
-void Sprite::PostDraw() {
-  // コマンドリストを解除
-  Sprite::sCommandList = nullptr;
-}
-
 Sprite* Sprite::Create(
   uint32_t textureHandle, XMFLOAT2 position, XMFLOAT4 color, XMFLOAT2 anchorpoint, bool isFlipX,
   bool isFlipY) {
@@ -219,6 +231,10 @@ Sprite* Sprite::Create(
 	return nullptr;
   }
 
+  // 読み込み中なら代わりのテクスチャの大きさなので、読み込み完了後に合わせ直す
+  sprite->isSizeFromTexture_ = sprite->isTextureLoading_;
+  sprite->isTexRectFromTexture_ = sprite->isTextureLoading_;
+
   return sprite;
 }
 
@@ -242,136 +258,137 @@ bool Sprite::Initialize() {
   // nullptrチェック
   assert(sDevice);
 
-  HRESULT result = S_FALSE;
-
-  resourceDesc_ = TextureManager::GetInstance()->GetResoureDesc(textureHandle_);
-
-  {
-	// ヒーププロパティ
-	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	// リソース設定
-	CD3DX12_RESOURCE_DESC resourceDesc =
-	  CD3DX12_RESOURCE_DESC::Buffer(sizeof(VertexPosUv) * kVertNum);
-
-	// 頂点バッファ生成
-	result = sDevice->CreateCommittedResource(
-	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-	  IID_PPV_ARGS(&vertBuff_));
-	assert(SUCCEEDED(result));
-
-	// 頂点バッファマッピング
-	result = vertBuff_->Map(0, nullptr, (void**)&vertMap);
-	assert(SUCCEEDED(result));
-  }
-
-  // 頂点バッファへのデータ転送
-  TransferVertices();
-
-  // 頂点バッファビューの作成
-  vbView_.BufferLocation = vertBuff_->GetGPUVirtualAddress();
-  vbView_.SizeInBytes = sizeof(VertexPosUv) * 4;
-  vbView_.StrideInBytes = sizeof(VertexPosUv);
-
-  {
-	// ヒーププロパティ
-	CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-	// リソース設定
-	CD3DX12_RESOURCE_DESC resourceDesc =
-	  CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferData) + 0xff) & ~0xff);
-
-	// 定数バッファの生成
-	result = sDevice->CreateCommittedResource(
-	  &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-	  IID_PPV_ARGS(&constBuff_));
-	assert(SUCCEEDED(result));
-  }
+  TextureManager* textureManager = TextureManager::GetInstance();
+  resourceDesc_ = textureManager->GetResoureDesc(textureHandle_);
+  isTextureLoading_ = !textureManager->IsLoaded(textureHandle_);
 
-  // 定数バッファマッピング
-  result = constBuff_->Map(0, nullptr, (void**)&constMap);
-  assert(SUCCEEDED(result));
+  // 頂点データと行列は最初の描画時に計算する
+  dirtyFlags_ = kDirtyVertices | kDirtyMatrix;
 
   return true;
 }
 
 void Sprite::SetTextureHandle(uint32_t textureHandle) {
   textureHandle_ = textureHandle;
-  resourceDesc_ = TextureManager::GetInstance()->GetResoureDesc(textureHandle_);
+  TextureManager* textureManager = TextureManager::GetInstance();
+  resourceDesc_ = textureManager->GetResoureDesc(textureHandle_);
+  isTextureLoading_ = !textureManager->IsLoaded(textureHandle_);
+
+  // サイズは生成時のテクスチャに合わせたものなので以後は合わせ直さない
+  isSizeFromTexture_ = false;
+  isTexRectFromTexture_ = false;
+
+  // uvがテクスチャサイズで変わるので頂点データを再計算させる
+  dirtyFlags_ |= kDirtyVertices;
 }
 
 void Sprite::SetRotation(float rotation) {
   rotation_ = rotation;
 
-  // 頂点バッファへのデータ転送
-  TransferVertices();
+  // 描画時に行列を再計算させる
+  dirtyFlags_ |= kDirtyMatrix;
 }
 
 void Sprite::SetPosition(const DirectX::XMFLOAT2& position) {
   position_ = position;
 
-  // 頂点バッファへのデータ転送
-  TransferVertices();
+  // 描画時に行列を再計算させる
+  dirtyFlags_ |= kDirtyMatrix;
 }
 
 void Sprite::SetSize(const DirectX::XMFLOAT2& size) {
   size_ = size;
+  isSizeFromTexture_ = false;
 
-  // 頂点バッファへのデータ転送
-  TransferVertices();
+  // 描画時に頂点データを再計算させる
+  dirtyFlags_ |= kDirtyVertices;
 }
 
 void Sprite::SetAnchorPoint(const DirectX::XMFLOAT2& anchorpoint) {
   anchorPoint_ = anchorpoint;
 
-  // 頂点バッファへのデータ転送
-  TransferVertices();
+  // 描画時に頂点データを再計算させる
+  dirtyFlags_ |= kDirtyVertices;
 }
 
 void Sprite::SetIsFlipX(bool isFlipX) {
   isFlipX_ = isFlipX;
 
-  // 頂点バッファへのデータ転送
-  TransferVertices();
+  // 描画時に頂点データを再計算させる
+  dirtyFlags_ |= kDirtyVertices;
 }
 
 void Sprite::SetIsFlipY(bool isFlipY) {
   isFlipY_ = isFlipY;
 
-  // 頂点バッファへのデータ転送
-  TransferVertices();
+  // 描画時に頂点データを再計算させる
+  dirtyFlags_ |= kDirtyVertices;
 }
 
 void Sprite::SetTextureRect(const DirectX::XMFLOAT2& texBase, const DirectX::XMFLOAT2& texSize) {
   texBase_ = texBase;
   texSize_ = texSize;
+  isTexRectFromTexture_ = false;
 
-  // 頂点バッファへのデータ転送
-  TransferVertices();
+  // 描画時に頂点データを再計算させる
+  dirtyFlags_ |= kDirtyVertices;
 }
 
 void Sprite::Draw() {
-  // ワールド行列の更新
-  matWorld_ = XMMatrixIdentity();
-  matWorld_ *= XMMatrixRotationZ(rotation_);
-  matWorld_ *= XMMatrixTranslation(position_.x, position_.y, 0.0f);
+  // 読み込み中だったテクスチャが読み込み完了していたらリソース設定を取り直す
+  if (isTextureLoading_) {
+	RefreshResourceDesc();
+  }
+
+  // 変更があったものだけ再計算
+  if (dirtyFlags_ & kDirtyVertices) {
+	TransferVertices();
+  }
+  if (dirtyFlags_ & kDirtyMatrix) {
+	// ワールド行列の更新
+	matWorld_ = XMMatrixIdentity();
+	matWorld_ *= XMMatrixRotationZ(rotation_);
+	matWorld_ *= XMMatrixTranslation(position_.x, position_.y, 0.0f);
+  }
+  dirtyFlags_ = 0;
 
-  // 定数バッファにデータ転送
+  // 定数バッファを一時アップロード領域に確保してデータ転送
+  DirectXCommon::TransientAllocation constBuffer =
+    sDxCommon->AllocateTransient(sizeof(ConstBufferData));
+  ConstBufferData* constMap = static_cast<ConstBufferData*>(constBuffer.cpuAddress);
   constMap->color = color_;
   constMap->mat = matWorld_ * sMatProjection; // 行列の合成
 
+  // 頂点バッファを一時アップロード領域に確保してデータ転送
+  DirectXCommon::TransientAllocation vertBuffer =
+    sDxCommon->AllocateTransient(sizeof(vertices_), alignof(VertexPosUv));
+  memcpy(vertBuffer.cpuAddress, vertices_, sizeof(vertices_));
+
+  // 頂点バッファビューの作成
+  D3D12_VERTEX_BUFFER_VIEW vbView{};
+  vbView.BufferLocation = vertBuffer.gpuAddress;
+  vbView.SizeInBytes = sizeof(vertices_);
+  vbView.StrideInBytes = sizeof(VertexPosUv);
+
   // 頂点バッファの設定
-  sCommandList->IASetVertexBuffers(0, 1, &vbView_);
+  sCommandList->IASetVertexBuffers(0, 1, &vbView);
 
   // 定数バッファビューをセット
-  sCommandList->SetGraphicsRootConstantBufferView(0, constBuff_->GetGPUVirtualAddress());
+  sCommandList->SetGraphicsRootConstantBufferView(0, constBuffer.gpuAddress);
   // シェーダリソースビューをセット
-  TextureManager::GetInstance()->SetGraphicsRootDescriptorTable(sCommandList, 1, textureHandle_);
+  TextureManager* textureManager = TextureManager::GetInstance();
+  textureManager->SetGraphicsRootDescriptorTable(sCommandList, 1, textureHandle_);
+  // 切り出し範囲を拡大縮小した比率から、テクスチャ全体が画面上に描かれる大きさを報告する
+  if (texSize_.x > 0.0f && texSize_.y > 0.0f) {
+	float screenWidth = std::fabs(size_.x) * resourceDesc_.Width / texSize_.x;
+	float screenHeight = std::fabs(size_.y) * resourceDesc_.Height / texSize_.y;
+	textureManager->ReportUsage(textureHandle_, (std::max)(screenWidth, screenHeight));
+  }
   // 描画コマンド
   sCommandList->DrawInstanced(4, 1, 0, 0);
 }
 
 void Sprite::TransferVertices() {
-  HRESULT result = S_FALSE;
-
   // 左下、左上、右下、右上
   enum { LB, LT, RB, RT };
 
@@ -390,7 +407,7 @@ void Sprite::TransferVertices() {
   }
 
   // 頂点データ
-  VertexPosUv vertices[kVertNum];
+  VertexPosUv* vertices = vertices_;
 
   vertices[LB].pos = {left, bottom, 0.0f};  // 左下
   vertices[LT].pos = {left, top, 0.0f};     // 左上
@@ -409,7 +426,32 @@ void Sprite::TransferVertices() {
 	vertices[RB].uv = {tex_right, tex_bottom}; // 右下
 	vertices[RT].uv = {tex_right, tex_top};    // 右上
   }
+}
+
+void Sprite::RefreshResourceDesc() {
+  TextureManager* textureManager = TextureManager::GetInstance();
+  // 読み込みに失敗したら代わりのテクスチャのまま待つのをやめる
+  if (textureManager->IsFailed(textureHandle_)) {
+	isTextureLoading_ = false;
+	return;
+  }
+  if (!textureManager->IsLoaded(textureHandle_)) {
+	return;
+  }
+  isTextureLoading_ = false;
+  resourceDesc_ = textureManager->GetResoureDesc(textureHandle_);
+
+  // 代わりのテクスチャの大きさから決めていたものは本来の大きさに合わせる
+  XMFLOAT2 textureSize = {(float)resourceDesc_.Width, (float)resourceDesc_.Height};
+  if (isSizeFromTexture_) {
+	size_ = textureSize;
+	isSizeFromTexture_ = false;
+  }
+  if (isTexRectFromTexture_) {
+	texSize_ = textureSize;
+	isTexRectFromTexture_ = false;
+  }
 
-  // 頂点バッファへのデータ転送
-  memcpy(vertMap, vertices, sizeof(vertices));
+  // uvがテクスチャサイズで変わるので頂点データを再計算させる
+  dirtyFlags_ |= kDirtyVertices;
 }
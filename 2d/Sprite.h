@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include "DirectXCommon.h"
 #include <DirectXMath.h>
 #include <Windows.h>
 #include <d3d12.h>
@@ -30,10 +31,10 @@ public: // 静的メンバ関数
   /// <summary>
   /// 静的初期化
   /// </summary>
-  /// <param name="device">デバイス</param>
+  /// <param name="dxCommon">DirectX汎用（一時アップロード領域の確保に使用）</param>
   /// <param name="window_width">画面幅</param>
   /// <param name="window_height">画面高さ</param>
-  static void StaticInitialize(ID3D12Device* device, int window_width, int window_height);
+  static void StaticInitialize(DirectXCommon* dxCommon, int window_width, int window_height);
 
   /// <summary>
   /// 描画前処理
@@ -46,6 +47,12 @@ public: // 静的メンバ関数
   /// </summary>
   static void PostDraw();
 
+  /// <summary>
+  /// スプライト用のパイプラインを設定し直す（描画前処理～描画後処理の間でSpriteBatchなど
+  /// 別のパイプラインを使った後に呼ぶ。描画前処理の外では何もしない）
+  /// </summary>
+  static void RestorePipeline();
+
   /// <summary>
   /// スプライト生成
   /// </summary>
@@ -60,9 +67,20 @@ public: // 静的メンバ関数
     uint32_t textureHandle, DirectX::XMFLOAT2 position, DirectX::XMFLOAT4 color = {1, 1, 1, 1},
     DirectX::XMFLOAT2 anchorpoint = {0.0f, 0.0f}, bool isFlipX = false, bool isFlipY = false);
 
+private: // 列挙子
+  /// <summary>
+  /// 描画時に再計算が必要なもの
+  /// </summary>
+  enum DirtyFlag : uint32_t {
+	kDirtyVertices = 1 << 0, // 頂点データ（サイズ、アンカーポイント、反転、テクスチャ範囲）
+	kDirtyMatrix = 1 << 1,   // ワールド行列（座標、回転角）
+  };
+
 private: // 静的メンバ変数
   // 頂点数
   static const int kVertNum = 4;
+  // DirectX汎用
+  static DirectXCommon* sDxCommon;
   // デバイス
   static ID3D12Device* sDevice;
   // デスクリプタサイズ
@@ -171,16 +189,8 @@ public: // メンバ関数
   void Draw();
 
 private: // メンバ変数
-  // 頂点バッファ
-  Microsoft::WRL::ComPtr<ID3D12Resource> vertBuff_;
-  // 定数バッファ
-  Microsoft::WRL::ComPtr<ID3D12Resource> constBuff_;
-  // 頂点バッファマップ
-  VertexPosUv* vertMap = nullptr;
-  // 定数バッファマップ
-  ConstBufferData* constMap = nullptr;
-  // 頂点バッファビュー
-  D3D12_VERTEX_BUFFER_VIEW vbView_{};
+  // 頂点データ（描画時に一時アップロード領域へ転送する）
+  VertexPosUv vertices_[kVertNum] = {};
   // テクスチャ番号
   UINT textureHandle_ = 0;
   // Z軸回りの回転角
@@ -205,10 +215,23 @@ private: // メンバ変数
   DirectX::XMFLOAT2 texSize_ = {100.0f, 100.0f};
   // リソース設定
   D3D12_RESOURCE_DESC resourceDesc_;
+  // 描画時に再計算が必要なもの（DirtyFlagの組み合わせ）
+  uint32_t dirtyFlags_ = kDirtyVertices | kDirtyMatrix;
+  // テクスチャが読み込み中か（読み込み完了後にリソース設定を取り直す）
+  bool isTextureLoading_ = false;
+  // サイズを読み込み中のテクスチャの大きさから決めたか
+  bool isSizeFromTexture_ = false;
+  // テクスチャ範囲を読み込み中のテクスチャの大きさから決めたか
+  bool isTexRectFromTexture_ = false;
 
 private: // メンバ関数
   /// <summary>
-  /// 頂点データ転送
+  /// 頂点データ計算
   /// </summary>
   void TransferVertices();
+
+  /// <summary>
+  /// 読み込みが完了していたらリソース設定を取り直す
+  /// </summary>
+  void RefreshResourceDesc();
 };
@@ -0,0 +1,348 @@
+﻿#include "SpriteBatch.h"
+#include "TextureManager.h"
+#include <algorithm>
+#include <cassert>
+#include <d3dcompiler.h>
+#include <d3dx12.h>
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+using namespace DirectX;
+using namespace Microsoft::WRL;
+
+/// <summary>
+/// 静的メンバ変数の実体
+/// </summary>
+DirectXCommon* SpriteBatch::sDxCommon = nullptr;
+ID3D12Device* SpriteBatch::sDevice = nullptr;
+ComPtr<ID3D12RootSignature> SpriteBatch::sRootSignature;
+ComPtr<ID3D12PipelineState> SpriteBatch::sPipelineState;
+XMMATRIX SpriteBatch::sMatProjection;
+
+void SpriteBatch::StaticInitialize(DirectXCommon* dxCommon, int window_width, int window_height) {
+  // nullptrチェック
+  assert(dxCommon);
+
+  sDxCommon = dxCommon;
+  sDevice = dxCommon->GetDevice();
+
+  HRESULT result = S_FALSE;
+  ComPtr<ID3DBlob> vsBlob;    // 頂点シェーダオブジェクト
+  ComPtr<ID3DBlob> psBlob;    // ピクセルシェーダオブジェクト
+  ComPtr<ID3DBlob> errorBlob; // エラーオブジェクト
+
+  // 頂点シェーダの読み込みとコンパイル
+  result = D3DCompileFromFile(
+    L"Resources/shaders/SpriteBatchVS.hlsl", // シェーダファイル名
+    nullptr,
+    D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
+    "main", "vs_5_0", // エントリーポイント名、シェーダーモデル指定
+    D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // デバッグ用設定
+    0, &vsBlob, &errorBlob);
+  if (FAILED(result)) {
+	// errorBlobからエラー内容をstring型にコピー
+	std::string errstr;
+	errstr.resize(errorBlob->GetBufferSize());
+
+	std::copy_n((char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize(), errstr.begin());
+	errstr += "\n";
+	// エラー内容を出力ウィンドウに表示
+	OutputDebugStringA(errstr.c_str());
+	exit(1);
+  }
+
+  // ピクセルシェーダの読み込みとコンパイル
+  result = D3DCompileFromFile(
+    L"Resources/shaders/SpriteBatchPS.hlsl", // シェーダファイル名
+    nullptr,
+    D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
+    "main", "ps_5_0", // エントリーポイント名、シェーダーモデル指定
+    D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // デバッグ用設定
+    0, &psBlob, &errorBlob);
+  if (FAILED(result)) {
+	// errorBlobからエラー内容をstring型にコピー
+	std::string errstr;
+	errstr.resize(errorBlob->GetBufferSize());
+
+	std::copy_n((char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize(), errstr.begin());
+	errstr += "\n";
+	// エラー内容を出力ウィンドウに表示
+	OutputDebugStringA(errstr.c_str());
+	exit(1);
+  }
+
+  // 頂点レイアウト
+  D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
+    {// xy座標(1行で書いたほうが見やすい)
+     "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+     D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+    {// uv座標(1行で書いたほうが見やすい)
+     "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+     D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+    {// 色(1行で書いたほうが見やすい)
+     "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
+     D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+  };
+
+  // グラフィックスパイプラインの流れを設定
+  D3D12_GRAPHICS_PIPELINE_STATE_DESC gpipeline{};
+  gpipeline.VS = CD3DX12_SHADER_BYTECODE(vsBlob.Get());
+  gpipeline.PS = CD3DX12_SHADER_BYTECODE(psBlob.Get());
+
+  // サンプルマスク
+  gpipeline.SampleMask = D3D12_DEFAULT_SAMPLE_MASK; // 標準設定
+  // ラスタライザステート
+  gpipeline.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+  gpipeline.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+  // デプスステンシルステート
+  gpipeline.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+  gpipeline.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS; // 常に上書きルール
+
+  // レンダーターゲットのブレンド設定
+  D3D12_RENDER_TARGET_BLEND_DESC blenddesc{};
+  blenddesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL; // RBGA全てのチャンネルを描画
+  blenddesc.BlendEnable = true;
+  blenddesc.BlendOp = D3D12_BLEND_OP_ADD;
+  blenddesc.SrcBlend = D3D12_BLEND_SRC_ALPHA;
+  blenddesc.DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+
+  blenddesc.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+  blenddesc.SrcBlendAlpha = D3D12_BLEND_ONE;
+  blenddesc.DestBlendAlpha = D3D12_BLEND_ZERO;
+
+  // ブレンドステートの設定
+  gpipeline.BlendState.RenderTarget[0] = blenddesc;
+
+  // 深度バッファのフォーマット
+  gpipeline.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+
+  // 頂点レイアウトの設定
+  gpipeline.InputLayout.pInputElementDescs = inputLayout;
+  gpipeline.InputLayout.NumElements = _countof(inputLayout);
+
+  // 図形の形状設定（三角形）
+  gpipeline.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+
+  gpipeline.NumRenderTargets = 1;                            // 描画対象は1つ
+  gpipeline.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; // 0～255指定のRGBA
+  gpipeline.SampleDesc.Count = 1; // 1ピクセルにつき1回サンプリング
+
+  // デスクリプタレンジ
+  CD3DX12_DESCRIPTOR_RANGE descRangeSRV;
+  descRangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0); // t0 レジスタ
+
+  // ルートパラメータ
+  CD3DX12_ROOT_PARAMETER rootparams[2] = {};
+  rootparams[0].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
+  rootparams[1].InitAsDescriptorTable(1, &descRangeSRV, D3D12_SHADER_VISIBILITY_ALL);
+
+  // スタティックサンプラー
+  CD3DX12_STATIC_SAMPLER_DESC samplerDesc =
+    CD3DX12_STATIC_SAMPLER_DESC(0, D3D12_FILTER_MIN_MAG_MIP_LINEAR); // s0 レジスタ
+  samplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+  samplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+  samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+
+  // ルートシグネチャの設定
+  CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
+  rootSignatureDesc.Init_1_0(
+    _countof(rootparams), rootparams, 1, &samplerDesc,
+    D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+
+  ComPtr<ID3DBlob> rootSigBlob;
+  // バージョン自動判定のシリアライズ
+  result = D3DX12SerializeVersionedRootSignature(
+    &rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1_0, &rootSigBlob, &errorBlob);
+  assert(SUCCEEDED(result));
+  // ルートシグネチャの生成
+  result = sDevice->CreateRootSignature(
+    0, rootSigBlob->GetBufferPointer(), rootSigBlob->GetBufferSize(),
+    IID_PPV_ARGS(&sRootSignature));
+  assert(SUCCEEDED(result));
+
+  gpipeline.pRootSignature = sRootSignature.Get();
+
+  // グラフィックスパイプラインの生成
+  result = sDevice->CreateGraphicsPipelineState(&gpipeline, IID_PPV_ARGS(&sPipelineState));
+  assert(SUCCEEDED(result));
+
+  // 射影行列計算
+  sMatProjection = XMMatrixOrthographicOffCenterLH(
+    0.0f, (float)window_width, (float)window_height, 0.0f, 0.0f, 1.0f);
+}
+
+void SpriteBatch::Begin(ID3D12GraphicsCommandList* commandList, SortMode sortMode) {
+  // BeginとEndがペアで呼ばれていなければエラー
+  assert(commandList_ == nullptr);
+  assert(commandList);
+
+  commandList_ = commandList;
+  sortMode_ = sortMode;
+  queue_.clear();
+}
+
+void SpriteBatch::Draw(const Quad& quad) {
+  // Beginが呼ばれていなければエラー
+  assert(commandList_);
+
+  // uv計算用にテクスチャのサイズを控えておく
+  const D3D12_RESOURCE_DESC& resDesc =
+    TextureManager::GetInstance()->GetResoureDesc(quad.textureHandle);
+
+  QueuedQuad queued;
+  queued.quad = quad;
+  queued.textureSize = {(float)resDesc.Width, (float)resDesc.Height};
+  queue_.push_back(queued);
+}
+
+void SpriteBatch::End() {
+  // Beginが呼ばれていなければエラー
+  assert(commandList_);
+
+  drawCallCount_ = 0;
+
+  if (!queue_.empty()) {
+	// 描画順を決める
+	Sort();
+
+	// 頂点とインデックスを一時アップロード領域に生成
+	size_t quadCount = queue_.size();
+	DirectXCommon::TransientAllocation vertBuffer = sDxCommon->AllocateTransient(
+	  sizeof(VertexPosUvColor) * kVertNum * quadCount, alignof(VertexPosUvColor));
+	DirectXCommon::TransientAllocation indexBuffer =
+	  sDxCommon->AllocateTransient(sizeof(uint32_t) * kIndexNum * quadCount, alignof(uint32_t));
+	BuildVertices(
+	  static_cast<VertexPosUvColor*>(vertBuffer.cpuAddress),
+	  static_cast<uint32_t*>(indexBuffer.cpuAddress));
+
+	// 定数バッファを一時アップロード領域に確保してデータ転送
+	DirectXCommon::TransientAllocation constBuffer =
+	  sDxCommon->AllocateTransient(sizeof(ConstBufferData));
+	static_cast<ConstBufferData*>(constBuffer.cpuAddress)->mat = sMatProjection;
+
+	// 頂点バッファビューの作成
+	D3D12_VERTEX_BUFFER_VIEW vbView{};
+	vbView.BufferLocation = vertBuffer.gpuAddress;
+	vbView.SizeInBytes = static_cast<UINT>(sizeof(VertexPosUvColor) * kVertNum * quadCount);
+	vbView.StrideInBytes = sizeof(VertexPosUvColor);
+
+	// インデックスバッファビューの作成
+	D3D12_INDEX_BUFFER_VIEW ibView{};
+	ibView.BufferLocation = indexBuffer.gpuAddress;
+	ibView.Format = DXGI_FORMAT_R32_UINT;
+	ibView.SizeInBytes = static_cast<UINT>(sizeof(uint32_t) * kIndexNum * quadCount);
+
+	// パイプラインステートの設定
+	commandList_->SetPipelineState(sPipelineState.Get());
+	// ルートシグネチャの設定
+	commandList_->SetGraphicsRootSignature(sRootSignature.Get());
+	// プリミティブ形状を設定
+	commandList_->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	// 頂点バッファとインデックスバッファの設定
+	commandList_->IASetVertexBuffers(0, 1, &vbView);
+	commandList_->IASetIndexBuffer(&ibView);
+	// 定数バッファビューをセット
+	commandList_->SetGraphicsRootConstantBufferView(0, constBuffer.gpuAddress);
+
+	// テクスチャが同じ範囲ごとに1回描画
+	size_t runBegin = 0;
+	while (runBegin < quadCount) {
+	  uint32_t textureHandle = queue_[order_[runBegin]].quad.textureHandle;
+	  size_t runEnd = runBegin + 1;
+	  while (runEnd < quadCount && queue_[order_[runEnd]].quad.textureHandle == textureHandle) {
+		runEnd++;
+	  }
+
+	  // シェーダリソースビューをセット
+	  TextureManager::GetInstance()->SetGraphicsRootDescriptorTable(
+	    commandList_, 1, textureHandle);
+	  // 描画コマンド
+	  commandList_->DrawIndexedInstanced(
+	    static_cast<UINT>(kIndexNum * (runEnd - runBegin)), 1,
+	    static_cast<UINT>(kIndexNum * runBegin), 0, 0);
+	  drawCallCount_++;
+
+	  runBegin = runEnd;
+	}
+  }
+
+  // コマンドリストを解除
+  commandList_ = nullptr;
+  queue_.clear();
+}
+
+const std::vector<uint32_t>& SpriteBatch::Sort() {
+  order_.resize(queue_.size());
+  for (size_t i = 0; i < order_.size(); i++) {
+	order_[i] = static_cast<uint32_t>(i);
+  }
+
+  // テクスチャごとにまとめる（同じテクスチャ内は積んだ順を保つ）
+  if (sortMode_ == SortMode::kTexture) {
+	std::stable_sort(order_.begin(), order_.end(), [this](uint32_t a, uint32_t b) {
+	  return queue_[a].quad.textureHandle < queue_[b].quad.textureHandle;
+	});
+  }
+
+  return order_;
+}
+
+void SpriteBatch::BuildVertices(VertexPosUvColor* vertices, uint32_t* indices) const {
+  // 左下、左上、右下、右上
+  enum { LB, LT, RB, RT };
+
+  for (size_t i = 0; i < order_.size(); i++) {
+	const QueuedQuad& queued = queue_[order_[i]];
+	const Quad& quad = queued.quad;
+
+	float left = (0.0f - quad.anchorPoint.x) * quad.size.x;
+	float right = (1.0f - quad.anchorPoint.x) * quad.size.x;
+	float top = (0.0f - quad.anchorPoint.y) * quad.size.y;
+	float bottom = (1.0f - quad.anchorPoint.y) * quad.size.y;
+	if (quad.isFlipX) { // 左右入れ替え
+	  left = -left;
+	  right = -right;
+	}
+
+	if (quad.isFlipY) { // 上下入れ替え
+	  top = -top;
+	  bottom = -bottom;
+	}
+
+	// テクスチャ範囲（0ならテクスチャ全体）
+	XMFLOAT2 texSize = quad.texSize;
+	if (texSize.x == 0.0f && texSize.y == 0.0f) {
+	  texSize = queued.textureSize;
+	}
+	float tex_left = quad.texBase.x / queued.textureSize.x;
+	float tex_right = (quad.texBase.x + texSize.x) / queued.textureSize.x;
+	float tex_top = quad.texBase.y / queued.textureSize.y;
+	float tex_bottom = (quad.texBase.y + texSize.y) / queued.textureSize.y;
+
+	// Z軸回りの回転と平行移動（Spriteのワールド行列と同じ変換）
+	float sinValue = 0.0f;
+	float cosValue = 1.0f;
+	XMScalarSinCos(&sinValue, &cosValue, quad.rotation);
+	auto transform = [&](float x, float y) {
+	  return XMFLOAT3(
+	    x * cosValue - y * sinValue + quad.position.x,
+	    x * sinValue + y * cosValue + quad.position.y, 0.0f);
+	};
+
+	VertexPosUvColor* v = vertices + i * kVertNum;
+	v[LB] = {transform(left, bottom), {tex_left, tex_bottom}, quad.color};   // 左下
+	v[LT] = {transform(left, top), {tex_left, tex_top}, quad.color};         // 左上
+	v[RB] = {transform(right, bottom), {tex_right, tex_bottom}, quad.color}; // 右下
+	v[RT] = {transform(right, top), {tex_right, tex_top}, quad.color};       // 右上
+
+	// 三角形2枚（Spriteのトライアングルストリップと同じ順）
+	uint32_t base = static_cast<uint32_t>(i * kVertNum);
+	uint32_t* index = indices + i * kIndexNum;
+	index[0] = base + LB;
+	index[1] = base + LT;
+	index[2] = base + RB;
+	index[3] = base + RB;
+	index[4] = base + LT;
+	index[5] = base + RT;
+  }
+}
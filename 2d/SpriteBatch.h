@@ -0,0 +1,154 @@
+﻿#pragma once
+
+#include "DirectXCommon.h"
+#include <DirectXMath.h>
+#include <Windows.h>
+#include <cstdint>
+#include <d3d12.h>
+#include <vector>
+#include <wrl.h>
+
+/// <summary>
+/// スプライト一括描画
+/// Begin～Endの間に積んだ矩形を1本の頂点/インデックス列にまとめ、テクスチャが同じ範囲ごとに1回だけ描画する
+/// </summary>
+class SpriteBatch {
+public: // サブクラス
+  /// <summary>
+  /// 頂点データ構造体
+  /// </summary>
+  struct VertexPosUvColor {
+	DirectX::XMFLOAT3 pos;   // xyz座標
+	DirectX::XMFLOAT2 uv;    // uv座標
+	DirectX::XMFLOAT4 color; // 色 (RGBA)
+  };
+
+  /// <summary>
+  /// 定数バッファ用データ構造体
+  /// </summary>
+  struct ConstBufferData {
+	DirectX::XMMATRIX mat; // ３Ｄ変換行列
+  };
+
+  /// <summary>
+  /// 並べ替え方法
+  /// </summary>
+  enum class SortMode {
+	kTexture,    // テクスチャごとにまとめる（同じテクスチャ内は積んだ順）
+	kSubmission, // 積んだ順（前後関係を保つ）
+  };
+
+  /// <summary>
+  /// 1枚分の描画情報（Spriteと同じ意味を持つ）
+  /// </summary>
+  struct Quad {
+	// テクスチャハンドル
+	uint32_t textureHandle = 0;
+	// 座標
+	DirectX::XMFLOAT2 position = {0.0f, 0.0f};
+	// 幅、高さ
+	DirectX::XMFLOAT2 size = {100.0f, 100.0f};
+	// Z軸回りの回転角
+	float rotation = 0.0f;
+	// 色
+	DirectX::XMFLOAT4 color = {1, 1, 1, 1};
+	// アンカーポイント
+	DirectX::XMFLOAT2 anchorPoint = {0.0f, 0.0f};
+	// テクスチャ始点（ピクセル）
+	DirectX::XMFLOAT2 texBase = {0.0f, 0.0f};
+	// テクスチャ幅、高さ（ピクセル、0ならテクスチャ全体）
+	DirectX::XMFLOAT2 texSize = {0.0f, 0.0f};
+	// 左右反転
+	bool isFlipX = false;
+	// 上下反転
+	bool isFlipY = false;
+  };
+
+public: // 静的メンバ関数
+  /// <summary>
+  /// 静的初期化
+  /// </summary>
+  /// <param name="dxCommon">DirectX汎用（一時アップロード領域の確保に使用）</param>
+  /// <param name="window_width">画面幅</param>
+  /// <param name="window_height">画面高さ</param>
+  static void StaticInitialize(DirectXCommon* dxCommon, int window_width, int window_height);
+
+private: // 静的メンバ変数
+  // 1枚あたりの頂点数
+  static const int kVertNum = 4;
+  // 1枚あたりのインデックス数
+  static const int kIndexNum = 6;
+  // DirectX汎用
+  static DirectXCommon* sDxCommon;
+  // デバイス
+  static ID3D12Device* sDevice;
+  // ルートシグネチャ
+  static Microsoft::WRL::ComPtr<ID3D12RootSignature> sRootSignature;
+  // パイプラインステートオブジェクト
+  static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineState;
+  // 射影行列
+  static DirectX::XMMATRIX sMatProjection;
+
+public: // メンバ関数
+  /// <summary>
+  /// 描画開始
+  /// </summary>
+  /// <param name="commandList">描画コマンドリスト</param>
+  /// <param name="sortMode">並べ替え方法</param>
+  void Begin(ID3D12GraphicsCommandList* commandList, SortMode sortMode = SortMode::kTexture);
+
+  /// <summary>
+  /// 1枚積む
+  /// </summary>
+  /// <param name="quad">描画情報</param>
+  void Draw(const Quad& quad);
+
+  /// <summary>
+  /// 積んだ分をまとめて描画する
+  /// パイプラインを切り替えるので、後でSpriteを描く場合はSprite::RestorePipeline、
+  /// Modelを描く場合はModel::PreDrawから始めること
+  /// </summary>
+  void End();
+
+  /// <summary>
+  /// 直近のEndで発行した描画コマンド数の取得
+  /// </summary>
+  /// <returns>描画コマンド数</returns>
+  size_t GetDrawCallCount() const { return drawCallCount_; }
+
+  /// <summary>
+  /// 積んだ順序の並べ替え（GPUに触れない）
+  /// </summary>
+  /// <returns>並べ替え後の順序</returns>
+  const std::vector<uint32_t>& Sort();
+
+  /// <summary>
+  /// 頂点/インデックスの生成（GPUに触れない）
+  /// </summary>
+  /// <param name="vertices">頂点の書き込み先（積んだ枚数 * 4）</param>
+  /// <param name="indices">インデックスの書き込み先（積んだ枚数 * 6）</param>
+  void BuildVertices(VertexPosUvColor* vertices, uint32_t* indices) const;
+
+private: // サブクラス
+  /// <summary>
+  /// 積まれた1枚分
+  /// </summary>
+  struct QueuedQuad {
+	// 描画情報
+	Quad quad;
+	// テクスチャの幅、高さ
+	DirectX::XMFLOAT2 textureSize;
+  };
+
+private: // メンバ変数
+  // 描画コマンドリスト
+  ID3D12GraphicsCommandList* commandList_ = nullptr;
+  // 並べ替え方法
+  SortMode sortMode_ = SortMode::kTexture;
+  // 積まれた矩形
+  std::vector<QueuedQuad> queue_;
+  // 描画順（queue_の添え字）
+  std::vector<uint32_t> order_;
+  // 直近のEndで発行した描画コマンド数
+  size_t drawCallCount_ = 0;
+};
@@ -0,0 +1,114 @@
+﻿#include "TextRenderer.h"
+#include <cassert>
+#include <cstring>
+
+using namespace DirectX;
+
+void TextRenderer::Layout(
+  const Font& font, const std::string& text, float scale, std::vector<Glyph>& glyphs) {
+  assert(font.glyphsPerLine > 0);
+
+  float x = 0.0f;
+  float y = 0.0f;
+
+  // 全ての文字について
+  for (size_t i = 0; i < text.size(); i++) {
+	// 1文字取り出す(※ASCIIコードでしか成り立たない)
+	uint32_t character = static_cast<unsigned char>(text[i]);
+
+	// 改行
+	if (character == '\n') {
+	  x = 0.0f;
+	  y += font.glyphHeight * scale;
+	  continue;
+	}
+
+	// フォント画像に無い文字は先頭の文字で代用
+	uint32_t fontIndex = character - font.firstCharacter;
+	if (character < font.firstCharacter || fontIndex >= font.characterCount) {
+	  fontIndex = 0;
+	}
+
+	uint32_t fontIndexY = fontIndex / font.glyphsPerLine;
+	uint32_t fontIndexX = fontIndex % font.glyphsPerLine;
+
+	Glyph glyph;
+	glyph.offset = {x, y};
+	glyph.texBase = {fontIndexX * font.glyphWidth, fontIndexY * font.glyphHeight};
+	glyphs.push_back(glyph);
+
+	// 文字を１つ進める
+	x += font.glyphWidth * scale;
+  }
+}
+
+uint32_t TextRenderer::AddFont(const Font& font) {
+  fonts_.push_back(font);
+  return static_cast<uint32_t>(fonts_.size() - 1);
+}
+
+void TextRenderer::Print(
+  uint32_t fontIndex, const std::string& text, float x, float y, float scale,
+  const XMFLOAT4& color) {
+  assert(fontIndex < fonts_.size());
+
+  // キャッシュのキー（フォント番号と拡大率のビット列 + 文字列）
+  std::string key(sizeof(fontIndex) + sizeof(scale), '\0');
+  memcpy(&key[0], &fontIndex, sizeof(fontIndex));
+  memcpy(&key[sizeof(fontIndex)], &scale, sizeof(scale));
+  key += text;
+
+  // 前のフレームと同じ文字列なら配置をやり直さない
+  auto it = layoutCache_.find(key);
+  if (it == layoutCache_.end()) {
+	const Font& font = fonts_[fontIndex];
+	CachedLayout layout;
+	layout.fontIndex = fontIndex;
+	layout.glyphSize = {font.glyphWidth * scale, font.glyphHeight * scale};
+	Layout(font, text, scale, layout.glyphs);
+	it = layoutCache_.emplace(std::move(key), std::move(layout)).first;
+  }
+  it->second.lastUsedFrame = frameCount_;
+
+  PrintCommand command;
+  command.layout = &it->second;
+  command.position = {x, y};
+  command.color = color;
+  printCommands_.push_back(command);
+}
+
+void TextRenderer::DrawAll(ID3D12GraphicsCommandList* commandList) {
+  if (!printCommands_.empty()) {
+	// 全ての文字を1つのスプライト一括描画に積む（フォントごとに1回の描画になる）
+	spriteBatch_.Begin(commandList);
+	for (const PrintCommand& command : printCommands_) {
+	  const CachedLayout& layout = *command.layout;
+	  const Font& font = fonts_[layout.fontIndex];
+
+	  SpriteBatch::Quad quad;
+	  quad.textureHandle = font.textureHandle;
+	  quad.size = layout.glyphSize;
+	  quad.color = command.color;
+	  quad.texSize = {font.glyphWidth, font.glyphHeight};
+	  for (const Glyph& glyph : layout.glyphs) {
+		quad.position = {
+		  command.position.x + glyph.offset.x, command.position.y + glyph.offset.y};
+		quad.texBase = glyph.texBase;
+		spriteBatch_.Draw(quad);
+	  }
+	}
+	spriteBatch_.End();
+	printCommands_.clear();
+  }
+
+  // しばらく使われていない配置結果を捨てる
+  for (auto it = layoutCache_.begin(); it != layoutCache_.end();) {
+	if (frameCount_ - it->second.lastUsedFrame > kCacheLifetime) {
+	  it = layoutCache_.erase(it);
+	} else {
+	  ++it;
+	}
+  }
+
+  frameCount_++;
+}
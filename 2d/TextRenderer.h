@@ -0,0 +1,126 @@
+﻿#pragma once
+
+#include "SpriteBatch.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// 文字列描画
+/// 等幅のビットマップフォント画像から文字ごとの矩形を並べ、SpriteBatchでまとめて描画する
+/// 同じ文字列の配置結果は使われ続ける間キャッシュする
+/// </summary>
+class TextRenderer {
+public: // サブクラス
+  /// <summary>
+  /// ビットマップフォント
+  /// </summary>
+  struct Font {
+	// テクスチャハンドル
+	uint32_t textureHandle = 0;
+	// フォント画像内1文字分の横幅
+	float glyphWidth = 0.0f;
+	// フォント画像内1文字分の縦幅
+	float glyphHeight = 0.0f;
+	// フォント画像内1行分の文字数
+	uint32_t glyphsPerLine = 1;
+	// フォント画像の先頭の文字コード
+	uint32_t firstCharacter = 32;
+	// フォント画像内の文字数
+	uint32_t characterCount = 95;
+  };
+
+  /// <summary>
+  /// 配置済みの1文字
+  /// </summary>
+  struct Glyph {
+	// 文字列の左上からの位置
+	DirectX::XMFLOAT2 offset;
+	// フォント画像内の左上座標
+	DirectX::XMFLOAT2 texBase;
+  };
+
+  // キャッシュを使われなくなってから保持するフレーム数
+  static const uint32_t kCacheLifetime = 60;
+
+public: // 静的メンバ関数
+  /// <summary>
+  /// 文字列の配置（GPUに触れない）
+  /// </summary>
+  /// <param name="font">フォント</param>
+  /// <param name="text">文字列（ASCII、改行可）</param>
+  /// <param name="scale">拡大率</param>
+  /// <param name="glyphs">配置結果の追加先</param>
+  static void Layout(
+    const Font& font, const std::string& text, float scale, std::vector<Glyph>& glyphs);
+
+public: // メンバ関数
+  /// <summary>
+  /// フォントの登録
+  /// </summary>
+  /// <param name="font">フォント</param>
+  /// <returns>フォント番号</returns>
+  uint32_t AddFont(const Font& font);
+
+  /// <summary>
+  /// 1文字列追加
+  /// </summary>
+  /// <param name="fontIndex">フォント番号</param>
+  /// <param name="text">文字列</param>
+  /// <param name="x">X座標</param>
+  /// <param name="y">Y座標</param>
+  /// <param name="scale">拡大率</param>
+  /// <param name="color">色</param>
+  void Print(
+    uint32_t fontIndex, const std::string& text, float x, float y, float scale = 1.0f,
+    const DirectX::XMFLOAT4& color = {1, 1, 1, 1});
+
+  /// <summary>
+  /// 追加した文字列をまとめて描画
+  /// </summary>
+  /// <param name="commandList">描画コマンドリスト</param>
+  void DrawAll(ID3D12GraphicsCommandList* commandList);
+
+  size_t GetCachedLayoutCount() const { return layoutCache_.size(); }
+
+private: // サブクラス
+  /// <summary>
+  /// 配置結果のキャッシュ
+  /// </summary>
+  struct CachedLayout {
+	// フォント番号
+	uint32_t fontIndex;
+	// 1文字分の幅、高さ（拡大率込み）
+	DirectX::XMFLOAT2 glyphSize;
+	// 配置済みの文字
+	std::vector<Glyph> glyphs;
+	// 最後に使われたフレーム
+	uint64_t lastUsedFrame;
+  };
+
+  /// <summary>
+  /// 描画待ちの文字列
+  /// </summary>
+  struct PrintCommand {
+	// 配置結果
+	const CachedLayout* layout;
+	// 左上座標
+	DirectX::XMFLOAT2 position;
+	// 色
+	DirectX::XMFLOAT4 color;
+  };
+
+private: // メンバ変数
+  // フォント
+  std::vector<Font> fonts_;
+  // 配置結果のキャッシュ（フォント番号、拡大率、文字列から作ったキー）
+  std::unordered_map<std::string, CachedLayout> layoutCache_;
+  // 描画待ちの文字列
+  std::vector<PrintCommand> printCommands_;
+  // 描画に使うスプライト一括描画
+  SpriteBatch spriteBatch_;
+  // 描画したフレーム数
+  uint64_t frameCount_ = 0;
+};
@@ -0,0 +1,183 @@
+﻿#include "TextureAtlas.h"
+#include "MappedFile.h"
+#include "TextureManager.h"
+#include <DirectXTex.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace DirectX;
+
+TextureAtlas::TextureAtlas() = default;
+
+TextureAtlas::~TextureAtlas() = default;
+
+void TextureAtlas::Initialize(const std::string& name, uint32_t pageSize) {
+  assert(pageSize > kPadding * 2);
+
+  Release();
+  name_ = name;
+  pageSize_ = pageSize;
+  entries_.clear();
+  nameToEntry_.clear();
+}
+
+bool TextureAtlas::Add(const std::string& fileName) {
+  if (Contains(fileName)) {
+	return true;
+  }
+
+  MappedFile file;
+  if (!file.Open(TextureManager::GetInstance()->GetDirectoryPath() + fileName)) {
+	return false;
+  }
+
+  // デコード（アトラスはミップを持たないのでミップマップは生成しない）
+  std::unique_ptr<ScratchImage> image = std::make_unique<ScratchImage>();
+  HRESULT result =
+    LoadFromWICMemory(file.GetData(), file.GetSize(), WIC_FLAGS_NONE, nullptr, *image);
+  if (FAILED(result)) {
+	return false;
+  }
+
+  // ページと同じ8bitのRGBAにそろえる
+  if (image->GetMetadata().format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+	std::unique_ptr<ScratchImage> converted = std::make_unique<ScratchImage>();
+	result = Convert(
+	  *image->GetImage(0, 0, 0), DXGI_FORMAT_R8G8B8A8_UNORM, TEX_FILTER_DEFAULT,
+	  TEX_THRESHOLD_DEFAULT, *converted);
+	if (FAILED(result)) {
+	  return false;
+	}
+	image = std::move(converted);
+  }
+
+  Entry entry;
+  entry.width = static_cast<uint32_t>(image->GetMetadata().width);
+  entry.height = static_cast<uint32_t>(image->GetMetadata().height);
+  if (entry.width + kPadding * 2 > pageSize_ || entry.height + kPadding * 2 > pageSize_) {
+	return false;
+  }
+  entry.image = std::move(image);
+  entry.page = 0;
+  entry.rect = {};
+
+  nameToEntry_.emplace(fileName, entries_.size());
+  entries_.push_back(std::move(entry));
+  return true;
+}
+
+void TextureAtlas::Build() {
+  Release();
+
+  // 高いものから詰めるとスカイラインが平らに保たれて隙間が減る
+  std::vector<size_t> order(entries_.size());
+  for (size_t i = 0; i < order.size(); i++) {
+	order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+	const Entry& entryA = entries_[a];
+	const Entry& entryB = entries_[b];
+	if (entryA.height != entryB.height) {
+	  return entryA.height > entryB.height;
+	}
+	return entryA.width > entryB.width;
+  });
+
+  // 入るページを前から探し、どこにも入らなければページを追加する
+  packers_.clear();
+  for (size_t index : order) {
+	Entry& entry = entries_[index];
+	uint32_t width = entry.width + kPadding * 2;
+	uint32_t height = entry.height + kPadding * 2;
+
+	bool isPacked = false;
+	for (size_t page = 0; page < packers_.size() && !isPacked; page++) {
+	  isPacked = packers_[page].Insert(width, height, entry.rect);
+	  entry.page = static_cast<uint32_t>(page);
+	}
+	if (!isPacked) {
+	  packers_.emplace_back();
+	  packers_.back().Initialize(pageSize_, pageSize_);
+	  isPacked = packers_.back().Insert(width, height, entry.rect);
+	  entry.page = static_cast<uint32_t>(packers_.size() - 1);
+	}
+	assert(isPacked);
+  }
+
+  // ページごとに画像を書き込んでテクスチャを生成する
+  for (uint32_t page = 0; page < packers_.size(); page++) {
+	ScratchImage pageImage;
+	HRESULT result =
+	  pageImage.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, pageSize_, pageSize_, 1, 1);
+	assert(SUCCEEDED(result));
+	std::memset(pageImage.GetPixels(), 0, pageImage.GetPixelsSize());
+
+	for (const Entry& entry : entries_) {
+	  if (entry.page == page) {
+		Blit(entry, pageImage);
+	  }
+	}
+
+	pageHandles_.push_back(
+	  TextureManager::LoadFromImage(name_ + "#" + std::to_string(page), pageImage));
+  }
+
+  // 領域を確定し、デコード済みの画像は捨てる
+  for (Entry& entry : entries_) {
+	entry.region.textureHandle = pageHandles_[entry.page];
+	entry.region.texBase = {
+	  static_cast<float>(entry.rect.x + kPadding), static_cast<float>(entry.rect.y + kPadding)};
+	entry.region.texSize = {static_cast<float>(entry.width), static_cast<float>(entry.height)};
+	entry.image.reset();
+  }
+}
+
+void TextureAtlas::Release() {
+  for (uint32_t handle : pageHandles_) {
+	if (TextureManager::GetInstance()->IsValid(handle)) {
+	  TextureManager::Unload(handle);
+	}
+  }
+  pageHandles_.clear();
+}
+
+const TextureAtlas::Region& TextureAtlas::GetRegion(const std::string& fileName) const {
+  auto it = nameToEntry_.find(fileName);
+  assert(it != nameToEntry_.end());
+  return entries_[it->second].region;
+}
+
+float TextureAtlas::GetOccupancy() const {
+  if (packers_.empty()) {
+	return 0.0f;
+  }
+
+  uint64_t usedArea = 0;
+  for (const Entry& entry : entries_) {
+	usedArea += static_cast<uint64_t>(entry.width) * entry.height;
+  }
+  return static_cast<float>(usedArea) /
+         (static_cast<float>(pageSize_) * pageSize_ * packers_.size());
+}
+
+void TextureAtlas::Blit(const Entry& entry, ScratchImage& page) {
+  assert(entry.image);
+  const Image* src = entry.image->GetImage(0, 0, 0);
+  const Image* dst = page.GetImage(0, 0, 0);
+
+  // 余白を含めた矩形の各画素に、最も近い元画像の画素を書き込む
+  for (uint32_t y = 0; y < entry.rect.height; y++) {
+	uint32_t srcY = (std::min)((std::max)(y, kPadding) - kPadding, entry.height - 1);
+	const uint8_t* srcRow = src->pixels + srcY * src->rowPitch;
+	uint8_t* dstRow = dst->pixels + (entry.rect.y + y) * dst->rowPitch + entry.rect.x * 4;
+
+	// 中央はまとめてコピー
+	std::memcpy(dstRow + kPadding * 4, srcRow, entry.width * 4);
+	for (uint32_t x = 0; x < kPadding; x++) {
+	  std::memcpy(dstRow + x * 4, srcRow, 4);
+	  std::memcpy(
+	    dstRow + (kPadding + entry.width + x) * 4, srcRow + (entry.width - 1) * 4, 4);
+	}
+  }
+}
@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#include "SkylinePacker.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DirectX {
+class ScratchImage;
+}
+
+/// <summary>
+/// テクスチャアトラス
+/// 小さな画像をまとめて数枚のページに詰め込み、TextureManagerに1枚のテクスチャとして登録する
+/// 同じページの画像は同じデスクリプタテーブルで描けるので、SpriteBatchでまとめて描画できる
+/// </summary>
+class TextureAtlas {
+public: // サブクラス
+  /// <summary>
+  /// アトラス内の1画像分の領域
+  /// </summary>
+  struct Region {
+	// ページのテクスチャハンドル
+	uint32_t textureHandle = 0;
+	// テクスチャ始点（ピクセル、Sprite::SetTextureRectにそのまま渡せる）
+	DirectX::XMFLOAT2 texBase = {0.0f, 0.0f};
+	// テクスチャ幅、高さ（ピクセル）
+	DirectX::XMFLOAT2 texSize = {0.0f, 0.0f};
+  };
+
+public: // 定数
+  // ページの標準の大きさ
+  static const uint32_t kDefaultPageSize = 2048;
+  // 画像の周りに端の画素を引き伸ばす幅（バイリニア補間で隣の画像がにじまないように）
+  static const uint32_t kPadding = 1;
+
+public: // メンバ関数
+  TextureAtlas();
+  ~TextureAtlas();
+
+  /// <summary>
+  /// 初期化
+  /// </summary>
+  /// <param name="name">名前（ページは「名前#番号」でTextureManagerに登録される）</param>
+  /// <param name="pageSize">ページの幅と高さ</param>
+  void Initialize(const std::string& name, uint32_t pageSize = kDefaultPageSize);
+
+  /// <summary>
+  /// 画像の追加（デコードだけ行い、詰め込みはBuildでまとめて行う）
+  /// </summary>
+  /// <param name="fileName">ファイル名（TextureManagerのディレクトリからの相対パス）</param>
+  /// <returns>成否（読み込めないか、ページに収まらない大きさならfalse）</returns>
+  bool Add(const std::string& fileName);
+
+  /// <summary>
+  /// 追加した画像をページに詰め込んでテクスチャを生成する
+  /// デコード済みの画像は捨てるので、作り直すときは初期化からやり直す
+  /// </summary>
+  void Build();
+
+  /// <summary>
+  /// ページのテクスチャを解放する
+  /// </summary>
+  void Release();
+
+  /// <summary>
+  /// 領域の取得
+  /// </summary>
+  /// <param name="fileName">追加したファイル名</param>
+  /// <returns>領域</returns>
+  const Region& GetRegion(const std::string& fileName) const;
+
+  /// <summary>
+  /// 画像が追加されているか
+  /// </summary>
+  /// <param name="fileName">ファイル名</param>
+  /// <returns>追加済みならtrue</returns>
+  bool Contains(const std::string& fileName) const { return nameToEntry_.count(fileName) != 0; }
+
+  /// <summary>
+  /// 詰め込み効率の取得
+  /// </summary>
+  /// <returns>画像の面積の合計 / 全ページの面積</returns>
+  float GetOccupancy() const;
+
+  size_t GetPageCount() const { return pageHandles_.size(); }
+
+private: // サブクラス
+  /// <summary>
+  /// 追加した画像
+  /// </summary>
+  struct Entry {
+	// デコード済みの画像（Buildまで保持する）
+	std::unique_ptr<DirectX::ScratchImage> image;
+	// 幅
+	uint32_t width;
+	// 高さ
+	uint32_t height;
+	// ページ番号
+	uint32_t page;
+	// 詰め込んだ位置（余白を含む）
+	SkylinePacker::Rect rect;
+	// 領域
+	Region region;
+  };
+
+private: // メンバ関数
+  /// <summary>
+  /// 画像をページに書き込む（余白には端の画素を引き伸ばす）
+  /// </summary>
+  /// <param name="entry">画像</param>
+  /// <param name="page">ページの画像</param>
+  static void Blit(const Entry& entry, DirectX::ScratchImage& page);
+
+private: // メンバ変数
+  // 名前
+  std::string name_;
+  // ページの幅と高さ
+  uint32_t pageSize_ = kDefaultPageSize;
+  // 追加した画像
+  std::vector<Entry> entries_;
+  // ファイル名から画像の番号への索引
+  std::unordered_map<std::string, size_t> nameToEntry_;
+  // ページごとの詰め込み
+  std::vector<SkylinePacker> packers_;
+  // ページのテクスチャハンドル
+  std::vector<uint32_t> pageHandles_;
+};
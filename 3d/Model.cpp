@@ -1,5 +1,6 @@
 ﻿#include "Model.h"
 #include <DirectXTex.h>
+#include <algorithm>
 #include <d3dcompiler.h>
 
 #pragma comment(lib, "d3dcompiler.lib")
@@ -10,17 +11,22 @@ using namespace Microsoft::WRL;
 /// <summary>
 /// 静的メンバ変数の実体
 /// </summary>
+DirectXCommon* Model::sDxCommon = nullptr;
 ID3D12Device* Model::sDevice = nullptr;
 UINT Model::sDescriptorHandleIncrementSize = 0;
 ID3D12GraphicsCommandList* Model::sCommandList = nullptr;
 ComPtr<ID3D12RootSignature> Model::sRootSignature;
 ComPtr<ID3D12PipelineState> Model::sPipelineState;
+ComPtr<ID3D12PipelineState> Model::sPipelineStateInstanced;
+int Model::sWindowHeight = 0;
 
-void Model::StaticInitialize(ID3D12Device* device, int window_width, int window_height) {
+void Model::StaticInitialize(DirectXCommon* dxCommon, int window_width, int window_height) {
   // nullptrチェック
-  assert(device);
+  assert(dxCommon);
 
-  sDevice = device;
+  sDxCommon = dxCommon;
+  sDevice = dxCommon->GetDevice();
+  sWindowHeight = window_height;
 
   // パイプライン初期化
   InitializeGraphicsPipeline();
@@ -59,9 +65,10 @@ Model* Model::Create() {
 
 void Model::InitializeGraphicsPipeline() {
   HRESULT result = S_FALSE;
-  ComPtr<ID3DBlob> vsBlob;    // 頂点シェーダオブジェクト
-  ComPtr<ID3DBlob> psBlob;    // ピクセルシェーダオブジェクト
-  ComPtr<ID3DBlob> errorBlob; // エラーオブジェクト
+  ComPtr<ID3DBlob> vsBlob;          // 頂点シェーダオブジェクト
+  ComPtr<ID3DBlob> vsInstancedBlob; // インスタンス描画用頂点シェーダオブジェクト
+  ComPtr<ID3DBlob> psBlob;          // ピクセルシェーダオブジェクト
+  ComPtr<ID3DBlob> errorBlob;       // エラーオブジェクト
 
   // 頂点シェーダの読み込みとコンパイル
   result = D3DCompileFromFile(
@@ -83,6 +90,26 @@ void Model::InitializeGraphicsPipeline() {
 	exit(1);
   }
 
+  // インスタンス描画用頂点シェーダの読み込みとコンパイル
+  result = D3DCompileFromFile(
+    L"Resources/shaders/BasicInstancedVS.hlsl", // シェーダファイル名
+    nullptr,
+    D3D_COMPILE_STANDARD_FILE_INCLUDE, // インクルード可能にする
+    "main", "vs_5_0", // エントリーポイント名、シェーダーモデル指定
+    D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION, // デバッグ用設定
+    0, &vsInstancedBlob, &errorBlob);
+  if (FAILED(result)) {
+	// errorBlobからエラー内容をstring型にコピー
+	std::string errstr;
+	errstr.resize(errorBlob->GetBufferSize());
+
+	std::copy_n((char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize(), errstr.begin());
+	errstr += "\n";
+	// エラー内容を出力ウィンドウに表示
+	OutputDebugStringA(errstr.c_str());
+	exit(1);
+  }
+
   // ピクセルシェーダの読み込みとコンパイル
   result = D3DCompileFromFile(
     L"Resources/shaders/BasicPS.hlsl", // シェーダファイル名
@@ -164,10 +191,11 @@ void Model::InitializeGraphicsPipeline() {
   descRangeSRV.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0); // t0 レジスタ
 
   // ルートパラメータ
-  CD3DX12_ROOT_PARAMETER rootparams[3] = {};
+  CD3DX12_ROOT_PARAMETER rootparams[4] = {};
   rootparams[0].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
   rootparams[1].InitAsConstantBufferView(1, 0, D3D12_SHADER_VISIBILITY_ALL);
   rootparams[2].InitAsDescriptorTable(1, &descRangeSRV, D3D12_SHADER_VISIBILITY_ALL);
+  rootparams[3].InitAsShaderResourceView(1, 0, D3D12_SHADER_VISIBILITY_VERTEX); // t1 レジスタ
 
   // スタティックサンプラー
   CD3DX12_STATIC_SAMPLER_DESC samplerDesc =
@@ -194,6 +222,11 @@ void Model::InitializeGraphicsPipeline() {
   // グラフィックスパイプラインの生成
   result = sDevice->CreateGraphicsPipelineState(&gpipeline, IID_PPV_ARGS(&sPipelineState));
   assert(SUCCEEDED(result));
+
+  // インスタンス描画用のグラフィックスパイプラインの生成（頂点シェーダのみ異なる）
+  gpipeline.VS = CD3DX12_SHADER_BYTECODE(vsInstancedBlob.Get());
+  result = sDevice->CreateGraphicsPipelineState(&gpipeline, IID_PPV_ARGS(&sPipelineStateInstanced));
+  assert(SUCCEEDED(result));
 }
 
 void Model::CreateMesh() {
@@ -320,7 +353,7 @@ void Model::Draw(
   // nullptrチェック
   assert(sDevice);
   assert(sCommandList);
-  assert(worldTransform.constBuff_.Get());
+  assert(worldTransform.constBuffer_.IsValid());
 
   // 頂点バッファの設定
   sCommandList->IASetVertexBuffers(0, 1, &vbView_);
@@ -330,17 +363,100 @@ void Model::Draw(
   // CBVをセット（ワールド行列）
   sCommandList->SetGraphicsRootConstantBufferView(
     static_cast<UINT>(RoomParameter::kWorldTransform),
-    worldTransform.constBuff_->GetGPUVirtualAddress());
+    worldTransform.constBuffer_.GetGPUVirtualAddress());
 
   // CBVをセット（ビュープロジェクション行列）
   sCommandList->SetGraphicsRootConstantBufferView(
     static_cast<UINT>(RoomParameter::kViewProjection),
-    viewProjection.constBuff_->GetGPUVirtualAddress());
+    viewProjection.constBuffer_.GetGPUVirtualAddress());
 
   // SRVをセット
-  TextureManager::GetInstance()->SetGraphicsRootDescriptorTable(
+  TextureManager* textureManager = TextureManager::GetInstance();
+  textureManager->SetGraphicsRootDescriptorTable(
     sCommandList, static_cast<UINT>(RoomParameter::kTexture), textureHadle);
 
+  // 画面上の大きさを報告してテクスチャのミップを読み込ませる
+  textureManager->ReportUsage(
+    textureHadle, ComputeScreenSize(worldTransform.matWorld_, viewProjection));
+
   // 描画コマンド
   sCommandList->DrawIndexedInstanced(static_cast<UINT>(indices_.size()), 1, 0, 0, 0);
 }
+
+void Model::DrawInstanced(
+  const WorldTransform* const* worldTransforms, size_t count, const ViewProjection& viewProjection,
+  uint32_t textureHadle) {
+  // nullptrチェック
+  assert(sDevice);
+  assert(sCommandList);
+  assert(worldTransforms);
+
+  if (count == 0) {
+	return;
+  }
+
+  // ワールド行列を一時アップロード領域に詰める
+  DirectXCommon::TransientAllocation instanceData =
+    sDxCommon->AllocateTransient(sizeof(XMMATRIX) * count, alignof(XMMATRIX));
+  XMMATRIX* matWorlds = static_cast<XMMATRIX*>(instanceData.cpuAddress);
+  for (size_t i = 0; i < count; i++) {
+	matWorlds[i] = worldTransforms[i]->matWorld_;
+  }
+
+  // パイプラインステートをインスタンス描画用に切り替え
+  sCommandList->SetPipelineState(sPipelineStateInstanced.Get());
+
+  // 頂点バッファの設定
+  sCommandList->IASetVertexBuffers(0, 1, &vbView_);
+  // インデックスバッファの設定
+  sCommandList->IASetIndexBuffer(&ibView_);
+
+  // SRVをセット（インスタンスごとのワールド行列）
+  sCommandList->SetGraphicsRootShaderResourceView(
+    static_cast<UINT>(RoomParameter::kInstanceData), instanceData.gpuAddress);
+
+  // CBVをセット（ビュープロジェクション行列）
+  sCommandList->SetGraphicsRootConstantBufferView(
+    static_cast<UINT>(RoomParameter::kViewProjection),
+    viewProjection.constBuffer_.GetGPUVirtualAddress());
+
+  // SRVをセット
+  TextureManager* textureManager = TextureManager::GetInstance();
+  textureManager->SetGraphicsRootDescriptorTable(
+    sCommandList, static_cast<UINT>(RoomParameter::kTexture), textureHadle);
+
+  // 最も大きく描かれるインスタンスの大きさを報告する
+  float screenSize = 0.0f;
+  for (size_t i = 0; i < count; i++) {
+	screenSize = (std::max)(
+	  screenSize, ComputeScreenSize(worldTransforms[i]->matWorld_, viewProjection));
+  }
+  textureManager->ReportUsage(textureHadle, screenSize);
+
+  // 描画コマンド
+  sCommandList->DrawIndexedInstanced(
+    static_cast<UINT>(indices_.size()), static_cast<UINT>(count), 0, 0, 0);
+
+  // パイプラインステートを戻す
+  sCommandList->SetPipelineState(sPipelineState.Get());
+}
+
+float Model::ComputeScreenSize(const XMMATRIX& matWorld, const ViewProjection& viewProjection) {
+  // メッシュは一辺2の立方体なので、ワールド行列の最大の拡大率から面の大きさを求める
+  XMVECTOR scale = XMVectorMax(
+    XMVectorMax(XMVector3Length(matWorld.r[0]), XMVector3Length(matWorld.r[1])),
+    XMVector3Length(matWorld.r[2]));
+  float size = 2.0f * XMVectorGetX(scale);
+
+  // ビュー空間での奥行き
+  XMVECTOR position = XMVector3Transform(matWorld.r[3], viewProjection.matView);
+  float depth = XMVectorGetZ(position);
+  if (depth <= viewProjection.nearZ) {
+	// カメラに重なっていれば最も細かいミップを要求する
+	return depth + size > 0.0f ? static_cast<float>(sWindowHeight) : 0.0f;
+  }
+
+  // 射影行列の縦の拡大率で画面の高さに対する割合を求める
+  float projectionScale = XMVectorGetY(viewProjection.matProjection.r[1]);
+  return size * projectionScale / depth * 0.5f * static_cast<float>(sWindowHeight);
+}
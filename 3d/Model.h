@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include "DirectXCommon.h"
 #include "TextureManager.h"
 #include "ViewProjection.h"
 #include "WorldTransform.h"
@@ -22,6 +23,7 @@ public: // 列挙子
 	kWorldTransform, // ワールド変換行列
 	kViewProjection, // ビュープロジェクション変換行列
 	kTexture,        // テクスチャ
+	kInstanceData,   // インスタンスごとのワールド変換行列
   };
 
 public: // サブクラス
@@ -36,10 +38,10 @@ public: // 静的メンバ関数
   /// <summary>
   /// 静的初期化
   /// </summary>
-  /// <param name="device">デバイス</param>
+  /// <param name="dxCommon">DirectX汎用（一時アップロード領域の確保に使用）</param>
   /// <param name="window_width">画面幅</param>
   /// <param name="window_height">画面高さ</param>
-  static void StaticInitialize(ID3D12Device* device, int window_width, int window_height);
+  static void StaticInitialize(DirectXCommon* dxCommon, int window_width, int window_height);
 
   /// <summary>
   /// 描画前処理
@@ -59,6 +61,8 @@ public: // 静的メンバ関数
   static Model* Create();
 
 private: // 静的メンバ変数
+  // DirectX汎用
+  static DirectXCommon* sDxCommon;
   // デバイス
   static ID3D12Device* sDevice;
   // デスクリプタサイズ
@@ -69,6 +73,10 @@ private: // 静的メンバ変数
   static Microsoft::WRL::ComPtr<ID3D12RootSignature> sRootSignature;
   // パイプラインステートオブジェクト
   static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineState;
+  // パイプラインステートオブジェクト（インスタンス描画用）
+  static Microsoft::WRL::ComPtr<ID3D12PipelineState> sPipelineStateInstanced;
+  // 画面高さ
+  static int sWindowHeight;
 
 private: // 静的メンバ関数
   /// <summary>
@@ -76,6 +84,15 @@ private: // 静的メンバ関数
   /// </summary>
   static void InitializeGraphicsPipeline();
 
+  /// <summary>
+  /// モデルが画面上に描かれるおおよその大きさを求める（テクスチャのストリーミング用）
+  /// </summary>
+  /// <param name="matWorld">ワールド行列</param>
+  /// <param name="viewProjection">ビュープロジェクション変換データ</param>
+  /// <returns>大きさ（ピクセル、カメラの後ろなら0）</returns>
+  static float ComputeScreenSize(
+    const DirectX::XMMATRIX& matWorld, const ViewProjection& viewProjection);
+
 public: // メンバ関数
   /// <summary>
   /// 初期化
@@ -84,9 +101,22 @@ public: // メンバ関数
   /// <summary>
   /// 描画
   /// </summary>
+  /// <param name="worldTransform">ワールド変換データ</param>
+  /// <param name="viewProjection">ビュープロジェクション変換データ</param>
+  /// <param name="textureHadle">テクスチャハンドル（白ならTextureManager::kDefaultTextureHandle）</param>
   void Draw(
     const WorldTransform& worldTransform, const ViewProjection& viewProjection,
-    uint32_t textureHadle = 0);
+    uint32_t textureHadle);
+  /// <summary>
+  /// インスタンス描画（全インスタンスを1回の描画コマンドで描く）
+  /// </summary>
+  /// <param name="worldTransforms">ワールド変換データの配列</param>
+  /// <param name="count">インスタンス数</param>
+  /// <param name="viewProjection">ビュープロジェクション変換データ</param>
+  /// <param name="textureHadle">テクスチャハンドル（白ならTextureManager::kDefaultTextureHandle）</param>
+  void DrawInstanced(
+    const WorldTransform* const* worldTransforms, size_t count,
+    const ViewProjection& viewProjection, uint32_t textureHadle);
 
   /// <summary>
   /// メッシュデータ生成
@@ -0,0 +1,113 @@
+﻿#include "TransformHierarchy.h"
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <unordered_map>
+
+void TransformHierarchy::Add(WorldTransform* worldTransform) {
+  assert(worldTransform);
+  assert(std::find(nodes_.begin(), nodes_.end(), worldTransform) == nodes_.end());
+
+  nodes_.push_back(worldTransform);
+  isSorted_ = false;
+}
+
+void TransformHierarchy::Remove(WorldTransform* worldTransform) {
+  auto it = std::find(nodes_.begin(), nodes_.end(), worldTransform);
+  if (it != nodes_.end()) {
+	nodes_.erase(it);
+	isSorted_ = false;
+  }
+}
+
+void TransformHierarchy::Clear() {
+  nodes_.clear();
+  parentIndices_.clear();
+  parents_.clear();
+  isSorted_ = true;
+}
+
+void TransformHierarchy::Update() {
+  // 親子関係が変わっていたら並べ直す
+  if (!isSorted_ || !IsOrderValid()) {
+	Sort();
+  }
+
+  // 親が変更されていれば子も再計算する（親は必ず子より前にある）
+  for (size_t i = 0; i < nodes_.size(); i++) {
+	int32_t parentIndex = parentIndices_[i];
+	if (parentIndex >= 0 && nodes_[parentIndex]->isDirty_) {
+	  nodes_[i]->isDirty_ = true;
+	}
+  }
+
+  // 先頭から順にまとめて更新
+  WorldTransform::UpdateMatrices(nodes_.data(), nodes_.size());
+}
+
+bool TransformHierarchy::IsOrderValid() const {
+  for (size_t i = 0; i < nodes_.size(); i++) {
+	if (nodes_[i]->parent_ != parents_[i]) {
+	  return false;
+	}
+  }
+  return true;
+}
+
+void TransformHierarchy::Sort() {
+  size_t count = nodes_.size();
+
+  // ポインタから添え字を引けるようにする
+  std::unordered_map<const WorldTransform*, int32_t> indices;
+  indices.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+	indices[nodes_[i]] = static_cast<int32_t>(i);
+  }
+
+  // 各ノードの深さを求める（未登録の親より上はたどらない）
+  std::vector<int32_t> depths(count, -1);
+  for (size_t i = 0; i < count; i++) {
+	int32_t depth = 0;
+	for (const WorldTransform* parent = nodes_[i]->parent_; parent; parent = parent->parent_) {
+	  auto it = indices.find(parent);
+	  if (it == indices.end()) {
+		break;
+	  }
+	  // 深さが分かっている祖先に着いたら打ち切り
+	  if (depths[it->second] >= 0) {
+		depth += depths[it->second] + 1;
+		break;
+	  }
+	  depth++;
+	  // 循環参照の検出
+	  assert(depth <= static_cast<int32_t>(count));
+	}
+	depths[i] = depth;
+  }
+
+  // 深さ順に安定ソート
+  std::vector<int32_t> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int32_t a, int32_t b) {
+    return depths[a] < depths[b];
+  });
+
+  std::vector<WorldTransform*> sorted(count);
+  for (size_t i = 0; i < count; i++) {
+	sorted[i] = nodes_[order[i]];
+	indices[sorted[i]] = static_cast<int32_t>(i);
+  }
+  nodes_.swap(sorted);
+
+  // 親の添え字を記録
+  parentIndices_.resize(count);
+  parents_.resize(count);
+  for (size_t i = 0; i < count; i++) {
+	const WorldTransform* parent = nodes_[i]->parent_;
+	auto it = parent ? indices.find(parent) : indices.end();
+	parentIndices_[i] = it != indices.end() ? it->second : -1;
+	parents_[i] = parent;
+  }
+
+  isSorted_ = true;
+}
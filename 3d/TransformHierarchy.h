@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include "WorldTransform.h"
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 親子関係を持つワールド変換データの一括更新
+/// 親が必ず子より前に来る順に平坦化して保持し、先頭から1回なめるだけで全体を更新する
+/// </summary>
+class TransformHierarchy {
+public: // メンバ関数
+  /// <summary>
+  /// 登録
+  /// </summary>
+  /// <param name="worldTransform">ワールド変換データ</param>
+  void Add(WorldTransform* worldTransform);
+
+  /// <summary>
+  /// 登録解除
+  /// </summary>
+  /// <param name="worldTransform">ワールド変換データ</param>
+  void Remove(WorldTransform* worldTransform);
+
+  /// <summary>
+  /// 全登録解除
+  /// </summary>
+  void Clear();
+
+  /// <summary>
+  /// 変更のあった部分木だけ行列を更新する
+  /// </summary>
+  void Update();
+
+  size_t GetCount() const { return nodes_.size(); }
+
+private: // メンバ変数
+  // 親が子より前に来るように並べたワールド変換データ
+  std::vector<WorldTransform*> nodes_;
+  // 各ノードの親の添え字（親が未登録なら-1）
+  std::vector<int32_t> parentIndices_;
+  // 並べ替え時点の親
+  std::vector<const WorldTransform*> parents_;
+  // 並べ替え済みか
+  bool isSorted_ = true;
+
+private: // メンバ関数
+  /// <summary>
+  /// 並べ替え後に親子関係が変わっていないか
+  /// </summary>
+  /// <returns>変わっていなければtrue</returns>
+  bool IsOrderValid() const;
+
+  /// <summary>
+  /// 深さ順に並べ替える
+  /// </summary>
+  void Sort();
+};
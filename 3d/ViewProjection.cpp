@@ -1,37 +1,19 @@
 ﻿#include "ViewProjection.h"
 #include "WinApp.h"
 #include <cassert>
-#include <d3dx12.h>
 
 using namespace DirectX;
 
 void ViewProjection::Initialize(ID3D12Device* device) {
   CreateConstBuffer(device);
-  Map();
   UpdateMatrix();
 }
 
 void ViewProjection::CreateConstBuffer(ID3D12Device* device) {
-  HRESULT result;
+  assert(device);
 
-  // ヒーププロパティ
-  CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-  // リソース設定
-  CD3DX12_RESOURCE_DESC resourceDesc =
-    CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferDataViewProjection) + 0xff) & ~0xff);
-
-  // 定数バッファの生成
-  result = device->CreateCommittedResource(
-    &heapProps, // アップロード可能
-    D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-    IID_PPV_ARGS(&constBuff_));
-  assert(SUCCEEDED(result));
-}
-
-void ViewProjection::Map() {
-  // 定数バッファとのデータリンク
-  HRESULT result = constBuff_->Map(0, nullptr, (void**)&constMap);
-  assert(SUCCEEDED(result));
+  // 定数バッファプールからスロットを確保
+  constBuffer_ = ConstBufferPool::GetInstance()->Allocate(sizeof(ConstBufferDataViewProjection));
 }
 
 void ViewProjection::UpdateMatrix() {
@@ -47,6 +29,8 @@ void ViewProjection::UpdateMatrix() {
   matProjection = XMMatrixPerspectiveFovLH(fovAngleY, aspectRatio, nearZ, farZ);
 
   // 定数バッファに書き込み
-  constMap->view = matView;
-  constMap->projection = matProjection;
+  ConstBufferDataViewProjection constData;
+  constData.view = matView;
+  constData.projection = matProjection;
+  constBuffer_.Write(&constData, sizeof(constData));
 }
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include "ConstBufferPool.h"
 #include <DirectXMath.h>
 #include <d3d12.h>
 #include <wrl.h>
@@ -14,10 +15,8 @@ struct ConstBufferDataViewProjection {
 /// ビュープロジェクション変換データ
 /// </summary>
 struct ViewProjection {
-  // 定数バッファ
-  Microsoft::WRL::ComPtr<ID3D12Resource> constBuff_;
-  // マッピング済みアドレス
-  ConstBufferDataViewProjection* constMap = nullptr;
+  // 定数バッファ（プールから確保）
+  ConstBufferPool::Allocation constBuffer_;
 
 #pragma region ビュー行列の設定
   // 視点座標
@@ -53,10 +52,6 @@ struct ViewProjection {
   /// </summary>
   void CreateConstBuffer(ID3D12Device* device);
   /// <summary>
-  /// マッピングする
-  /// </summary>
-  void Map();
-  /// <summary>
   /// 行列を更新する
   /// </summary>
   void UpdateMatrix();
@@ -1,55 +1,192 @@
 ﻿#include "WorldTransform.h"
+#include <algorithm>
 #include <cassert>
-#include <d3dx12.h>
 
 using namespace DirectX;
 
 void WorldTransform::Initialize(ID3D12Device* device) {
   CreateConstBuffer(device);
-  Map();
   UpdateMatrix();
 }
 
 void WorldTransform::CreateConstBuffer(ID3D12Device* device) {
-  HRESULT result;
+  assert(device);
 
-  // ヒーププロパティ
-  CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-  // リソース設定
-  CD3DX12_RESOURCE_DESC resourceDesc =
-    CD3DX12_RESOURCE_DESC::Buffer((sizeof(ConstBufferDataWorldTransform) + 0xff) & ~0xff);
+  // 定数バッファプールからスロットを確保
+  constBuffer_ = ConstBufferPool::GetInstance()->Allocate(sizeof(ConstBufferDataWorldTransform));
+}
+
+void WorldTransform::UpdateMatrix() {
+  // スケール → 回転(Z,X,Y) → 平行移動 を直接合成する
+  matWorld_ = XMMatrixMultiply(
+    XMMatrixScaling(scale_.x, scale_.y, scale_.z),
+    XMMatrixRotationRollPitchYaw(rotation_.x, rotation_.y, rotation_.z));
+  matWorld_.r[3] = XMVectorSet(translation_.x, translation_.y, translation_.z, 1.0f);
+
+  // 親の行列を掛ける
+  if (parent_) {
+	matWorld_ *= parent_->matWorld_;
+  }
 
-  // 定数バッファの生成
-  result = device->CreateCommittedResource(
-    &heapProps, // アップロード可能
-    D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-    IID_PPV_ARGS(&constBuff_));
-  assert(SUCCEEDED(result));
+  // 定数バッファに書き込み
+  ConstBufferDataWorldTransform constData;
+  constData.matWorld = matWorld_;
+  constBuffer_.Write(&constData, sizeof(constData));
+
+  isDirty_ = false;
 }
 
-void WorldTransform::Map() {
-  // 定数バッファとのデータリンク
-  HRESULT result = constBuff_->Map(0, nullptr, (void**)&constMap);
-  assert(SUCCEEDED(result));
+namespace {
+
+// SIMDで一度に処理する要素数
+const size_t kSimdWidth = 4;
+
+/// <summary>
+/// 4個分のスケール、回転、平行移動を成分ごとに並べたもの(SoA)
+/// </summary>
+struct TransformBlock {
+  XMVECTOR scaleX, scaleY, scaleZ;
+  XMVECTOR rotationX, rotationY, rotationZ;
+  XMVECTOR translationX, translationY, translationZ;
+};
+
+/// <summary>
+/// 4個分のワールド行列をまとめて合成
+/// </summary>
+/// <param name="block">SoA形式のSRT</param>
+/// <param name="matWorlds">合成したワールド行列</param>
+void ComposeMatrices(const TransformBlock& block, XMMATRIX (&matWorlds)[kSimdWidth]) {
+  XMVECTOR sinX, cosX, sinY, cosY, sinZ, cosZ;
+  XMVectorSinCos(&sinX, &cosX, block.rotationX);
+  XMVectorSinCos(&sinY, &cosY, block.rotationY);
+  XMVectorSinCos(&sinZ, &cosZ, block.rotationZ);
+
+  // 回転行列(Z → X → Y)の各成分
+  XMVECTOR sxsy = sinX * sinY;
+  XMVECTOR sxcy = sinX * cosY;
+  XMVECTOR m00 = cosZ * cosY + sinZ * sxsy;
+  XMVECTOR m01 = sinZ * cosX;
+  XMVECTOR m02 = sinZ * sxcy - cosZ * sinY;
+  XMVECTOR m10 = cosZ * sxsy - sinZ * cosY;
+  XMVECTOR m11 = cosZ * cosX;
+  XMVECTOR m12 = sinZ * sinY + cosZ * sxcy;
+  XMVECTOR m20 = cosX * sinY;
+  XMVECTOR m21 = -sinX;
+  XMVECTOR m22 = cosX * cosY;
+
+  // 各行にスケールを反映
+  m00 *= block.scaleX;
+  m01 *= block.scaleX;
+  m02 *= block.scaleX;
+  m10 *= block.scaleY;
+  m11 *= block.scaleY;
+  m12 *= block.scaleY;
+  m20 *= block.scaleZ;
+  m21 *= block.scaleZ;
+  m22 *= block.scaleZ;
+
+  // 成分ごとの並びを転置して1個ずつの行に戻す
+  XMVECTOR zero = XMVectorZero();
+  XMMATRIX rows0 = XMMatrixTranspose(XMMATRIX(m00, m01, m02, zero));
+  XMMATRIX rows1 = XMMatrixTranspose(XMMATRIX(m10, m11, m12, zero));
+  XMMATRIX rows2 = XMMatrixTranspose(XMMATRIX(m20, m21, m22, zero));
+  XMMATRIX rows3 = XMMatrixTranspose(
+    XMMATRIX(block.translationX, block.translationY, block.translationZ, XMVectorSplatOne()));
+
+  for (size_t i = 0; i < kSimdWidth; i++) {
+	matWorlds[i] = XMMATRIX(rows0.r[i], rows1.r[i], rows2.r[i], rows3.r[i]);
+  }
 }
 
-void WorldTransform::UpdateMatrix() {
-  XMMATRIX matScale, matRot, matTrans;
-
-  // スケール、回転、平行移動行列の計算
-  matScale = XMMatrixScaling(scale_.x, scale_.y, scale_.z);
-  matRot = XMMatrixIdentity();
-  matRot *= XMMatrixRotationZ(rotation_.z);
-  matRot *= XMMatrixRotationX(rotation_.x);
-  matRot *= XMMatrixRotationY(rotation_.y);
-  matTrans = XMMatrixTranslation(translation_.x, translation_.y, translation_.z);
-
-  // ワールド行列の合成
-  matWorld_ = XMMatrixIdentity(); // 変形をリセット
-  matWorld_ *= matScale;          // ワールド行列にスケーリングを反映
-  matWorld_ *= matRot;            // ワールド行列に回転を反映
-  matWorld_ *= matTrans;          // ワールド行列に平行移動を反映
+/// <summary>
+/// SoA形式に詰めた分の行列を合成して書き込む
+/// </summary>
+/// <param name="soa">SoA形式のSRT</param>
+/// <param name="targets">書き込み先</param>
+/// <param name="count">有効な要素数</param>
+void FlushBlock(
+  const float (&soa)[9][kSimdWidth], WorldTransform* const (&targets)[kSimdWidth], size_t count) {
+  TransformBlock block;
+  block.scaleX = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(soa[0]));
+  block.scaleY = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(soa[1]));
+  block.scaleZ = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(soa[2]));
+  block.rotationX = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(soa[3]));
+  block.rotationY = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(soa[4]));
+  block.rotationZ = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(soa[5]));
+  block.translationX = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(soa[6]));
+  block.translationY = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(soa[7]));
+  block.translationZ = XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(soa[8]));
 
-  // 定数バッファに書き込み
-  constMap->matWorld = matWorld_;
+  XMMATRIX matWorlds[kSimdWidth];
+  ComposeMatrices(block, matWorlds);
+
+  // ワールド行列と定数バッファに書き込み
+  // 要素順に書き込むので、同じブロック内の親は子より先に更新済みになる
+  for (size_t i = 0; i < count; i++) {
+	// 親の行列を掛ける
+	if (targets[i]->parent_) {
+	  matWorlds[i] *= targets[i]->parent_->matWorld_;
+	}
+	targets[i]->matWorld_ = matWorlds[i];
+	ConstBufferDataWorldTransform constData;
+	constData.matWorld = matWorlds[i];
+	targets[i]->constBuffer_.Write(&constData, sizeof(constData));
+	targets[i]->isDirty_ = false;
+  }
+}
+
+/// <summary>
+/// 変更されたものだけ行列をまとめて更新する
+/// </summary>
+/// <param name="count">要素数</param>
+/// <param name="at">i番目のワールド変換データを返す関数</param>
+template<class Accessor> void UpdateMatricesImpl(size_t count, Accessor at) {
+  alignas(16) float soa[9][kSimdWidth] = {};
+  WorldTransform* targets[kSimdWidth] = {};
+  size_t n = 0;
+
+  for (size_t i = 0; i < count; i++) {
+	WorldTransform& worldTransform = at(i);
+	// 変更の無いものは再計算も転送もしない
+	if (!worldTransform.isDirty_) {
+	  continue;
+	}
+
+	// SoA形式に詰め替え
+	soa[0][n] = worldTransform.scale_.x;
+	soa[1][n] = worldTransform.scale_.y;
+	soa[2][n] = worldTransform.scale_.z;
+	soa[3][n] = worldTransform.rotation_.x;
+	soa[4][n] = worldTransform.rotation_.y;
+	soa[5][n] = worldTransform.rotation_.z;
+	soa[6][n] = worldTransform.translation_.x;
+	soa[7][n] = worldTransform.translation_.y;
+	soa[8][n] = worldTransform.translation_.z;
+	targets[n] = &worldTransform;
+	n++;
+
+	if (n == kSimdWidth) {
+	  FlushBlock(soa, targets, n);
+	  n = 0;
+	}
+  }
+
+  // 端数分
+  if (n > 0) {
+	FlushBlock(soa, targets, n);
+  }
+}
+
+} // namespace
+
+void WorldTransform::UpdateMatrices(WorldTransform* worldTransforms, size_t count) {
+  assert(worldTransforms || count == 0);
+  UpdateMatricesImpl(
+    count, [worldTransforms](size_t i) -> WorldTransform& { return worldTransforms[i]; });
+}
+
+void WorldTransform::UpdateMatrices(WorldTransform* const* worldTransforms, size_t count) {
+  assert(worldTransforms || count == 0);
+  UpdateMatricesImpl(
+    count, [worldTransforms](size_t i) -> WorldTransform& { return *worldTransforms[i]; });
 }
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
+#include "ConstBufferPool.h"
 #include <DirectXMath.h>
+#include <cstddef>
 #include <d3d12.h>
 #include <wrl.h>
 
@@ -13,10 +15,8 @@ struct ConstBufferDataWorldTransform {
 /// ワールド変換データ
 /// </summary>
 struct WorldTransform {
-  // 定数バッファ
-  Microsoft::WRL::ComPtr<ID3D12Resource> constBuff_;
-  // マッピング済みアドレス
-  ConstBufferDataWorldTransform* constMap = nullptr;
+  // 定数バッファ（プールから確保）
+  ConstBufferPool::Allocation constBuffer_;
   // ローカルスケール
   DirectX::XMFLOAT3 scale_ = {1, 1, 1};
   // X,Y,Z軸回りのローカル回転角
@@ -25,6 +25,10 @@ struct WorldTransform {
   DirectX::XMFLOAT3 translation_ = {0, 0, 0};
   // ローカル → ワールド変換行列
   DirectX::XMMATRIX matWorld_;
+  // 行列の再計算が必要か
+  bool isDirty_ = true;
+  // 親となるワールド変換へのポインタ
+  const WorldTransform* parent_ = nullptr;
 
   /// <summary>
   /// 初期化
@@ -35,11 +39,61 @@ struct WorldTransform {
   /// </summary>
   void CreateConstBuffer(ID3D12Device* device);
   /// <summary>
-  /// マッピングする
+  /// 行列を更新する（変更の有無に関わらず再計算する）
   /// </summary>
-  void Map();
+  void UpdateMatrix();
+
   /// <summary>
-  /// 行列を更新する
+  /// スケールの設定
   /// </summary>
-  void UpdateMatrix();
+  /// <param name="scale">スケール</param>
+  void SetScale(const DirectX::XMFLOAT3& scale) {
+	scale_ = scale;
+	isDirty_ = true;
+  }
+  /// <summary>
+  /// 回転角の設定
+  /// </summary>
+  /// <param name="rotation">回転角</param>
+  void SetRotation(const DirectX::XMFLOAT3& rotation) {
+	rotation_ = rotation;
+	isDirty_ = true;
+  }
+  /// <summary>
+  /// 座標の設定
+  /// </summary>
+  /// <param name="translation">座標</param>
+  void SetTranslation(const DirectX::XMFLOAT3& translation) {
+	translation_ = translation;
+	isDirty_ = true;
+  }
+  /// <summary>
+  /// 親の設定
+  /// </summary>
+  /// <param name="parent">親（nullptrで親無し）</param>
+  void SetParent(const WorldTransform* parent) {
+	parent_ = parent;
+	isDirty_ = true;
+  }
+  /// <summary>
+  /// 変更済みとしてマークする（メンバを直接書き換えた場合に呼ぶ）
+  /// </summary>
+  void MarkDirty() { isDirty_ = true; }
+
+  bool IsDirty() const { return isDirty_; }
+
+  /// <summary>
+  /// 行列をまとめて更新する（変更されたものだけを4個ずつSIMDで合成）
+  /// 親を持つ場合は、親が配列内でより前にあるか更新済みである必要がある
+  /// </summary>
+  /// <param name="worldTransforms">ワールド変換データの配列</param>
+  /// <param name="count">要素数</param>
+  static void UpdateMatrices(WorldTransform* worldTransforms, size_t count);
+  /// <summary>
+  /// 行列をまとめて更新する（変更されたものだけを4個ずつSIMDで合成）
+  /// 親を持つ場合は、親が配列内でより前にあるか更新済みである必要がある
+  /// </summary>
+  /// <param name="worldTransforms">ワールド変換データへのポインタの配列</param>
+  /// <param name="count">要素数</param>
+  static void UpdateMatrices(WorldTransform* const* worldTransforms, size_t count);
 };
@@ -0,0 +1,18 @@
+#include "Basic.hlsli"
+
+// インスタンスごとのデータ
+struct InstanceData {
+  matrix world; // ワールド変換行列
+};
+
+StructuredBuffer<InstanceData> instances : register(t1); // 1番スロットに設定されたインスタンスデータ
+
+VSOutput main(
+    float4 pos : POSITION, float3 normal : NORMAL, float2 uv : TEXCOORD,
+    uint instanceId : SV_InstanceID) {
+  VSOutput output; // ピクセルシェーダーに渡す値
+  output.svpos = mul(mul(mul(projection, view), instances[instanceId].world), pos);
+  output.normal = normal;
+  output.uv = uv;
+  return output;
+}
\ No newline at end of file
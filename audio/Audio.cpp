@@ -1,16 +1,164 @@
 ﻿#include "Audio.h"
+#include "WaveParser.h"
 
+#include <algorithm>
 #include <cassert>
-#include <fstream>
+#include <chrono>
 #include <windows.h>
 
 #pragma comment(lib, "xaudio2.lib")
 
+namespace {
+
+// ストリーミング用スレッドがバッファの終わりを待つ最長時間（ミリ秒）
+const uint32_t kStreamPollMilliseconds = 10;
+
+/// <summary>
+/// XAudio2のソースボイス
+/// </summary>
+class XAudio2SourceVoice : public ISourceVoice {
+public:
+  /// <summary>
+  /// コンストラクタ
+  /// </summary>
+  /// <param name="sourceVoice">ソースボイス</param>
+  /// <param name="sourceChannels">波形のチャンネル数</param>
+  /// <param name="masterChannels">マスターボイスのチャンネル数</param>
+  XAudio2SourceVoice(
+    IXAudio2SourceVoice* sourceVoice, uint32_t sourceChannels, uint32_t masterChannels)
+    : sourceVoice_(sourceVoice), sourceChannels_(sourceChannels),
+      masterChannels_(masterChannels) {}
+
+  uint32_t GetQueuedBufferCount() override {
+	XAUDIO2_VOICE_STATE state;
+	sourceVoice_->GetState(&state, XAUDIO2_VOICE_NOSAMPLESPLAYED);
+	return state.BuffersQueued;
+  }
+
+  void SubmitBuffer(const uint8_t* data, uint32_t size, bool isEndOfStream) override {
+	XAUDIO2_BUFFER buf{};
+	buf.pAudioData = data;
+	buf.AudioBytes = size;
+	if (isEndOfStream) {
+	  buf.Flags = XAUDIO2_END_OF_STREAM;
+	  buf.pContext = context_;
+	}
+	HRESULT result = sourceVoice_->SubmitSourceBuffer(&buf);
+	assert(SUCCEEDED(result));
+  }
+
+  void SubmitLoopingBuffer(const uint8_t* data, uint32_t size) override {
+	XAUDIO2_BUFFER buf{};
+	buf.pAudioData = data;
+	buf.AudioBytes = size;
+	buf.Flags = XAUDIO2_END_OF_STREAM;
+	buf.pContext = context_;
+	// 無限ループ
+	buf.LoopCount = XAUDIO2_LOOP_INFINITE;
+	HRESULT result = sourceVoice_->SubmitSourceBuffer(&buf);
+	assert(SUCCEEDED(result));
+  }
+
+  void Start() override {
+	HRESULT result = sourceVoice_->Start();
+	assert(SUCCEEDED(result));
+  }
+
+  void Stop() override {
+	// 捨てたバッファの終了もコールバックに届くが、再生ハンドルの世代が古いので無視される
+	sourceVoice_->Stop();
+	sourceVoice_->FlushSourceBuffers();
+  }
+
+  void SetVolume(float volume) override {
+	HRESULT result = sourceVoice_->SetVolume(volume);
+	assert(SUCCEEDED(result));
+  }
+
+  void SetPan(float pan) override {
+	float gains[2];
+	ComputePanGains(pan, gains[0], gains[1]);
+
+	// 出力の左右に倍率を掛ける（モノラルは両方へ、ステレオは同じ側へ送る。それ以外の出力は無音）
+	std::vector<float> matrix(sourceChannels_ * masterChannels_, 0.0f);
+	for (uint32_t dst = 0; dst < masterChannels_ && dst < 2; dst++) {
+	  for (uint32_t src = 0; src < sourceChannels_; src++) {
+		if (sourceChannels_ == 1 || src == dst) {
+		  matrix[dst * sourceChannels_ + src] = gains[dst];
+		}
+	  }
+	}
+	HRESULT result =
+	  sourceVoice_->SetOutputMatrix(nullptr, sourceChannels_, masterChannels_, matrix.data());
+	assert(SUCCEEDED(result));
+  }
+
+  void SetContext(uint32_t context) override {
+	context_ = reinterpret_cast<void*>(static_cast<uintptr_t>(context));
+  }
+
+  void Destroy() override {
+	sourceVoice_->DestroyVoice();
+	delete this;
+  }
+
+private:
+  // ソースボイス
+  IXAudio2SourceVoice* sourceVoice_;
+  // 波形のチャンネル数
+  uint32_t sourceChannels_;
+  // マスターボイスのチャンネル数
+  uint32_t masterChannels_;
+  // 最後のバッファのコンテキスト（再生ハンドル）
+  void* context_ = nullptr;
+};
+
+/// <summary>
+/// XAudio2のソースボイスの生成元
+/// </summary>
+class XAudio2VoiceDevice : public IVoiceDevice {
+public:
+  /// <summary>
+  /// コンストラクタ
+  /// </summary>
+  /// <param name="xAudio2">XAudio2のインスタンス</param>
+  /// <param name="callback">オーディオコールバック</param>
+  /// <param name="masterChannels">マスターボイスのチャンネル数</param>
+  XAudio2VoiceDevice(IXAudio2* xAudio2, IXAudio2VoiceCallback* callback, uint32_t masterChannels)
+    : xAudio2_(xAudio2), callback_(callback), masterChannels_(masterChannels) {}
+
+  ISourceVoice* CreateSourceVoice(const uint8_t* formatData) override {
+	// 波形フォーマットを元にSourceVoiceの生成
+	IXAudio2SourceVoice* pSourceVoice = nullptr;
+	HRESULT result = xAudio2_->CreateSourceVoice(
+	  &pSourceVoice, reinterpret_cast<const WAVEFORMATEX*>(formatData), 0, 2.0f, callback_);
+	if (FAILED(result)) {
+	  return nullptr;
+	}
+	const WAVEFORMATEX* wfex = reinterpret_cast<const WAVEFORMATEX*>(formatData);
+	return new XAudio2SourceVoice(pSourceVoice, wfex->nChannels, masterChannels_);
+  }
+
+private:
+  // XAudio2のインスタンス
+  IXAudio2* xAudio2_;
+  // オーディオコールバック
+  IXAudio2VoiceCallback* callback_;
+  // マスターボイスのチャンネル数
+  uint32_t masterChannels_;
+};
+
+} // namespace
+
 void Audio::XAudio2VoiceCallback::OnBufferEnd(THIS_ void* pBufferContext) {
 
-	Voice* voice = reinterpret_cast<Voice*>(pBufferContext);
-	// 再生リストから除外
-  Audio::GetInstance()->voices_.erase(voice);
+  // 最後のバッファ以外はコンテキストが無い
+  if (pBufferContext) {
+	uint32_t voiceHandle = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(pBufferContext));
+	Audio::GetInstance()->NotifyVoiceEnd(voiceHandle);
+  }
+  // ストリーミング用スレッドに空いたバッファを補充させる
+  Audio::GetInstance()->streamCondition_.notify_one();
 }
 
 Audio* Audio::GetInstance() {
@@ -19,108 +167,126 @@ Audio* Audio::GetInstance() {
   return &instance;
 }
 
-void Audio::Initialize(const std::string& directoryPath) {
+void Audio::Initialize(const std::string& directoryPath, Backend backend) {
   directoryPath_ = directoryPath;
 
-  HRESULT result;
-  IXAudio2MasteringVoice* masterVoice;
-
-  // XAudioエンジンのインスタンスを生成
-  result = XAudio2Create(&xAudio2_, 0, XAUDIO2_DEFAULT_PROCESSOR);
-  assert(SUCCEEDED(result));
+  indexSoundData_ = 0u;
+  soundDataHandles_.clear();
+
+  if (backend == Backend::kXAudio2) {
+	HRESULT result;
+	IXAudio2MasteringVoice* masterVoice;
+
+	// XAudioエンジンのインスタンスを生成
+	result = XAudio2Create(&xAudio2_, 0, XAUDIO2_DEFAULT_PROCESSOR);
+	assert(SUCCEEDED(result));
+
+	// マスターボイスを生成
+	result = xAudio2_->CreateMasteringVoice(&masterVoice);
+	assert(SUCCEEDED(result));
+
+	// 定位はマスターボイスのチャンネル数に合わせて出力行列で付ける
+	XAUDIO2_VOICE_DETAILS masterDetails;
+	masterVoice->GetVoiceDetails(&masterDetails);
+	voiceDevice_ = std::make_unique<XAudio2VoiceDevice>(
+	  xAudio2_.Get(), &voiceCallback_, masterDetails.InputChannels);
+  } else {
+	// サウンドデバイスを使わず、Updateのたびに一定フレーム数を混ぜる
+	std::unique_ptr<SoftwareMixer> softwareMixer = std::make_unique<SoftwareMixer>();
+	softwareMixer->SetEndCallback([this](uint32_t voiceHandle) {
+	  NotifyVoiceEnd(voiceHandle);
+	  streamCondition_.notify_one();
+	});
+	softwareMixer_ = softwareMixer.get();
+	voiceDevice_ = std::move(softwareMixer);
+	mixBuffer_.assign(kSoftwareFramesPerUpdate * SoftwareMixer::kChannels, 0.0f);
+  }
 
-  // マスターボイスを生成
-  result = xAudio2_->CreateMasteringVoice(&masterVoice);
-  assert(SUCCEEDED(result));
+  // ソースボイスのプールを初期化
+  voicePool_.Initialize(voiceDevice_.get());
+  finishedVoices_.Initialize(kFinishedQueueSize);
+  isFinishedOverflowed_ = false;
+  releaseVoices_.reserve(voicePool_.GetMaxVoices());
 
-  indexSoundData_ = 0u;
-  indexVoice_ = 0u;
+  // ストリーミング用スレッドを開始
+  isStreamThreadStopping_ = false;
+  streamThread_ = std::thread(&Audio::StreamMain, this);
 }
 
 void Audio::Finalize() {
+  // ストリーミング用スレッドを止めてからボイスを破棄する
+  {
+	std::lock_guard<std::mutex> lock(streamMutex_);
+	isStreamThreadStopping_ = true;
+  }
+  streamCondition_.notify_one();
+  if (streamThread_.joinable()) {
+	streamThread_.join();
+  }
+  // 全てのソースボイスを破棄してからストリーミングのバッファを手放す
+  voicePool_.Finalize();
+  voiceDevice_.reset();
+  softwareMixer_ = nullptr;
+  streams_.clear();
+  finishedStreams_.clear();
+  StopCapture();
+
   // XAudio2解放
   xAudio2_.Reset();
   // 音声データ解放
   for (auto& soundData : soundDatas_) {
 	Unload(&soundData);
   }
+  soundDataHandles_.clear();
+  // 音声データが指していたサウンドバンクを閉じる
+  soundBank_.Close();
+}
+
+bool Audio::LoadBank(const std::string& fileName) {
+  return soundBank_.Open(directoryPath_ + fileName);
 }
 
 uint32_t Audio::LoadWave(const std::string& fileName) {
   assert(indexSoundData_ < kMaxSoundData);
   uint32_t handle = indexSoundData_;
   // 読み込み済みサウンドデータを検索
-  auto it = std::find_if(soundDatas_.begin(), soundDatas_.end(), [&](const auto& soundData) {
-	return soundData.name == fileName;
-  });
-  if (it != soundDatas_.end()) {
+  auto it = soundDataHandles_.find(fileName);
+  if (it != soundDataHandles_.end()) {
 	// 読み込み済みサウンドデータの要素番号を取得
-	handle = static_cast<uint32_t>(std::distance(soundDatas_.begin(), it));
-	return handle;
-  }  
-
-  // ディレクトリパスとファイル名を連結してフルパスを得る
-  std::string fullpath = directoryPath_ + fileName;
-
-  // ファイル入力ストリームのインスタンス
-  std::ifstream file;
-  // .wavファイルをバイナリモードで開く
-  file.open(fullpath, std::ios_base::binary);
-  // ファイルオープン失敗を検出する
-  assert(file.is_open());
-
-  // RIFFヘッダーの読み込み
-  RiffHeader riff;
-  file.read((char*)&riff, sizeof(riff));
-  // ファイルがRIFFかチェック
-  if (strncmp(riff.chunk.id, "RIFF", 4) != 0) {
-	assert(0);
-  }
-  // タイプがWAVEかチェック
-  if (strncmp(riff.type, "WAVE", 4) != 0) {
-	assert(0);
+	return it->second;
   }
 
-  // Formatチャンクの読み込み
-  FormatChunk format = {};
-  // チャンクヘッダーの確認
-  file.read((char*)&format, sizeof(ChunkHeader));
-  if (strncmp(format.chunk.id, "fmt ", 4) != 0) {
-	assert(0);
-  }
-  // チャンク本体の読み込み
-  assert(format.chunk.size <= sizeof(format.fmt));
-  file.read((char*)&format.fmt, format.chunk.size);
+  // 書き込むサウンドデータの参照
+  SoundData& soundData = soundDatas_.at(handle);
 
-  // Dataチャンクの読み込み
-  ChunkHeader data;
-  file.read((char*)&data, sizeof(data));
-  // JUNKチャンクを検出した場合
-  if (strncmp(data.id, "JUNK ", 4) == 0) {
-	// 読み取り位置をJUNKチャンクの終わりまで進める
-	file.seekg(data.size, std::ios_base::cur);
-	// 再読み込み
-	file.read((char*)&data, sizeof(data));
+  // サウンドバンクに入っていて元のWAVから変わっていなければ、ファイルを開かずにバンクの中を指す
+  WaveData waveData;
+  if (
+    !soundBank_.Find(fileName, waveData) ||
+    soundBank_.IsStale(fileName, directoryPath_ + fileName)) {
+	// ディレクトリパスとファイル名を連結してフルパスを得る
+	std::string fullpath = directoryPath_ + fileName;
+
+	// .wavファイルをマップする（ファイルオープン失敗を検出する）
+	bool isOpened = soundData.file.Open(fullpath);
+	assert(isOpened);
+
+	// チャンクをたどってfmtとdataを探す（LIST・factなど他のチャンクは飛ばす）
+	bool isParsed =
+	  WaveParser::Parse(soundData.file.GetData(), soundData.file.GetSize(), waveData);
+	assert(isParsed);
   }
 
-  if (strncmp(data.id, "data ", 4) != 0) {
-	assert(0);
+  // 波形フォーマットは境界に揃っているとは限らないのでコピーし、PCMの16バイトでも渡せるようにする
+  soundData.format.assign(waveData.format, waveData.format + waveData.formatSize);
+  if (soundData.format.size() < WaveParser::kWaveFormatExSize) {
+	soundData.format.resize(WaveParser::kWaveFormatExSize, 0);
   }
-
-  // Dataチャンクのデータ部（波形データ）の読み込み
-  char* pBuffer = new char[data.size];
-  file.read(pBuffer, data.size);
-
-  // Waveファイルを閉じる
-  file.close();
-
-  // 書き込むサウンドデータの参照
-  SoundData& soundData = soundDatas_.at(handle);
-
-  soundData.wfex = format.fmt;
-  soundData.pBuffer = reinterpret_cast<BYTE*>(pBuffer);
-  soundData.bufferSize = data.size;
+  // 波形データはマップしたファイルかサウンドバンクの中を指す
+  soundData.pBuffer = waveData.samples;
+  soundData.bufferSize = waveData.samplesSize;
   soundData.name = fileName;
+  soundDataHandles_[fileName] = handle;
 
   indexSoundData_++;
 
@@ -128,68 +294,207 @@ uint32_t Audio::LoadWave(const std::string& fileName) {
 }
 
 void Audio::Unload(SoundData* soundData) {
-  // バッファのメモリを解放
-  delete[] soundData->pBuffer;
+  // ファイルのマップを解除
+  soundData->file.Close();
 
-  soundData->pBuffer = 0;
+  soundData->pBuffer = nullptr;
   soundData->bufferSize = 0;
-  soundData->wfex = {};
+  soundData->format.clear();
+}
+
+void Audio::Update() {
+  // ソフトウェアミキサーは呼ばれた回数だけ時間を進める（再生終了の通知もここで届く）
+  if (softwareMixer_) {
+	softwareMixer_->Render(mixBuffer_.data(), kSoftwareFramesPerUpdate);
+	captureWriter_.Write(mixBuffer_.data(), kSoftwareFramesPerUpdate);
+  }
+
+  ReleaseFinishedVoices();
 }
 
-uint32_t Audio::PlayWave(uint32_t soundDataHandle, bool loopFlag) {
-  HRESULT result;
+void Audio::ReleaseFinishedVoices() {
+  releaseVoices_.clear();
+
+  // 通知を捨てていたら、バッファが残っていない再生を全て終了したものとして扱う
+  if (isFinishedOverflowed_.exchange(false)) {
+	voicePool_.CollectFinished(releaseVoices_);
+  }
+  uint32_t voiceHandle;
+  while (finishedVoices_.TryPop(voiceHandle)) {
+	releaseVoices_.push_back(voiceHandle);
+  }
+
+  {
+	std::lock_guard<std::mutex> lock(streamMutex_);
+	// ストリーミング再生はバッファを全て使い終えるまでストリーミング用スレッドが持つ
+	releaseVoices_.erase(
+	  std::remove_if(
+	    releaseVoices_.begin(), releaseVoices_.end(),
+	    [this](uint32_t handle) { return streams_.count(handle) != 0; }),
+	  releaseVoices_.end());
+	releaseVoices_.insert(releaseVoices_.end(), finishedStreams_.begin(), finishedStreams_.end());
+	finishedStreams_.clear();
+  }
+
+  // 再生し終えたソースボイスをプールに戻す（既に戻したハンドルは世代が古いので無視される）
+  for (uint32_t handle : releaseVoices_) {
+	voicePool_.Release(handle);
+  }
+}
 
-  assert(soundDataHandle <= soundDatas_.size());
+uint32_t Audio::PlayWave(uint32_t soundDataHandle, bool loopFlag, int32_t priority) {
+  assert(soundDataHandle < soundDatas_.size());
 
   // サウンドデータの参照を取得
   SoundData& soundData = soundDatas_.at(soundDataHandle);
   // 未読み込みの検出
   assert(soundData.bufferSize != 0);
-    
-  uint32_t handle = indexVoice_;
-
-  // 波形フォーマットを元にSourceVoiceの生成
-  IXAudio2SourceVoice* pSourceVoice = nullptr;
-  result = xAudio2_->CreateSourceVoice(&pSourceVoice, &soundData.wfex, 0, 2.0f, &voiceCallback_);
-  assert(SUCCEEDED(result));
-
-    // 再生中データ
-  Voice* voice = new Voice();
-  voice->handle = handle;
-  voice->sourceVoice = pSourceVoice;
-  // 再生中データコンテナに登録
-  voices_.insert(voice);
-
-  // 再生する波形データの設定
-  XAUDIO2_BUFFER buf{};
-  buf.pAudioData = soundData.pBuffer;
-  buf.pContext = voice;
-  buf.AudioBytes = soundData.bufferSize;
-  buf.Flags = XAUDIO2_END_OF_STREAM;
-  if (loopFlag) {
-	// 無限ループ
-	buf.LoopCount = XAUDIO2_LOOP_INFINITE;
+
+  // 再生し終えたソースボイスを先にプールへ戻す
+  ReleaseFinishedVoices();
+
+  // 同じ波形フォーマットの待機中のソースボイスを使い回す
+  uint32_t handle = voicePool_.Acquire(soundData.format.data(), priority);
+  if (handle == VoicePool::kInvalidHandle) {
+	// 優先度の高い再生で埋まっている
+	return handle;
   }
+  ISourceVoice* voice = voicePool_.GetVoice(handle);
 
   // 波形データの再生
-  result = pSourceVoice->SubmitSourceBuffer(&buf);
-  result = pSourceVoice->Start();
+  if (loopFlag) {
+	voice->SubmitLoopingBuffer(soundData.pBuffer, soundData.bufferSize);
+  } else {
+	voice->SubmitBuffer(soundData.pBuffer, soundData.bufferSize, true);
+  }
+  voice->Start();
+
+  return handle;
+}
 
-  indexVoice_++;
+uint32_t Audio::PlayStream(const std::string& fileName, bool loopFlag) {
+  // ファイルを開いて波形データの位置を調べる（波形データはまだ読まない）
+  std::unique_ptr<WaveStream> stream = std::make_unique<WaveStream>();
+  // 開けない・対応していない形式なら再生しない
+  if (!stream->Open(directoryPath_ + fileName)) {
+	assert(0);
+	return VoicePool::kInvalidHandle;
+  }
+  stream->SetLoop(loopFlag);
+
+  // 再生し終えたソースボイスを先にプールへ戻す
+  ReleaseFinishedVoices();
+
+  // ストリーミング再生は他の再生に止められない優先度で確保する
+  uint32_t handle = voicePool_.Acquire(stream->GetFormatData(), kStreamPriority);
+  if (handle == VoicePool::kInvalidHandle) {
+	return handle;
+  }
+  ISourceVoice* voice = voicePool_.GetVoice(handle);
+
+  // 最初のバッファを埋めてから再生を始める（まだ共有していないので排他制御の外で読む）
+  bool isStreaming = stream->Pump(*voice);
+  voice->Start();
+
+  {
+	std::lock_guard<std::mutex> lock(streamMutex_);
+
+	// 続きはストリーミング用スレッドが読み込む
+	StreamPlayback& playback = streams_[handle];
+	playback.stream = std::move(stream);
+	playback.voice = voice;
+	playback.isStreaming = isStreaming;
+  }
 
   return handle;
 }
 
-void Audio::StopWave(uint32_t voiceHandle) { 
-  
-	// 再生中リストから検索
-	auto it = std::find_if(
-    voices_.begin(), voices_.end(), [&](Voice* voice) { return voice->handle == voiceHandle;
-  });
-	// 発見
-  if (it != voices_.end()) {
-	  (*it)->sourceVoice->DestroyVoice();
+void Audio::StreamMain() {
+  std::unique_lock<std::mutex> lock(streamMutex_);
+  while (!isStreamThreadStopping_) {
+	// 読み込む再生を選ぶ（要素を消すのはこのスレッドだけなので、排他制御を外しても指したまま使える）
+	pumpingStreams_.clear();
+	for (auto& pair : streams_) {
+	  if (!pair.second.isStopping && pair.second.isStreaming) {
+		pumpingStreams_.push_back(&pair.second);
+	  }
+	}
+
+	// 再生し終えたバッファに続きを読み込む（ファイルの読み込みでゲームスレッドを待たせない）
+	lock.unlock();
+	for (StreamPlayback* playback : pumpingStreams_) {
+	  playback->isStreaming = playback->stream->Pump(*playback->voice);
+	}
+	lock.lock();
+
+	// 読み込み中に停止要求が来ていたら、その間に送ったバッファも捨てる
+	for (StreamPlayback* playback : pumpingStreams_) {
+	  if (playback->isStopping) {
+		playback->voice->Stop();
+	  }
+	}
+
+	for (auto it = streams_.begin(); it != streams_.end();) {
+	  StreamPlayback& playback = it->second;
+
+	  bool isStreaming = !playback.isStopping && playback.isStreaming;
+	  if (isStreaming || playback.voice->GetQueuedBufferCount() > 0) {
+		++it;
+		continue;
+	  }
+
+	  // バッファが全て使われなくなったら手放し、ソースボイスはゲームスレッドでプールに戻す
+	  finishedStreams_.push_back(it->first);
+	  it = streams_.erase(it);
+	}
+
+	// バッファの再生が終わるか、一定時間経つまで待つ
+	streamCondition_.wait_for(lock, std::chrono::milliseconds(kStreamPollMilliseconds));
+  }
+}
+
+void Audio::NotifyVoiceEnd(uint32_t voiceHandle) {
+  // オーディオスレッドは待たせられないので、満杯なら捨ててUpdateで取りこぼしを拾う
+  if (!finishedVoices_.TryPush(voiceHandle)) {
+	isFinishedOverflowed_ = true;
+  }
+}
+
+void Audio::SetVolume(uint32_t voiceHandle, float volume) {
+  ISourceVoice* voice = voicePool_.GetVoice(voiceHandle);
+  if (voice) {
+	voice->SetVolume(volume);
+  }
+}
+
+void Audio::SetPan(uint32_t voiceHandle, float pan) {
+  ISourceVoice* voice = voicePool_.GetVoice(voiceHandle);
+  if (voice) {
+	voice->SetPan(pan);
+  }
+}
+
+bool Audio::StartCapture(const std::string& filePath) {
+  // 書き出せるのはソフトウェアミキサーの出力のみ
+  assert(softwareMixer_);
+  return captureWriter_.Open(
+    filePath, softwareMixer_->GetSampleRate(), static_cast<uint16_t>(SoftwareMixer::kChannels));
+}
 
-	  voices_.erase(it);
+void Audio::StopCapture() { captureWriter_.Close(); }
+
+void Audio::StopWave(uint32_t voiceHandle) {
+  {
+	// ストリーミング再生なら、バッファが全て捨てられてから手放すようにする
+	std::lock_guard<std::mutex> lock(streamMutex_);
+	auto it = streams_.find(voiceHandle);
+	if (it != streams_.end()) {
+	  it->second.voice->Stop();
+	  it->second.isStopping = true;
+	  return;
+	}
   }
+
+  // 止めてプールに戻す（再生し終えていれば何もしない）
+  voicePool_.Release(voiceHandle);
 }
@@ -1,56 +1,77 @@
 ﻿#pragma once
 
+#include "MappedFile.h"
+#include "SoftwareMixer.h"
+#include "SoundBank.h"
+#include "SpscQueue.h"
+#include "VoicePool.h"
+#include "WaveStream.h"
+#include "WaveWriter.h"
 #include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #include <wrl.h>
 #include <xaudio2.h>
 #include <unordered_map>
-#include <set>
 
 /// <summary>
 /// オーディオ
+/// ソースボイスはプールで使い回し、再生終了はコールバックから受け取ってUpdateでプールに戻す
+/// 再生終了の通知はロックフリーのキューで渡し、オーディオスレッドを待たせない
+/// バックエンドはXAudio2かソフトウェアミキサーを選べる（ソフトウェアミキサーはサウンドデバイス不要）
 /// </summary>
 class Audio {
 public:
 
   // サウンドデータの最大数
   static const int kMaxSoundData = 256;
+  // 効果音の標準の優先度
+  static const int32_t kDefaultPriority = 0;
+  // ストリーミング再生の優先度（他の再生に止められない）
+  static const int32_t kStreamPriority = INT32_MAX;
+  // 再生終了の通知キューの容量（2のべき乗。Update1回までに終わる再生数より十分大きくする）
+  static const size_t kFinishedQueueSize = 256;
+  // ソフトウェアミキサーがUpdate1回で進めるフレーム数（60fpsで実時間と同じ速さ）
+  static const uint32_t kSoftwareFramesPerUpdate = SoftwareMixer::kDefaultSampleRate / 60;
 
-  // チャンクヘッダ
-  struct ChunkHeader {
-	char id[4];	  // チャンク毎のID
-	int32_t size; // チャンクサイズ
-  };
-
-  // RIFFヘッダチャンク
-  struct RiffHeader {
-	ChunkHeader chunk; // "RIFF"
-	char type[4];	   // "WAVE"
-  };
-
-  // FMTチャンク
-  struct FormatChunk {
-	ChunkHeader chunk; // "fmt "
-	WAVEFORMATEX fmt;  // 波形フォーマット
+  /// <summary>
+  /// バックエンド
+  /// </summary>
+  enum class Backend {
+	kXAudio2,  // サウンドデバイスに出力する
+	kSoftware, // ソフトウェアで混ぜる（サーバーや自動テスト用。WAVファイルに書き出せる）
   };
 
   // 音声データ
   struct SoundData {
-	// 波形フォーマット
-	WAVEFORMATEX wfex;
+	// マップしたWAVファイル（波形データはコピーせずにこの中を指す）
+	MappedFile file;
+	// 波形フォーマット（fmtチャンクの本体。WAVEFORMATEXとして渡せるように18バイト以上）
+	std::vector<uint8_t> format;
 	// バッファの先頭アドレス
-	BYTE* pBuffer;
+	const BYTE* pBuffer = nullptr;
 	// バッファのサイズ
-	unsigned int bufferSize;
+	unsigned int bufferSize = 0;
 	// 名前
 	std::string name;
   };
 
-  // 再生データ
-  struct Voice {
-	uint32_t handle = 0u;
-	IXAudio2SourceVoice* sourceVoice = nullptr;
+  // ストリーミング再生データ
+  struct StreamPlayback {
+	// 読み込み中のファイル
+	std::unique_ptr<WaveStream> stream;
+	// ソースボイス
+	ISourceVoice* voice = nullptr;
+	// 停止要求（バッファが全て捨てられるのを待っている）
+	bool isStopping = false;
+	// ファイルの続きがあるか（ストリーミング用スレッドだけが触る）
+	bool isStreaming = true;
   };
 
   /// <summary>
@@ -79,7 +100,10 @@ public:
   /// <summary>
   /// 初期化
   /// </summary>
-  void Initialize(const std::string& directoryPath = "Resources/");
+  /// <param name="directoryPath">サウンド格納ディレクトリ</param>
+  /// <param name="backend">バックエンド</param>
+  void Initialize(
+    const std::string& directoryPath = "Resources/", Backend backend = Backend::kXAudio2);
 
   /// <summary>
   /// 終了処理
@@ -87,7 +111,19 @@ public:
   void Finalize();
 
   /// <summary>
-  /// WAV音声読み込み
+  /// 毎フレーム処理（再生し終えたソースボイスをプールに戻す。ソフトウェアミキサーはここで混ぜる）
+  /// </summary>
+  void Update();
+
+  /// <summary>
+  /// サウンドバンクを開く（以後のLoadWaveはバンクに入っていればファイルを開かずに済む）
+  /// </summary>
+  /// <param name="fileName">サウンドバンクのファイル名</param>
+  /// <returns>成否</returns>
+  bool LoadBank(const std::string& fileName = SoundBank::kDefaultFileName);
+
+  /// <summary>
+  /// WAV音声読み込み（サウンドバンクに無ければファイルから読む）
   /// </summary>
   /// <param name="filename">WAVファイル名</param>
   /// <returns>サウンドデータハンドル</returns>
@@ -104,8 +140,18 @@ public:
   /// </summary>
   /// <param name="soundDataHandle">サウンドデータハンドル</param>
   /// <param name="loopFlag">ループ再生フラグ</param>
-  /// <returns>再生ハンドル</returns>
-  uint32_t PlayWave(uint32_t soundDataHandle, bool loopFlag = false);
+  /// <param name="priority">優先度（同時再生数の上限に達したら、これより低い再生を止めて鳴らす）</param>
+  /// <returns>再生ハンドル（鳴らせなければVoicePool::kInvalidHandle）</returns>
+  uint32_t PlayWave(
+    uint32_t soundDataHandle, bool loopFlag = false, int32_t priority = kDefaultPriority);
+
+  /// <summary>
+  /// ストリーミング再生（ファイルを少しずつ読みながら再生する。長いBGM向け）
+  /// </summary>
+  /// <param name="filename">WAVファイル名</param>
+  /// <param name="loopFlag">ループ再生フラグ</param>
+  /// <returns>再生ハンドル（StopWaveで停止できる。開けなければVoicePool::kInvalidHandle）</returns>
+  uint32_t PlayStream(const std::string& filename, bool loopFlag = false);
 
   /// <summary>
   /// 音声停止
@@ -113,25 +159,106 @@ public:
   /// <param name="voiceHandle">再生ハンドル</param>
   void StopWave(uint32_t voiceHandle);
 
+  /// <summary>
+  /// 音量の設定（再生し終えていれば何もしない）
+  /// </summary>
+  /// <param name="voiceHandle">再生ハンドル</param>
+  /// <param name="volume">音量（1で元の大きさ）</param>
+  void SetVolume(uint32_t voiceHandle, float volume);
+
+  /// <summary>
+  /// 左右の定位の設定（再生し終えていれば何もしない）
+  /// </summary>
+  /// <param name="voiceHandle">再生ハンドル</param>
+  /// <param name="pan">定位（-1で左のみ、0で中央、1で右のみ）</param>
+  void SetPan(uint32_t voiceHandle, float pan);
+
+  /// <summary>
+  /// ソフトウェアミキサーの出力のWAVファイルへの書き出しを始める
+  /// </summary>
+  /// <param name="filePath">ファイルパス</param>
+  /// <returns>成否</returns>
+  bool StartCapture(const std::string& filePath);
+
+  /// <summary>
+  /// WAVファイルへの書き出しを終える
+  /// </summary>
+  void StopCapture();
+
+  // ソフトウェアミキサー（XAudio2を使っていればnullptr）
+  SoftwareMixer* GetSoftwareMixer() const { return softwareMixer_; }
+
+  /// <summary>
+  /// 再生中か
+  /// </summary>
+  /// <param name="voiceHandle">再生ハンドル</param>
+  /// <returns>再生中ならtrue（再生終了はUpdateで反映される）</returns>
+  bool IsPlaying(uint32_t voiceHandle) const { return voicePool_.IsValid(voiceHandle); }
+
 private:
   Audio() = default;
   ~Audio() = default;
   Audio(const Audio&) = delete;
   const Audio& operator=(const Audio&) = delete;
 
+  /// <summary>
+  /// ストリーミング用スレッドの本体（再生し終えたバッファに続きを読み込む）
+  /// </summary>
+  void StreamMain();
+
+  /// <summary>
+  /// 再生終了の通知（オーディオスレッドから呼ばれる）
+  /// </summary>
+  /// <param name="voiceHandle">再生ハンドル</param>
+  void NotifyVoiceEnd(uint32_t voiceHandle);
+
+  /// <summary>
+  /// 再生し終えたソースボイスをプールに戻す
+  /// </summary>
+  void ReleaseFinishedVoices();
+
   // XAudio2のインスタンス
   Microsoft::WRL::ComPtr<IXAudio2> xAudio2_;
   // サウンドデータコンテナ
   std::array<SoundData, kMaxSoundData> soundDatas_;
-  // 再生中データコンテナ
-  //std::unordered_map<uint32_t, IXAudio2SourceVoice*> voices_;
-  std::set<Voice*> voices_;
+  // 読み込み済みサウンドデータのハンドル（ファイル名がキー）
+  std::unordered_map<std::string, uint32_t> soundDataHandles_;
+  // サウンドバンク
+  SoundBank soundBank_;
+  // ソースボイスの生成元
+  std::unique_ptr<IVoiceDevice> voiceDevice_;
+  // ソフトウェアミキサー（voiceDevice_が持つ。XAudio2を使っていればnullptr）
+  SoftwareMixer* softwareMixer_ = nullptr;
+  // ソフトウェアミキサーの出力先
+  std::vector<float> mixBuffer_;
+  // ソフトウェアミキサーの出力の書き出し先
+  WaveWriter captureWriter_;
+  // ソースボイスのプール
+  VoicePool voicePool_;
+  // 再生を終えた再生ハンドル（オーディオスレッドが書き込み、ゲームスレッドが読み出す）
+  SpscQueue<uint32_t> finishedVoices_;
+  // 通知キューが満杯で通知を捨てたか
+  std::atomic<bool> isFinishedOverflowed_{false};
+  // プールに戻す再生ハンドル（Updateの作業用）
+  std::vector<uint32_t> releaseVoices_;
   // サウンド格納ディレクトリ
   std::string directoryPath_;
   // 次に使うサウンドデータの番号
   uint32_t indexSoundData_ = 0u;
-  // 次に使う再生中データの番号
-  uint32_t indexVoice_ = 0u;
   // オーディオコールバック
   XAudio2VoiceCallback voiceCallback_;
+  // ストリーミング再生中データ（再生ハンドルがキー）
+  std::unordered_map<uint32_t, StreamPlayback> streams_;
+  // バッファを全て使い終えたストリーミング再生の再生ハンドル
+  std::vector<uint32_t> finishedStreams_;
+  // ストリーミング再生中データの排他制御
+  std::mutex streamMutex_;
+  // バッファの再生が終わった通知
+  std::condition_variable streamCondition_;
+  // ストリーミング用スレッド
+  std::thread streamThread_;
+  // ストリーミング用スレッドの終了要求
+  bool isStreamThreadStopping_ = false;
+  // 排他制御を外して読み込む再生（ストリーミング用スレッドの作業用）
+  std::vector<StreamPlayback*> pumpingStreams_;
 };
@@ -0,0 +1,450 @@
+﻿#include "SoftwareMixer.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <xmmintrin.h>
+
+namespace {
+
+// WAVEFORMATEXの各メンバの位置
+const size_t kFormatTagOffset = 0;
+const size_t kChannelsOffset = 2;
+const size_t kSamplesPerSecOffset = 4;
+const size_t kBlockAlignOffset = 12;
+const size_t kBitsPerSampleOffset = 14;
+const size_t kExtraSizeOffset = 16;
+// WAVEFORMATEXTENSIBLEのサブフォーマットの位置
+const size_t kSubFormatOffset = 24;
+// 波形フォーマットの種類
+const uint16_t kFormatTagPcm = 1;
+const uint16_t kFormatTagFloat = 3;
+const uint16_t kFormatTagExtensible = 0xFFFE;
+// 再生位置の小数部のビット数
+const uint32_t kFractionBits = 32;
+// 再生位置の小数部のマスク
+const uint64_t kFractionMask = (1ull << kFractionBits) - 1;
+
+/// <summary>
+/// 位置を指定して読み出す（境界に揃っていなくてもよい）
+/// </summary>
+template<typename T> T ReadAt(const uint8_t* data, size_t offset) {
+  T value;
+  std::memcpy(&value, data + offset, sizeof(value));
+  return value;
+}
+
+/// <summary>
+/// 波形の1サンプルの形式
+/// </summary>
+enum class SampleFormat {
+  kUnsupported,
+  kPcm8,
+  kPcm16,
+  kPcm24,
+  kPcm32,
+  kFloat32,
+};
+
+// 1サンプルを-1～1の浮動小数点に変換する（形式ごとにインライン展開させるため構造体にする）
+struct Pcm8Reader {
+  static float Read(const uint8_t* data) {
+	return (static_cast<float>(data[0]) - 128.0f) / 128.0f;
+  }
+};
+
+struct Pcm16Reader {
+  static float Read(const uint8_t* data) {
+	return static_cast<float>(ReadAt<int16_t>(data, 0)) / 32768.0f;
+  }
+};
+
+struct Pcm24Reader {
+  static float Read(const uint8_t* data) {
+	// 上位バイトに寄せて符号を付ける
+	int32_t value = static_cast<int32_t>(
+	  (static_cast<uint32_t>(data[0]) << 8) | (static_cast<uint32_t>(data[1]) << 16) |
+	  (static_cast<uint32_t>(data[2]) << 24));
+	return static_cast<float>(value) / 2147483648.0f;
+  }
+};
+
+struct Pcm32Reader {
+  static float Read(const uint8_t* data) {
+	return static_cast<float>(ReadAt<int32_t>(data, 0)) / 2147483648.0f;
+  }
+};
+
+struct Float32Reader {
+  static float Read(const uint8_t* data) { return ReadAt<float>(data, 0); }
+};
+
+/// <summary>
+/// 波形フォーマットから1サンプルの形式を調べる
+/// </summary>
+/// <param name="formatData">波形フォーマット</param>
+/// <returns>形式（対応していなければkUnsupported）</returns>
+SampleFormat GetSampleFormat(const uint8_t* formatData) {
+  uint16_t formatTag = ReadAt<uint16_t>(formatData, kFormatTagOffset);
+  uint16_t channels = ReadAt<uint16_t>(formatData, kChannelsOffset);
+  uint16_t blockAlign = ReadAt<uint16_t>(formatData, kBlockAlignOffset);
+  uint16_t bitsPerSample = ReadAt<uint16_t>(formatData, kBitsPerSampleOffset);
+  if (channels < 1 || channels > SoftwareMixer::kChannels) {
+	return SampleFormat::kUnsupported;
+  }
+  if (blockAlign != channels * bitsPerSample / 8) {
+	return SampleFormat::kUnsupported;
+  }
+
+  // WAVE_FORMAT_EXTENSIBLEはサブフォーマットの先頭がPCMか浮動小数点かを表す
+  if (formatTag == kFormatTagExtensible) {
+	if (ReadAt<uint16_t>(formatData, kExtraSizeOffset) < kSubFormatOffset - kExtraSizeOffset) {
+	  return SampleFormat::kUnsupported;
+	}
+	formatTag = static_cast<uint16_t>(ReadAt<uint32_t>(formatData, kSubFormatOffset));
+  }
+
+  if (formatTag == kFormatTagPcm) {
+	switch (bitsPerSample) {
+	case 8:
+	  return SampleFormat::kPcm8;
+	case 16:
+	  return SampleFormat::kPcm16;
+	case 24:
+	  return SampleFormat::kPcm24;
+	case 32:
+	  return SampleFormat::kPcm32;
+	}
+  }
+  if (formatTag == kFormatTagFloat && bitsPerSample == 32) {
+	return SampleFormat::kFloat32;
+  }
+  return SampleFormat::kUnsupported;
+}
+
+/// <summary>
+/// 音量を掛けて出力に足す（左右交互のステレオ）
+/// </summary>
+/// <param name="output">出力先</param>
+/// <param name="source">足す波形</param>
+/// <param name="frameCount">フレーム数</param>
+/// <param name="left">左の倍率</param>
+/// <param name="right">右の倍率</param>
+void MixScaled(float* output, const float* source, uint32_t frameCount, float left, float right) {
+  // 2フレーム（4サンプル）ずつまとめて足す
+  const __m128 gain = _mm_setr_ps(left, right, left, right);
+  uint32_t count = frameCount * SoftwareMixer::kChannels;
+  uint32_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+	__m128 mixed = _mm_add_ps(_mm_loadu_ps(output + i), _mm_mul_ps(_mm_loadu_ps(source + i), gain));
+	_mm_storeu_ps(output + i, mixed);
+  }
+  for (; i < count; i += 2) {
+	output[i] += source[i] * left;
+	output[i + 1] += source[i + 1] * right;
+  }
+}
+
+} // namespace
+
+/// <summary>
+/// ソフトウェアミキサーのソースボイス
+/// 操作はミキサーの排他制御の中で行うので、Renderと別のスレッドから呼んでよい
+/// </summary>
+class SoftwareMixer::Voice : public ISourceVoice {
+public:
+  /// <summary>
+  /// コンストラクタ
+  /// </summary>
+  /// <param name="mixer">生成元</param>
+  /// <param name="formatData">波形フォーマット</param>
+  /// <param name="sampleFormat">1サンプルの形式</param>
+  Voice(SoftwareMixer* mixer, const uint8_t* formatData, SampleFormat sampleFormat)
+    : mixer_(mixer) {
+	channels_ = ReadAt<uint16_t>(formatData, kChannelsOffset);
+	blockAlign_ = ReadAt<uint16_t>(formatData, kBlockAlignOffset);
+	bytesPerSample_ = blockAlign_ / channels_;
+	// 1出力フレームで進む元のフレーム数（小数部32bitの固定小数点）
+	uint32_t samplesPerSec = ReadAt<uint32_t>(formatData, kSamplesPerSecOffset);
+	step_ = (static_cast<uint64_t>(samplesPerSec) << kFractionBits) / mixer->GetSampleRate();
+
+	// 形式ごとに変換を展開した処理を選ぶ
+	switch (sampleFormat) {
+	case SampleFormat::kPcm8:
+	  resample_ = &Voice::ResampleAs<Pcm8Reader>;
+	  break;
+	case SampleFormat::kPcm16:
+	  resample_ = &Voice::ResampleAs<Pcm16Reader>;
+	  break;
+	case SampleFormat::kPcm24:
+	  resample_ = &Voice::ResampleAs<Pcm24Reader>;
+	  break;
+	case SampleFormat::kPcm32:
+	  resample_ = &Voice::ResampleAs<Pcm32Reader>;
+	  break;
+	default:
+	  resample_ = &Voice::ResampleAs<Float32Reader>;
+	  break;
+	}
+  }
+
+  uint32_t GetQueuedBufferCount() override {
+	std::lock_guard<std::mutex> lock(mixer_->mutex_);
+	return static_cast<uint32_t>(buffers_.size());
+  }
+
+  void SubmitBuffer(const uint8_t* data, uint32_t size, bool isEndOfStream) override {
+	std::lock_guard<std::mutex> lock(mixer_->mutex_);
+	buffers_.push_back({data, size / blockAlign_, isEndOfStream, false});
+  }
+
+  void SubmitLoopingBuffer(const uint8_t* data, uint32_t size) override {
+	std::lock_guard<std::mutex> lock(mixer_->mutex_);
+	buffers_.push_back({data, size / blockAlign_, true, true});
+  }
+
+  void Start() override {
+	std::lock_guard<std::mutex> lock(mixer_->mutex_);
+	isPlaying_ = true;
+  }
+
+  void Stop() override {
+	// 捨てたバッファの終了は通知しない（プールとストリーミングはバッファ数で判断する）
+	std::lock_guard<std::mutex> lock(mixer_->mutex_);
+	isPlaying_ = false;
+	buffers_.clear();
+	position_ = 0;
+  }
+
+  void SetVolume(float volume) override {
+	std::lock_guard<std::mutex> lock(mixer_->mutex_);
+	volume_ = volume;
+  }
+
+  void SetPan(float pan) override {
+	std::lock_guard<std::mutex> lock(mixer_->mutex_);
+	ComputePanGains(pan, panLeft_, panRight_);
+  }
+
+  void SetContext(uint32_t context) override {
+	std::lock_guard<std::mutex> lock(mixer_->mutex_);
+	context_ = context;
+  }
+
+  void Destroy() override { mixer_->DestroyVoice(this); }
+
+  /// <summary>
+  /// 出力のサンプリングレートに変換して書き出す（ミキサーの排他制御の中で呼ぶ）
+  /// </summary>
+  /// <param name="output">出力先（左右交互のステレオ）</param>
+  /// <param name="frameCount">フレーム数</param>
+  /// <param name="endedContexts">最後のバッファを再生し終えたらコンテキストを追加する</param>
+  /// <returns>書き出したフレーム数（バッファが尽きたら足りなくなる）</returns>
+  uint32_t Resample(float* output, uint32_t frameCount, std::vector<uint32_t>& endedContexts) {
+	return (this->*resample_)(output, frameCount, endedContexts);
+  }
+
+  bool IsPlaying() const { return isPlaying_; }
+  float GetLeftGain() const { return volume_ * panLeft_; }
+  float GetRightGain() const { return volume_ * panRight_; }
+
+private:
+  /// <summary>
+  /// 送られたバッファ
+  /// </summary>
+  struct Buffer {
+	// 波形データ
+	const uint8_t* data;
+	// フレーム数
+	uint32_t frameCount;
+	// 最後のバッファか
+	bool isEndOfStream;
+	// ループ再生するか
+	bool isLooping;
+  };
+
+  /// <summary>
+  /// 変換処理
+  /// </summary>
+  typedef uint32_t (Voice::*ResampleFunc)(float*, uint32_t, std::vector<uint32_t>&);
+
+  /// <summary>
+  /// 形式を指定した変換処理（Resampleの本体）
+  /// </summary>
+  template<typename Reader>
+  uint32_t ResampleAs(float* output, uint32_t frameCount, std::vector<uint32_t>& endedContexts) {
+	uint32_t written = 0;
+	while (written < frameCount && !buffers_.empty()) {
+	  const Buffer& buffer = buffers_.front();
+	  uint64_t end = static_cast<uint64_t>(buffer.frameCount) << kFractionBits;
+
+	  for (; written < frameCount && position_ < end; written++) {
+		uint32_t index = static_cast<uint32_t>(position_ >> kFractionBits);
+		float left, right;
+		ReadFrame<Reader>(buffer.data, index, left, right);
+
+		// 補間が要るなら次のフレームも読む（バッファの最後のフレームだけ次の読み先を探す）
+		uint64_t fraction = position_ & kFractionMask;
+		if (fraction != 0) {
+		  float nextLeft, nextRight;
+		  if (index + 1 < buffer.frameCount) {
+			ReadFrame<Reader>(buffer.data, index + 1, nextLeft, nextRight);
+		  } else {
+			ReadNextFrame<Reader>(nextLeft, nextRight);
+		  }
+		  float t = static_cast<float>(fraction) * (1.0f / 4294967296.0f);
+		  left += (nextLeft - left) * t;
+		  right += (nextRight - right) * t;
+		}
+		output[written * kChannels] = left;
+		output[written * kChannels + 1] = right;
+		position_ += step_;
+	  }
+	  if (position_ < end) {
+		break;
+	  }
+
+	  // バッファの終わりに達した
+	  if (buffer.isLooping && end > 0) {
+		position_ %= end;
+		continue;
+	  }
+	  position_ -= (std::min)(position_, end);
+	  if (buffer.isEndOfStream && context_ != 0) {
+		endedContexts.push_back(context_);
+	  }
+	  buffers_.pop_front();
+	}
+	return written;
+  }
+
+  /// <summary>
+  /// 1フレームの読み出し（モノラルは左右に同じ値を入れる）
+  /// </summary>
+  template<typename Reader>
+  void ReadFrame(const uint8_t* data, uint32_t index, float& left, float& right) const {
+	const uint8_t* frame = data + static_cast<size_t>(index) * blockAlign_;
+	left = Reader::Read(frame);
+	right = channels_ == 2 ? Reader::Read(frame + bytesPerSample_) : left;
+  }
+
+  /// <summary>
+  /// 先頭のバッファの最後のフレームの次を読み出す（ループ先か次のバッファの先頭）
+  /// </summary>
+  template<typename Reader> void ReadNextFrame(float& left, float& right) const {
+	const Buffer& buffer = buffers_.front();
+	if (buffer.isLooping) {
+	  ReadFrame<Reader>(buffer.data, 0, left, right);
+	} else if (buffers_.size() > 1 && buffers_[1].frameCount > 0) {
+	  ReadFrame<Reader>(buffers_[1].data, 0, left, right);
+	} else {
+	  // 続きが無ければ最後のフレームを伸ばす
+	  ReadFrame<Reader>(buffer.data, buffer.frameCount - 1, left, right);
+	}
+  }
+
+  // 生成元
+  SoftwareMixer* mixer_;
+  // 変換処理
+  ResampleFunc resample_;
+  // チャンネル数
+  uint32_t channels_;
+  // 1フレームのバイト数
+  uint32_t blockAlign_;
+  // 1サンプルのバイト数
+  uint32_t bytesPerSample_;
+  // 1出力フレームで進む元のフレーム数（固定小数点）
+  uint64_t step_;
+  // 先頭のバッファ内の再生位置（固定小数点）
+  uint64_t position_ = 0;
+  // 送られたバッファ
+  std::deque<Buffer> buffers_;
+  // 再生中か
+  bool isPlaying_ = false;
+  // 音量
+  float volume_ = 1.0f;
+  // 定位による左の倍率
+  float panLeft_ = 1.0f;
+  // 定位による右の倍率
+  float panRight_ = 1.0f;
+  // 最後のバッファを再生し終えた時に通知する値
+  uint32_t context_ = 0;
+};
+
+SoftwareMixer::SoftwareMixer(uint32_t sampleRate) : sampleRate_(sampleRate) {
+  assert(sampleRate > 0);
+}
+
+SoftwareMixer::~SoftwareMixer() {
+  // 破棄し忘れたソースボイスも片付ける
+  for (Voice* voice : voices_) {
+	delete voice;
+  }
+}
+
+bool SoftwareMixer::IsSupported(const uint8_t* formatData) {
+  return GetSampleFormat(formatData) != SampleFormat::kUnsupported;
+}
+
+void SoftwareMixer::SetEndCallback(std::function<void(uint32_t)> callback) {
+  endCallback_ = std::move(callback);
+}
+
+ISourceVoice* SoftwareMixer::CreateSourceVoice(const uint8_t* formatData) {
+  assert(formatData);
+
+  SampleFormat sampleFormat = GetSampleFormat(formatData);
+  if (sampleFormat == SampleFormat::kUnsupported) {
+	return nullptr;
+  }
+
+  Voice* voice = new Voice(this, formatData, sampleFormat);
+  std::lock_guard<std::mutex> lock(mutex_);
+  voices_.push_back(voice);
+  return voice;
+}
+
+void SoftwareMixer::Render(float* output, uint32_t frameCount) {
+  std::fill(output, output + static_cast<size_t>(frameCount) * kChannels, 0.0f);
+
+  {
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	scratch_.resize((std::max)(scratch_.size(), static_cast<size_t>(frameCount) * kChannels));
+	for (Voice* voice : voices_) {
+	  if (!voice->IsPlaying()) {
+		continue;
+	  }
+	  // 変換してから音量を掛けて足す（バッファが尽きた残りは無音）
+	  uint32_t frames = voice->Resample(scratch_.data(), frameCount, endedContexts_);
+	  MixScaled(output, scratch_.data(), frames, voice->GetLeftGain(), voice->GetRightGain());
+	}
+	renderedFrames_ += frameCount;
+
+	notifyContexts_.swap(endedContexts_);
+  }
+
+  // 通知先がソースボイスを操作しても詰まらないように、排他を外してから通知する
+  if (endCallback_) {
+	for (uint32_t context : notifyContexts_) {
+	  endCallback_(context);
+	}
+  }
+  notifyContexts_.clear();
+}
+
+uint32_t SoftwareMixer::GetVoiceCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<uint32_t>(voices_.size());
+}
+
+void SoftwareMixer::DestroyVoice(Voice* voice) {
+  {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = std::find(voices_.begin(), voices_.end(), voice);
+	assert(it != voices_.end());
+	*it = voices_.back();
+	voices_.pop_back();
+  }
+  delete voice;
+}
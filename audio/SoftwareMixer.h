@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include "SourceVoice.h"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/// <summary>
+/// ソフトウェアミキサー（サウンドデバイスを使わないオーディオのバックエンド）
+/// Renderを呼んだ分だけ時間が進むので、サーバーや自動テストでも同じ入力から同じ出力が得られる
+/// 各ソースボイスを線形補間で出力のサンプリングレートに変換し、音量と定位を掛けてSSEで足し合わせる
+/// 対応する波形はPCM（8/16/24/32bit）と32bit浮動小数点のモノラルかステレオ
+/// </summary>
+class SoftwareMixer : public IVoiceDevice {
+public:
+  // 標準の出力サンプリングレート
+  static const uint32_t kDefaultSampleRate = 48000;
+  // 出力チャンネル数（ステレオ固定）
+  static const uint32_t kChannels = 2;
+
+  /// <summary>
+  /// コンストラクタ
+  /// </summary>
+  /// <param name="sampleRate">出力サンプリングレート</param>
+  explicit SoftwareMixer(uint32_t sampleRate = kDefaultSampleRate);
+  ~SoftwareMixer();
+  SoftwareMixer(const SoftwareMixer&) = delete;
+  SoftwareMixer& operator=(const SoftwareMixer&) = delete;
+
+  /// <summary>
+  /// 波形フォーマットに対応しているか
+  /// </summary>
+  /// <param name="formatData">波形フォーマット（WAVEFORMATEXとして扱える並び）</param>
+  /// <returns>対応していればtrue</returns>
+  static bool IsSupported(const uint8_t* formatData);
+
+  /// <summary>
+  /// 最後のバッファを再生し終えた時の通知先の設定（Renderより前に設定する）
+  /// 通知はRenderを呼んだスレッドから、ミキサーの排他を外して行われる
+  /// </summary>
+  /// <param name="callback">通知先（SetContextで設定した値を受け取る）</param>
+  void SetEndCallback(std::function<void(uint32_t)> callback);
+
+  ISourceVoice* CreateSourceVoice(const uint8_t* formatData) override;
+
+  /// <summary>
+  /// 再生中の全ソースボイスを混ぜて書き出す（1スレッドからのみ呼ぶ）
+  /// </summary>
+  /// <param name="output">出力先（左右交互に frameCount * kChannels 個）</param>
+  /// <param name="frameCount">フレーム数</param>
+  void Render(float* output, uint32_t frameCount);
+
+  uint32_t GetSampleRate() const { return sampleRate_; }
+  // 生成済みのソースボイス数
+  uint32_t GetVoiceCount();
+  // これまでに書き出したフレーム数
+  uint64_t GetRenderedFrames() const { return renderedFrames_; }
+
+private:
+  class Voice;
+
+  /// <summary>
+  /// ソースボイスの破棄
+  /// </summary>
+  /// <param name="voice">ソースボイス</param>
+  void DestroyVoice(Voice* voice);
+
+  // 出力サンプリングレート
+  uint32_t sampleRate_;
+  // ソースボイスとRenderの排他制御
+  std::mutex mutex_;
+  // 生成済みのソースボイス
+  std::vector<Voice*> voices_;
+  // 1ボイス分の変換結果（Renderの作業用）
+  std::vector<float> scratch_;
+  // 再生し終えたソースボイスのコンテキスト
+  std::vector<uint32_t> endedContexts_;
+  // 通知中のコンテキスト（排他を外して通知するための作業用）
+  std::vector<uint32_t> notifyContexts_;
+  // 最後のバッファを再生し終えた時の通知先
+  std::function<void(uint32_t)> endCallback_;
+  // これまでに書き出したフレーム数
+  uint64_t renderedFrames_ = 0;
+};
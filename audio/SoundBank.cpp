@@ -0,0 +1,319 @@
+﻿#include "SoundBank.h"
+#include "FileData.h"
+#include "Hash.h"
+#include <Windows.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// ファイルの識別子
+const char kMagic[4] = {'S', 'B', 'N', 'K'};
+// 形式のバージョン
+const uint32_t kVersion = 2;
+
+/// <summary>
+/// 境界に切り上げる
+/// </summary>
+size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+/// <summary>
+/// FILETIMEを64bitの値にする
+/// </summary>
+uint64_t ToUint64(const FILETIME& fileTime) {
+  return (static_cast<uint64_t>(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime;
+}
+
+/// <summary>
+/// ファイルのサイズと更新日時を調べる
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="size">サイズ（バイト）</param>
+/// <param name="writeTime">更新日時（FILETIME）</param>
+/// <returns>ファイルがあればtrue</returns>
+bool GetFileInfo(const std::string& path, uint64_t& size, uint64_t& writeTime) {
+  WIN32_FILE_ATTRIBUTE_DATA attributes;
+  if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) {
+	return false;
+  }
+  size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+  writeTime = ToUint64(attributes.ftLastWriteTime);
+  return true;
+}
+
+} // namespace
+
+const char* const SoundBank::kDefaultFileName = "sounds.bank";
+
+uint64_t SoundBank::HashName(const std::string& name) {
+  uint64_t hash = kFnv1aOffsetBasis;
+  for (char c : name) {
+	uint8_t lower = static_cast<uint8_t>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+	hash = HashFnv1a(&lower, 1, hash);
+  }
+  return hash;
+}
+
+bool SoundBank::Serialize(const std::vector<Source>& sources, std::vector<uint8_t>& bankData) {
+  // 索引は名前のハッシュ値の昇順に並べる
+  std::vector<uint64_t> nameHashes(sources.size());
+  std::vector<size_t> order(sources.size());
+  for (size_t i = 0; i < sources.size(); i++) {
+	nameHashes[i] = HashName(sources[i].name);
+	order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&nameHashes](size_t a, size_t b) {
+	return nameHashes[a] < nameHashes[b];
+  });
+  for (size_t i = 1; i < order.size(); i++) {
+	if (nameHashes[order[i - 1]] == nameHashes[order[i]]) {
+	  return false;
+	}
+  }
+
+  // 配置を決める（ヘッダと索引の後ろに、サウンドごとに波形フォーマットと波形データを並べる）
+  size_t offset = sizeof(Header) + sizeof(Entry) * sources.size();
+  std::vector<Entry> entries(sources.size());
+  for (size_t i = 0; i < order.size(); i++) {
+	const WaveData& waveData = sources[order[i]].waveData;
+	Entry& entry = entries[i];
+	entry.nameHash = nameHashes[order[i]];
+	entry.sourceHash = sources[order[i]].sourceHash;
+	entry.sourceWriteTime = sources[order[i]].sourceWriteTime;
+	entry.sourceSize = sources[order[i]].sourceSize;
+
+	// 波形フォーマットはWAVEFORMATEXとして渡せるように18バイト以上にする
+	size_t formatSize = waveData.formatSize;
+	if (formatSize < WaveParser::kWaveFormatExSize) {
+	  formatSize = WaveParser::kWaveFormatExSize;
+	}
+	offset = AlignUp(offset, kBlobAlignment);
+	entry.formatOffset = static_cast<uint32_t>(offset);
+	entry.formatSize = static_cast<uint32_t>(formatSize);
+	offset += formatSize;
+
+	offset = AlignUp(offset, kBlobAlignment);
+	entry.samplesOffset = static_cast<uint32_t>(offset);
+	entry.samplesSize = waveData.samplesSize;
+	entry.sampleLength = waveData.sampleLength;
+	offset += waveData.samplesSize;
+
+	// 位置は32bitで持つ
+	if (offset > UINT32_MAX) {
+	  return false;
+	}
+  }
+
+  // 書き込む（隙間は0で埋まる）
+  bankData.assign(offset, 0);
+  Header header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.entryCount = static_cast<uint32_t>(entries.size());
+  std::memcpy(bankData.data(), &header, sizeof(header));
+  if (!entries.empty()) {
+	std::memcpy(
+	  bankData.data() + sizeof(Header), entries.data(),
+	  sizeof(Entry) * entries.size());
+  }
+  for (size_t i = 0; i < order.size(); i++) {
+	const WaveData& waveData = sources[order[i]].waveData;
+	const Entry& entry = entries[i];
+	std::memcpy(bankData.data() + entry.formatOffset, waveData.format, waveData.formatSize);
+	std::memcpy(bankData.data() + entry.samplesOffset, waveData.samples, waveData.samplesSize);
+  }
+  return true;
+}
+
+bool SoundBank::Build(const std::string& directoryPath, const char* fileName) {
+  std::string bankPath = directoryPath + fileName;
+
+  // WAVの名前とサイズと更新日時を集める（中身はまだ読まない）
+  std::vector<Source> sources;
+  WIN32_FIND_DATAA findData;
+  HANDLE findHandle = FindFirstFileA((directoryPath + "*.wav").c_str(), &findData);
+  if (findHandle == INVALID_HANDLE_VALUE) {
+	return false;
+  }
+  do {
+	Source source;
+	source.name = findData.cFileName;
+	source.sourceSize = findData.nFileSizeLow;
+	source.sourceWriteTime = ToUint64(findData.ftLastWriteTime);
+	sources.push_back(source);
+  } while (FindNextFileA(findHandle, &findData));
+  FindClose(findHandle);
+
+  // 全てのWAVが、入っているものは同じサイズと更新日時のまま、入っていないもの（読めなかったもの）は
+  // サウンドバンクより古ければ作り直さない
+  {
+	SoundBank bank;
+	uint64_t bankSize = 0;
+	uint64_t bankWriteTime = 0;
+	if (GetFileInfo(bankPath, bankSize, bankWriteTime) && bank.Open(bankPath)) {
+	  bool isUpToDate = true;
+	  for (const Source& source : sources) {
+		const Entry* entry = bank.FindEntry(source.name);
+		if (entry) {
+		  isUpToDate = entry->sourceSize == source.sourceSize &&
+		               entry->sourceWriteTime == source.sourceWriteTime;
+		} else {
+		  isUpToDate = source.sourceWriteTime < bankWriteTime;
+		}
+		if (!isUpToDate) {
+		  break;
+		}
+	  }
+	  if (isUpToDate) {
+		return true;
+	  }
+	}
+  }
+
+  // WAVを全てマップして解析する
+  std::vector<MappedFile> files;
+  std::vector<Source> parsedSources;
+  for (Source& source : sources) {
+	MappedFile file;
+	if (
+	  !file.Open(directoryPath + source.name) ||
+	  !WaveParser::Parse(file.GetData(), file.GetSize(), source.waveData)) {
+	  continue;
+	}
+	source.sourceSize = static_cast<uint32_t>(file.GetSize());
+	source.sourceHash = HashFnv1a(file.GetData(), file.GetSize());
+	// マップした先の移動でポインタは変わらない
+	files.push_back(std::move(file));
+	parsedSources.push_back(source);
+  }
+  sources.swap(parsedSources);
+
+  if (sources.empty()) {
+	return false;
+  }
+
+  std::vector<uint8_t> bankData;
+  if (!Serialize(sources, bankData)) {
+	return false;
+  }
+  return WriteFileData(bankPath, bankData.data(), bankData.size());
+}
+
+bool SoundBank::Open(const std::string& filePath) {
+  Close();
+  if (!file_.Open(filePath)) {
+	return false;
+  }
+  if (!Attach(file_.GetData(), file_.GetSize())) {
+	Close();
+	return false;
+  }
+  return true;
+}
+
+bool SoundBank::Attach(const void* data, size_t size) {
+  data_ = nullptr;
+  entries_ = nullptr;
+  entryCount_ = 0;
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  if (size < sizeof(Header)) {
+	return false;
+  }
+  Header header;
+  std::memcpy(&header, bytes, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+	return false;
+  }
+  if (header.entryCount > (size - sizeof(Header)) / sizeof(Entry)) {
+	return false;
+  }
+
+  // 索引が全て中身に収まり、昇順に並んでいるか
+  const Entry* entries = reinterpret_cast<const Entry*>(bytes + sizeof(Header));
+  for (uint32_t i = 0; i < header.entryCount; i++) {
+	const Entry& entry = entries[i];
+	if (i > 0 && entries[i - 1].nameHash >= entry.nameHash) {
+	  return false;
+	}
+	if (
+	  static_cast<uint64_t>(entry.formatOffset) + entry.formatSize > size ||
+	  static_cast<uint64_t>(entry.samplesOffset) + entry.samplesSize > size) {
+	  return false;
+	}
+	if (!WaveParser::IsSupportedFormat(bytes + entry.formatOffset, entry.formatSize)) {
+	  return false;
+	}
+  }
+
+  data_ = bytes;
+  entries_ = entries;
+  entryCount_ = header.entryCount;
+  return true;
+}
+
+void SoundBank::Close() {
+  file_.Close();
+  data_ = nullptr;
+  entries_ = nullptr;
+  entryCount_ = 0;
+}
+
+bool SoundBank::Find(const std::string& name, WaveData& waveData) const {
+  const Entry* entry = FindEntry(name);
+  if (!entry) {
+	return false;
+  }
+
+  waveData.format = data_ + entry->formatOffset;
+  waveData.formatSize = entry->formatSize;
+  waveData.samples = data_ + entry->samplesOffset;
+  waveData.samplesSize = entry->samplesSize;
+  waveData.sampleLength = entry->sampleLength;
+  return true;
+}
+
+bool SoundBank::IsStale(const std::string& name, const std::string& sourcePath) const {
+  const Entry* entry = FindEntry(name);
+  if (!entry) {
+	return true;
+  }
+
+  // 元のWAVを置かずに配布した場合はサウンドバンクの中身を使う
+  uint64_t size = 0;
+  uint64_t writeTime = 0;
+  if (!GetFileInfo(sourcePath, size, writeTime)) {
+	return false;
+  }
+  if (size != entry->sourceSize) {
+	return true;
+  }
+  if (writeTime == entry->sourceWriteTime) {
+	return false;
+  }
+
+  // 更新日時だけ変わっていれば中身を比べる
+  MappedFile file;
+  if (!file.Open(sourcePath)) {
+	return false;
+  }
+  return HashFnv1a(file.GetData(), file.GetSize()) != entry->sourceHash;
+}
+
+const SoundBank::Entry* SoundBank::FindEntry(const std::string& name) const {
+  if (!entries_) {
+	return nullptr;
+  }
+
+  uint64_t nameHash = HashName(name);
+  const Entry* end = entries_ + entryCount_;
+  const Entry* entry = std::lower_bound(
+    entries_, end, nameHash,
+    [](const Entry& candidate, uint64_t hash) { return candidate.nameHash < hash; });
+  if (entry == end || entry->nameHash != nameHash) {
+	return nullptr;
+  }
+  return entry;
+}
@@ -0,0 +1,159 @@
+﻿#pragma once
+
+#include "MappedFile.h"
+#include "WaveParser.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// サウンドバンク（複数のWAVの波形を1ファイルにまとめたもの）
+/// ヘッダ・名前のハッシュ値順の索引・境界に揃えた波形フォーマットと波形データの順に並ぶ
+/// 1回のマップで全サウンドを参照でき、名前のハッシュ値の二分探索で引ける
+/// 索引には元のWAVのサイズ・更新日時・内容のハッシュ値を持ち、変わったWAVだけを見分けられる
+/// </summary>
+class SoundBank {
+public:
+  // 標準のファイル名（サウンドのディレクトリからの相対パス）
+  static const char* const kDefaultFileName;
+  // 波形フォーマットと波形データの配置境界（バイト）
+  static const uint32_t kBlobAlignment = 64;
+
+  /// <summary>
+  /// まとめる元のサウンド
+  /// </summary>
+  struct Source {
+	// 名前（LoadWaveに渡すファイル名）
+	std::string name;
+	// 波形（WaveParserの解析結果）
+	WaveData waveData;
+	// 元のWAVのサイズ（バイト）
+	uint32_t sourceSize = 0;
+	// 元のWAVの更新日時（FILETIME）
+	uint64_t sourceWriteTime = 0;
+	// 元のWAVの内容のハッシュ値
+	uint64_t sourceHash = 0;
+  };
+
+  /// <summary>
+  /// 名前のハッシュ値を求める（ファイル名なので英字の大文字小文字を区別しない）
+  /// </summary>
+  /// <param name="name">名前</param>
+  /// <returns>ハッシュ値</returns>
+  static uint64_t HashName(const std::string& name);
+
+  /// <summary>
+  /// サウンドバンクの中身を作る
+  /// </summary>
+  /// <param name="sources">まとめる元のサウンド</param>
+  /// <param name="bankData">作った中身</param>
+  /// <returns>成否（名前のハッシュ値が重なれば失敗）</returns>
+  static bool Serialize(const std::vector<Source>& sources, std::vector<uint8_t>& bankData);
+
+  /// <summary>
+  /// ディレクトリ内の全WAVをまとめてサウンドバンクを作る（読めないWAVは入れない）
+  /// 全てのWAVが前回まとめた時から変わっていなければ作り直さない
+  /// </summary>
+  /// <param name="directoryPath">サウンドのディレクトリパス</param>
+  /// <param name="fileName">サウンドバンクのファイル名</param>
+  /// <returns>成否（WAVが1つも無ければ作らずにfalse）</returns>
+  static bool Build(const std::string& directoryPath, const char* fileName = kDefaultFileName);
+
+  SoundBank() = default;
+  SoundBank(const SoundBank&) = delete;
+  SoundBank& operator=(const SoundBank&) = delete;
+
+  /// <summary>
+  /// ファイルをマップして索引を検証する
+  /// </summary>
+  /// <param name="filePath">ファイルパス</param>
+  /// <returns>成否</returns>
+  bool Open(const std::string& filePath);
+
+  /// <summary>
+  /// メモリ上の中身を検証して参照する（dataは閉じるまで保持すること）
+  /// </summary>
+  /// <param name="data">中身</param>
+  /// <param name="size">サイズ（バイト）</param>
+  /// <returns>成否</returns>
+  bool Attach(const void* data, size_t size);
+
+  /// <summary>
+  /// 閉じる
+  /// </summary>
+  void Close();
+
+  /// <summary>
+  /// 名前で探す
+  /// </summary>
+  /// <param name="name">名前</param>
+  /// <param name="waveData">見つかった波形（サウンドバンクの中を指す）</param>
+  /// <returns>見つかればtrue</returns>
+  bool Find(const std::string& name, WaveData& waveData) const;
+
+  /// <summary>
+  /// 元のWAVがまとめた時から変わっているか
+  /// </summary>
+  /// <param name="name">名前</param>
+  /// <param name="sourcePath">元のWAVのファイルパス</param>
+  /// <returns>入っていないか、元のWAVのサイズか内容が変わっていればtrue（元のWAVが無ければfalse）</returns>
+  bool IsStale(const std::string& name, const std::string& sourcePath) const;
+
+  bool IsOpen() const { return entries_ != nullptr; }
+  uint32_t GetEntryCount() const { return entryCount_; }
+
+private:
+  /// <summary>
+  /// ファイルヘッダ
+  /// </summary>
+  struct Header {
+	// "SBNK"
+	char magic[4];
+	// 形式のバージョン
+	uint32_t version;
+	// 索引の数
+	uint32_t entryCount;
+	// 予約
+	uint32_t reserved;
+  };
+
+  /// <summary>
+  /// 索引（名前のハッシュ値の昇順に並ぶ）
+  /// </summary>
+  struct Entry {
+	// 名前のハッシュ値
+	uint64_t nameHash;
+	// 元のWAVの内容のハッシュ値
+	uint64_t sourceHash;
+	// 元のWAVの更新日時（FILETIME）
+	uint64_t sourceWriteTime;
+	// 波形フォーマットの位置（ファイル先頭から）
+	uint32_t formatOffset;
+	// 波形フォーマットのサイズ
+	uint32_t formatSize;
+	// 波形データの位置（ファイル先頭から）
+	uint32_t samplesOffset;
+	// 波形データのサイズ
+	uint32_t samplesSize;
+	// factチャンクのサンプル数
+	uint32_t sampleLength;
+	// 元のWAVのサイズ
+	uint32_t sourceSize;
+  };
+
+  /// <summary>
+  /// 名前で索引を探す
+  /// </summary>
+  /// <param name="name">名前</param>
+  /// <returns>索引（無ければnullptr）</returns>
+  const Entry* FindEntry(const std::string& name) const;
+
+  // マップしたファイル
+  MappedFile file_;
+  // 中身の先頭
+  const uint8_t* data_ = nullptr;
+  // 索引
+  const Entry* entries_ = nullptr;
+  // 索引の数
+  uint32_t entryCount_ = 0;
+};
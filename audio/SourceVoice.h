@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+/// <summary>
+/// 定位から左右の音量の倍率を求める（中央では左右とも1）
+/// </summary>
+/// <param name="pan">定位（-1で左のみ、0で中央、1で右のみ）</param>
+/// <param name="left">左の倍率</param>
+/// <param name="right">右の倍率</param>
+inline void ComputePanGains(float pan, float& left, float& right) {
+  left = pan > 0.0f ? 1.0f - (pan < 1.0f ? pan : 1.0f) : 1.0f;
+  right = pan < 0.0f ? 1.0f + (pan > -1.0f ? pan : -1.0f) : 1.0f;
+}
+
+/// <summary>
+/// ストリーミング再生の送り先（XAudio2のソースボイスなど）
+/// </summary>
+class IStreamVoice {
+public:
+  virtual ~IStreamVoice() = default;
+
+  /// <summary>
+  /// 再生待ち（再生中を含む）のバッファ数の取得
+  /// </summary>
+  /// <returns>バッファ数</returns>
+  virtual uint32_t GetQueuedBufferCount() = 0;
+
+  /// <summary>
+  /// バッファの送信（再生し終わるまでdataの中身は書き換えられない）
+  /// </summary>
+  /// <param name="data">波形データ</param>
+  /// <param name="size">サイズ（バイト）</param>
+  /// <param name="isEndOfStream">最後のバッファか（再生し終えたら終了を通知する）</param>
+  virtual void SubmitBuffer(const uint8_t* data, uint32_t size, bool isEndOfStream) = 0;
+};
+
+/// <summary>
+/// ソースボイス
+/// 停止してバッファを捨てれば同じ波形フォーマットの別の音に使い回せる
+/// </summary>
+class ISourceVoice : public IStreamVoice {
+public:
+  /// <summary>
+  /// ループ再生するバッファの送信（停止するまで繰り返す）
+  /// </summary>
+  /// <param name="data">波形データ</param>
+  /// <param name="size">サイズ（バイト）</param>
+  virtual void SubmitLoopingBuffer(const uint8_t* data, uint32_t size) = 0;
+
+  /// <summary>
+  /// 再生開始
+  /// </summary>
+  virtual void Start() = 0;
+
+  /// <summary>
+  /// 停止して再生待ちのバッファを全て捨てる
+  /// </summary>
+  virtual void Stop() = 0;
+
+  /// <summary>
+  /// 音量の設定
+  /// </summary>
+  /// <param name="volume">音量（1で元の大きさ）</param>
+  virtual void SetVolume(float volume) = 0;
+
+  /// <summary>
+  /// 左右の定位の設定（中央では左右とも元の大きさで、寄せた側と逆側を絞る）
+  /// </summary>
+  /// <param name="pan">定位（-1で左のみ、0で中央、1で右のみ）</param>
+  virtual void SetPan(float pan) = 0;
+
+  /// <summary>
+  /// 再生終了の通知で渡す値の設定
+  /// </summary>
+  /// <param name="context">値（再生ハンドル）</param>
+  virtual void SetContext(uint32_t context) = 0;
+
+  /// <summary>
+  /// 破棄（以後このポインタは使えない）
+  /// </summary>
+  virtual void Destroy() = 0;
+};
+
+/// <summary>
+/// ソースボイスの生成元（オーディオのバックエンド。XAudio2やソフトウェアミキサーなど）
+/// </summary>
+class IVoiceDevice {
+public:
+  virtual ~IVoiceDevice() = default;
+
+  /// <summary>
+  /// ソースボイスの生成
+  /// </summary>
+  /// <param name="formatData">波形フォーマット（WAVEFORMATEXとして扱える並び）</param>
+  /// <returns>ソースボイス（失敗したらnullptr）</returns>
+  virtual ISourceVoice* CreateSourceVoice(const uint8_t* formatData) = 0;
+};
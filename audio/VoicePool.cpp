@@ -0,0 +1,203 @@
+﻿#include "VoicePool.h"
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+// WAVEFORMATEXの各メンバの位置
+const size_t kFormatTagOffset = 0;
+const size_t kChannelsOffset = 2;
+const size_t kSamplesPerSecOffset = 4;
+const size_t kBlockAlignOffset = 12;
+const size_t kBitsPerSampleOffset = 14;
+const size_t kExtraSizeOffset = 16;
+// WAVEFORMATEXTENSIBLEのサブフォーマットの位置
+const size_t kSubFormatOffset = 24;
+// WAVE_FORMAT_EXTENSIBLE
+const uint16_t kFormatTagExtensible = 0xFFFE;
+
+/// <summary>
+/// 位置を指定して読み出す（境界に揃っていなくてもよい）
+/// </summary>
+template<typename T> T ReadAt(const uint8_t* data, size_t offset) {
+  T value;
+  std::memcpy(&value, data + offset, sizeof(value));
+  return value;
+}
+
+} // namespace
+
+bool VoicePool::FormatKey::operator==(const FormatKey& other) const {
+  return formatTag == other.formatTag && channels == other.channels &&
+         samplesPerSec == other.samplesPerSec && blockAlign == other.blockAlign &&
+         bitsPerSample == other.bitsPerSample && subFormat == other.subFormat;
+}
+
+VoicePool::FormatKey VoicePool::MakeFormatKey(const uint8_t* formatData) {
+  assert(formatData);
+
+  FormatKey key;
+  key.formatTag = ReadAt<uint16_t>(formatData, kFormatTagOffset);
+  key.channels = ReadAt<uint16_t>(formatData, kChannelsOffset);
+  key.samplesPerSec = ReadAt<uint32_t>(formatData, kSamplesPerSecOffset);
+  key.blockAlign = ReadAt<uint16_t>(formatData, kBlockAlignOffset);
+  key.bitsPerSample = ReadAt<uint16_t>(formatData, kBitsPerSampleOffset);
+  key.subFormat = 0;
+  if (
+    key.formatTag == kFormatTagExtensible &&
+    ReadAt<uint16_t>(formatData, kExtraSizeOffset) >= kSubFormatOffset - kExtraSizeOffset) {
+	key.subFormat = ReadAt<uint32_t>(formatData, kSubFormatOffset);
+  }
+  return key;
+}
+
+VoicePool::~VoicePool() { Finalize(); }
+
+void VoicePool::Initialize(IVoiceDevice* device, uint32_t maxVoices) {
+  assert(device);
+  assert(maxVoices > 0 && maxVoices <= SlotMap<Record>::kMaxCapacity);
+
+  Finalize();
+  device_ = device;
+
+  // 記録は最大数分を先に確保する
+  records_.Initialize(maxVoices);
+  idleVoices_.reserve(maxVoices);
+}
+
+void VoicePool::Finalize() {
+  records_.ForEach([](uint32_t, Record& record) { record.voice->Destroy(); });
+  for (IdleVoice& idleVoice : idleVoices_) {
+	idleVoice.voice->Destroy();
+  }
+  records_ = SlotMap<Record>();
+  idleVoices_.clear();
+  createdCount_ = 0;
+}
+
+uint32_t VoicePool::Acquire(const uint8_t* formatData, int32_t priority) {
+  assert(device_);
+
+  FormatKey format = MakeFormatKey(formatData);
+
+  // 空きが無ければ優先度の低い再生を止める
+  if (records_.IsFull() && !Steal(priority, format)) {
+	return kInvalidHandle;
+  }
+
+  ISourceVoice* voice = PrepareVoice(formatData, format);
+  if (!voice) {
+	return kInvalidHandle;
+  }
+
+  Record record;
+  record.voice = voice;
+  record.format = format;
+  record.priority = priority;
+  record.order = nextOrder_++;
+  uint32_t handle = records_.Insert(record);
+
+  // 再生終了の通知でどの再生か分かるようにする
+  voice->SetContext(handle);
+  return handle;
+}
+
+void VoicePool::Release(uint32_t handle) {
+  const Record* record = records_.Get(handle);
+  if (!record) {
+	return;
+  }
+
+  // 止めて待機に戻す（世代が進むので古いハンドルは無効になる）
+  record->voice->Stop();
+  // 音量と定位は次の再生に持ち越さないよう元に戻す
+  record->voice->SetVolume(1.0f);
+  record->voice->SetPan(0.0f);
+  idleVoices_.push_back({record->format, record->voice});
+  records_.Remove(handle);
+}
+
+ISourceVoice* VoicePool::GetVoice(uint32_t handle) const {
+  const Record* record = records_.Get(handle);
+  return record ? record->voice : nullptr;
+}
+
+void VoicePool::CollectFinished(std::vector<uint32_t>& handles) {
+  records_.ForEach([&handles](uint32_t handle, Record& record) {
+	if (record.voice->GetQueuedBufferCount() == 0) {
+	  handles.push_back(handle);
+	}
+  });
+}
+
+bool VoicePool::Steal(int32_t priority, const FormatKey& format) {
+  // 優先度が最も低いもの、同じならソースボイスを作り直さずに済む同じ波形フォーマットのもの、
+  // それも同じなら最も古いものを探す
+  uint32_t victim = kInvalidHandle;
+  const Record* current = nullptr;
+  records_.ForEach([&](uint32_t handle, Record& record) {
+	if (record.priority >= priority) {
+	  return;
+	}
+	if (!current) {
+	  victim = handle;
+	  current = &record;
+	  return;
+	}
+
+	if (record.priority != current->priority) {
+	  if (record.priority < current->priority) {
+		victim = handle;
+		current = &record;
+	  }
+	  return;
+	}
+	bool isSameFormat = record.format == format;
+	bool isCurrentSameFormat = current->format == format;
+	if (isSameFormat != isCurrentSameFormat) {
+	  if (isSameFormat) {
+		victim = handle;
+		current = &record;
+	  }
+	  return;
+	}
+	if (record.order < current->order) {
+	  victim = handle;
+	  current = &record;
+	}
+  });
+  if (victim == kInvalidHandle) {
+	return false;
+  }
+
+  Release(victim);
+  stolenCount_++;
+  return true;
+}
+
+ISourceVoice* VoicePool::PrepareVoice(const uint8_t* formatData, const FormatKey& format) {
+  // 同じ波形フォーマットの待機中のソースボイスを使い回す
+  for (size_t i = 0; i < idleVoices_.size(); i++) {
+	if (idleVoices_[i].format == format) {
+	  ISourceVoice* voice = idleVoices_[i].voice;
+	  idleVoices_[i] = idleVoices_.back();
+	  idleVoices_.pop_back();
+	  return voice;
+	}
+  }
+
+  // 上限まで生成済みなら、別の波形フォーマットの待機中のものを破棄して枠を空ける
+  if (createdCount_ >= records_.GetCapacity()) {
+	assert(!idleVoices_.empty());
+	idleVoices_.front().voice->Destroy();
+	idleVoices_.front() = idleVoices_.back();
+	idleVoices_.pop_back();
+	createdCount_--;
+  }
+
+  ISourceVoice* voice = device_->CreateSourceVoice(formatData);
+  if (voice) {
+	createdCount_++;
+  }
+  return voice;
+}
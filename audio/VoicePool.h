@@ -0,0 +1,153 @@
+﻿#pragma once
+
+#include "SlotMap.h"
+#include "SourceVoice.h"
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// ソースボイスのプール
+/// 再生し終えたソースボイスは破棄せず、波形フォーマットごとに待機させて次の再生に使い回す
+/// 再生データの記録は最大数分のSlotMapに置き、再生ハンドルから探索せずに引く
+/// 最大数まで再生中なら、優先度が低い（同じなら古い）ものを止めて使う
+/// </summary>
+class VoicePool {
+public:
+  // 同時に再生できる標準の最大数
+  static const uint32_t kDefaultMaxVoices = 64;
+  // 無効な再生ハンドル
+  static const uint32_t kInvalidHandle = 0;
+
+  /// <summary>
+  /// 使い回しの判定に使う波形フォーマット
+  /// </summary>
+  struct FormatKey {
+	uint16_t formatTag;
+	uint16_t channels;
+	uint32_t samplesPerSec;
+	uint16_t blockAlign;
+	uint16_t bitsPerSample;
+	// WAVE_FORMAT_EXTENSIBLEのサブフォーマットの先頭4バイト（それ以外は0）
+	uint32_t subFormat;
+
+	bool operator==(const FormatKey& other) const;
+  };
+
+  /// <summary>
+  /// 波形フォーマットから判定用のキーを作る
+  /// </summary>
+  /// <param name="formatData">波形フォーマット（WAVEFORMATEXとして扱える並び）</param>
+  /// <returns>キー</returns>
+  static FormatKey MakeFormatKey(const uint8_t* formatData);
+
+  VoicePool() = default;
+  ~VoicePool();
+  VoicePool(const VoicePool&) = delete;
+  VoicePool& operator=(const VoicePool&) = delete;
+
+  /// <summary>
+  /// 初期化
+  /// </summary>
+  /// <param name="device">ソースボイスの生成元</param>
+  /// <param name="maxVoices">同時に再生できる最大数（ソースボイスの生成数の上限も兼ねる）</param>
+  void Initialize(IVoiceDevice* device, uint32_t maxVoices = kDefaultMaxVoices);
+
+  /// <summary>
+  /// 全てのソースボイスを破棄する
+  /// </summary>
+  void Finalize();
+
+  /// <summary>
+  /// 再生用のソースボイスを確保する
+  /// </summary>
+  /// <param name="formatData">波形フォーマット</param>
+  /// <param name="priority">優先度（大きいほど止められにくい）</param>
+  /// <returns>再生ハンドル（止められる再生が無ければkInvalidHandle）</returns>
+  uint32_t Acquire(const uint8_t* formatData, int32_t priority);
+
+  /// <summary>
+  /// 停止して音量と定位を元に戻し、ソースボイスを待機に戻す（無効なハンドルなら何もしない）
+  /// </summary>
+  /// <param name="handle">再生ハンドル</param>
+  void Release(uint32_t handle);
+
+  /// <summary>
+  /// 再生ハンドルが有効か
+  /// </summary>
+  /// <param name="handle">再生ハンドル</param>
+  /// <returns>再生中を指していればtrue</returns>
+  bool IsValid(uint32_t handle) const { return records_.Contains(handle); }
+
+  /// <summary>
+  /// ソースボイスの取得
+  /// </summary>
+  /// <param name="handle">再生ハンドル</param>
+  /// <returns>ソースボイス（無効なハンドルならnullptr）</returns>
+  ISourceVoice* GetVoice(uint32_t handle) const;
+
+  /// <summary>
+  /// 再生待ちのバッファが残っていない再生ハンドルを集める（再生終了の通知を取りこぼした時用）
+  /// </summary>
+  /// <param name="handles">集めた再生ハンドルの追加先</param>
+  void CollectFinished(std::vector<uint32_t>& handles);
+
+  uint32_t GetMaxVoices() const { return records_.GetCapacity(); }
+  // 再生中の数
+  uint32_t GetActiveCount() const { return records_.GetCount(); }
+  // 生成済みのソースボイス数（再生中と待機中の合計）
+  uint32_t GetCreatedCount() const { return createdCount_; }
+  // 優先度の低い再生を止めた回数
+  uint64_t GetStolenCount() const { return stolenCount_; }
+
+private:
+  /// <summary>
+  /// 再生データの記録
+  /// </summary>
+  struct Record {
+	// ソースボイス
+	ISourceVoice* voice = nullptr;
+	// 波形フォーマット
+	FormatKey format = {};
+	// 優先度
+	int32_t priority = 0;
+	// 再生を始めた順番
+	uint64_t order = 0;
+  };
+
+  /// <summary>
+  /// 待機中のソースボイス
+  /// </summary>
+  struct IdleVoice {
+	FormatKey format;
+	ISourceVoice* voice;
+  };
+
+  /// <summary>
+  /// 優先度が指定より低い再生のうち、最も低く古いものを止めて記録を空ける
+  /// </summary>
+  /// <param name="priority">優先度</param>
+  /// <param name="format">これから再生する波形フォーマット（同じ優先度なら合うものを優先する）</param>
+  /// <returns>止められたらtrue</returns>
+  bool Steal(int32_t priority, const FormatKey& format);
+
+  /// <summary>
+  /// 波形フォーマットに合うソースボイスを用意する（待機中を優先し、無ければ生成する）
+  /// </summary>
+  /// <param name="formatData">波形フォーマット</param>
+  /// <param name="format">判定用のキー</param>
+  /// <returns>ソースボイス（失敗したらnullptr）</returns>
+  ISourceVoice* PrepareVoice(const uint8_t* formatData, const FormatKey& format);
+
+  // ソースボイスの生成元
+  IVoiceDevice* device_ = nullptr;
+  // 再生データの記録（最大数分）
+  SlotMap<Record> records_;
+  // 待機中のソースボイス
+  std::vector<IdleVoice> idleVoices_;
+  // 生成済みのソースボイス数
+  uint32_t createdCount_ = 0;
+  // 次に再生を始める順番
+  uint64_t nextOrder_ = 0;
+  // 優先度の低い再生を止めた回数
+  uint64_t stolenCount_ = 0;
+};
@@ -0,0 +1,218 @@
+﻿#include "WaveParser.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// チャンクヘッダの大きさ
+const size_t kChunkHeaderSize = 8;
+// RIFFヘッダの大きさ（チャンクヘッダ + "WAVE"）
+const size_t kRiffHeaderSize = 12;
+// WAVEFORMATの大きさ（cbSizeの手前まで）
+const size_t kWaveFormatSize = 16;
+// WAVEFORMATEXTENSIBLEの大きさ
+const size_t kWaveFormatExtensibleSize = 40;
+// WAVEFORMATEXの各メンバの位置
+const size_t kFormatTagOffset = 0;
+const size_t kChannelsOffset = 2;
+const size_t kSamplesPerSecOffset = 4;
+const size_t kBlockAlignOffset = 12;
+const size_t kBitsPerSampleOffset = 14;
+const size_t kExtraSizeOffset = 16;
+// ADPCMWAVEFORMATの各メンバの位置
+const size_t kSamplesPerBlockOffset = 18;
+const size_t kNumCoefOffset = 20;
+const size_t kCoefOffset = 22;
+// WAVEFORMATEXTENSIBLEの各メンバの位置
+const size_t kValidBitsOffset = 18;
+const size_t kSubFormatOffset = 24;
+// 波形フォーマットの種類
+const uint16_t kFormatTagPcm = 1;
+const uint16_t kFormatTagAdpcm = 2;
+const uint16_t kFormatTagFloat = 3;
+const uint16_t kFormatTagExtensible = 0xFFFE;
+// MS ADPCMの係数の最小数と、拡張部分の最小サイズ
+const uint16_t kAdpcmMinCoefCount = 7;
+const uint16_t kAdpcmMinExtraSize = 32;
+// チャンネル数とサンプリングレートの範囲（XAudio2の制限に合わせる）
+const uint16_t kMaxChannels = 64;
+const uint32_t kMinSampleRate = 1000;
+const uint32_t kMaxSampleRate = 200000;
+// サブフォーマットのGUIDの先頭4バイト以外（KSDATAFORMAT_SUBTYPE_PCMなどで共通）
+const uint8_t kSubFormatGuidTail[12] = {0x00, 0x00, 0x10, 0x00, 0x80, 0x00,
+                                        0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+
+/// <summary>
+/// 位置を指定して読み出す（境界に揃っていなくてもよい）
+/// </summary>
+template<typename T> T ReadAt(const uint8_t* data, size_t offset) {
+  T value;
+  std::memcpy(&value, data + offset, sizeof(value));
+  return value;
+}
+
+/// <summary>
+/// 非圧縮の波形の1サンプルのビット数とブロックの大きさが正しいか
+/// </summary>
+bool IsValidLinearFormat(
+  uint16_t formatTag, uint16_t channels, uint16_t bits, uint16_t blockAlign) {
+  if (formatTag == kFormatTagPcm) {
+	if (bits != 8 && bits != 16 && bits != 24 && bits != 32) {
+	  return false;
+	}
+  } else if (formatTag == kFormatTagFloat) {
+	if (bits != 32) {
+	  return false;
+	}
+  } else {
+	return false;
+  }
+  return blockAlign == channels * (bits / 8);
+}
+
+/// <summary>
+/// MS ADPCMの波形フォーマットが正しいか
+/// </summary>
+bool IsValidAdpcmFormat(
+  const uint8_t* format, size_t size, uint16_t channels, uint16_t blockAlign) {
+  if (size < WaveParser::kWaveFormatExSize || channels > 2) {
+	return false;
+  }
+  uint16_t extraSize = ReadAt<uint16_t>(format, kExtraSizeOffset);
+  if (extraSize < kAdpcmMinExtraSize || size < WaveParser::kWaveFormatExSize + extraSize) {
+	return false;
+  }
+  if (ReadAt<uint16_t>(format, kBitsPerSampleOffset) != 4) {
+	return false;
+  }
+
+  // 係数が全て拡張部分に収まっているか
+  uint16_t coefCount = ReadAt<uint16_t>(format, kNumCoefOffset);
+  size_t coefEnd = kCoefOffset + static_cast<size_t>(coefCount) * 4;
+  if (coefCount < kAdpcmMinCoefCount || coefEnd > WaveParser::kWaveFormatExSize + extraSize) {
+	return false;
+  }
+
+  // ブロックはチャンネルごとの7バイトのヘッダ（2サンプル分）と4bitずつのサンプル
+  size_t headerSize = static_cast<size_t>(channels) * 7;
+  if (blockAlign <= headerSize) {
+	return false;
+  }
+  uint32_t samplesPerBlock = ReadAt<uint16_t>(format, kSamplesPerBlockOffset);
+  return samplesPerBlock == (blockAlign - headerSize) * 2 / channels + 2;
+}
+
+} // namespace
+
+bool WaveParser::Parse(const void* data, size_t size, WaveData& waveData) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  waveData = WaveData();
+
+  // RIFFヘッダの確認
+  if (size < kRiffHeaderSize) {
+	return false;
+  }
+  if (std::memcmp(bytes, "RIFF", 4) != 0 || std::memcmp(bytes + 8, "WAVE", 4) != 0) {
+	return false;
+  }
+  // RIFFのサイズより短いファイル（途中で切れている）はファイルの終わりまでを見る
+  uint64_t end = (std::min)(
+    static_cast<uint64_t>(ReadAt<uint32_t>(bytes, 4)) + kChunkHeaderSize,
+    static_cast<uint64_t>(size));
+
+  // チャンクを順にたどる（同じチャンクが複数あれば最初のものを使う）
+  uint64_t offset = kRiffHeaderSize;
+  while (offset + kChunkHeaderSize <= end) {
+	const uint8_t* id = bytes + offset;
+	uint32_t chunkSize = ReadAt<uint32_t>(bytes, offset + 4);
+	uint64_t body = offset + kChunkHeaderSize;
+	uint64_t remaining = end - body;
+
+	if (std::memcmp(id, "fmt ", 4) == 0) {
+	  if (chunkSize > remaining) {
+		return false;
+	  }
+	  if (!waveData.format) {
+		waveData.format = bytes + body;
+		waveData.formatSize = chunkSize;
+	  }
+	} else if (std::memcmp(id, "data", 4) == 0) {
+	  if (!waveData.samples) {
+		// 書き込み途中で止まったファイルはサイズが実際より大きいので、ある分だけを使う
+		waveData.samples = bytes + body;
+		waveData.samplesSize = static_cast<uint32_t>((std::min)(
+		  static_cast<uint64_t>(chunkSize), remaining));
+	  }
+	} else if (std::memcmp(id, "fact", 4) == 0) {
+	  if (chunkSize >= sizeof(uint32_t) && chunkSize <= remaining && waveData.sampleLength == 0) {
+		waveData.sampleLength = ReadAt<uint32_t>(bytes, body);
+	  }
+	}
+
+	// チャンクは2バイト境界に並ぶ
+	offset = body + chunkSize + (chunkSize & 1);
+  }
+
+  if (!waveData.format || !waveData.samples) {
+	return false;
+  }
+  if (!IsSupportedFormat(waveData.format, waveData.formatSize)) {
+	return false;
+  }
+
+  // 波形データはブロックの途中で切れないようにする
+  uint16_t blockAlign = ReadAt<uint16_t>(waveData.format, kBlockAlignOffset);
+  waveData.samplesSize = waveData.samplesSize / blockAlign * blockAlign;
+  return waveData.samplesSize > 0;
+}
+
+bool WaveParser::IsSupportedFormat(const uint8_t* format, size_t size) {
+  if (!format || size < kWaveFormatSize) {
+	return false;
+  }
+
+  uint16_t formatTag = ReadAt<uint16_t>(format, kFormatTagOffset);
+  uint16_t channels = ReadAt<uint16_t>(format, kChannelsOffset);
+  uint32_t samplesPerSec = ReadAt<uint32_t>(format, kSamplesPerSecOffset);
+  uint16_t blockAlign = ReadAt<uint16_t>(format, kBlockAlignOffset);
+  uint16_t bitsPerSample = ReadAt<uint16_t>(format, kBitsPerSampleOffset);
+  if (channels == 0 || channels > kMaxChannels || blockAlign == 0) {
+	return false;
+  }
+  if (samplesPerSec < kMinSampleRate || samplesPerSec > kMaxSampleRate) {
+	return false;
+  }
+
+  switch (formatTag) {
+  case kFormatTagPcm:
+  case kFormatTagFloat:
+	return IsValidLinearFormat(formatTag, channels, bitsPerSample, blockAlign);
+  case kFormatTagAdpcm:
+	return IsValidAdpcmFormat(format, size, channels, blockAlign);
+  case kFormatTagExtensible: {
+	if (size < kWaveFormatExtensibleSize) {
+	  return false;
+	}
+	uint16_t extraSize = ReadAt<uint16_t>(format, kExtraSizeOffset);
+	if (extraSize < kWaveFormatExtensibleSize - kWaveFormatExSize) {
+	  return false;
+	}
+	// 有効ビット数は格納ビット数以下（0は格納ビット数と同じ）
+	if (ReadAt<uint16_t>(format, kValidBitsOffset) > bitsPerSample) {
+	  return false;
+	}
+	// サブフォーマットはPCMか浮動小数点のみ
+	if (std::memcmp(format + kSubFormatOffset + 4, kSubFormatGuidTail, 12) != 0) {
+	  return false;
+	}
+	uint32_t subFormat = ReadAt<uint32_t>(format, kSubFormatOffset);
+	if (subFormat > UINT16_MAX) {
+	  return false;
+	}
+	return IsValidLinearFormat(
+	  static_cast<uint16_t>(subFormat), channels, bitsPerSample, blockAlign);
+  }
+  default:
+	return false;
+  }
+}
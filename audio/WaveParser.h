@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// <summary>
+/// WAVファイルの解析結果（ファイルの中身を指すだけでコピーしない）
+/// </summary>
+struct WaveData {
+  // fmtチャンクの本体（波形フォーマット。境界に揃っているとは限らない）
+  const uint8_t* format = nullptr;
+  // fmtチャンクの本体のサイズ（バイト）
+  uint32_t formatSize = 0;
+  // dataチャンクの本体（波形データ）
+  const uint8_t* samples = nullptr;
+  // 波形データのサイズ（ブロック境界に切り下げ済み）
+  uint32_t samplesSize = 0;
+  // factチャンクの1チャンネルあたりのサンプル数（圧縮形式の長さ。無ければ0）
+  uint32_t sampleLength = 0;
+};
+
+/// <summary>
+/// WAVファイルの解析
+/// メモリ上のファイルの中身のチャンクを順にたどり、fmt・data・factを探す（知らないチャンクは飛ばす）
+/// 対応する波形はPCM・32bit浮動小数点・MS ADPCMと、PCMか浮動小数点のWAVE_FORMAT_EXTENSIBLE
+/// </summary>
+class WaveParser {
+public:
+  // WAVEFORMATEXの大きさ（cbSizeまで）
+  static const size_t kWaveFormatExSize = 18;
+
+  /// <summary>
+  /// 解析
+  /// </summary>
+  /// <param name="data">ファイルの中身</param>
+  /// <param name="size">サイズ（バイト）</param>
+  /// <param name="waveData">解析結果（dataの中を指す）</param>
+  /// <returns>対応している正しいWAVならtrue</returns>
+  static bool Parse(const void* data, size_t size, WaveData& waveData);
+
+  /// <summary>
+  /// 波形フォーマットが正しく、対応しているか
+  /// </summary>
+  /// <param name="format">fmtチャンクの本体</param>
+  /// <param name="size">サイズ（バイト）</param>
+  /// <returns>対応していればtrue</returns>
+  static bool IsSupportedFormat(const uint8_t* format, size_t size);
+};
@@ -0,0 +1,143 @@
+﻿#include "WaveStream.h"
+#include "WaveParser.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/// <summary>
+/// チャンクヘッダ
+/// </summary>
+struct ChunkHeader {
+  char id[4];
+  uint32_t size;
+};
+
+} // namespace
+
+bool WaveStream::Open(const std::string& filePath, uint32_t bufferSize) {
+  Close();
+
+  file_.open(filePath, std::ios_base::binary);
+  if (!file_.is_open()) {
+	return false;
+  }
+
+  // RIFFヘッダの確認
+  ChunkHeader riff;
+  char type[4];
+  file_.read(reinterpret_cast<char*>(&riff), sizeof(riff));
+  file_.read(type, sizeof(type));
+  if (!file_ || std::memcmp(riff.id, "RIFF", 4) != 0 || std::memcmp(type, "WAVE", 4) != 0) {
+	Close();
+	return false;
+  }
+
+  // fmtとdataが見つかるまでチャンクを順にたどる（知らないチャンクは飛ばす）
+  bool hasData = false;
+  ChunkHeader chunk;
+  while (!hasData && file_.read(reinterpret_cast<char*>(&chunk), sizeof(chunk))) {
+	if (std::memcmp(chunk.id, "fmt ", 4) == 0) {
+	  format_.resize(chunk.size);
+	  file_.read(reinterpret_cast<char*>(format_.data()), chunk.size);
+	} else if (std::memcmp(chunk.id, "data", 4) == 0) {
+	  dataOffset_ = static_cast<uint64_t>(file_.tellg());
+	  dataSize_ = chunk.size;
+	  hasData = true;
+	  continue;
+	} else {
+	  file_.seekg(chunk.size, std::ios_base::cur);
+	}
+	// チャンクは2バイト境界に並ぶ
+	if (chunk.size % 2 != 0) {
+	  file_.seekg(1, std::ios_base::cur);
+	}
+  }
+  if (!hasData || !WaveParser::IsSupportedFormat(format_.data(), format_.size())) {
+	Close();
+	return false;
+  }
+
+  // fmtチャンクがPCMの16バイトしか無くてもWAVEFORMATEXとして渡せるようにする
+  if (format_.size() < WaveParser::kWaveFormatExSize) {
+	format_.resize(WaveParser::kWaveFormatExSize, 0);
+  }
+
+  // バッファはブロックの途中で切れないようにする
+  uint16_t blockAlign = 0;
+  std::memcpy(&blockAlign, format_.data() + 12, sizeof(blockAlign));
+  blockAlign = (std::max)(blockAlign, static_cast<uint16_t>(1));
+  bufferSize_ = bufferSize / blockAlign * blockAlign;
+  dataSize_ = dataSize_ / blockAlign * blockAlign;
+  if (bufferSize_ == 0 || dataSize_ == 0) {
+	Close();
+	return false;
+  }
+
+  buffers_.resize(static_cast<size_t>(bufferSize_) * kBufferCount);
+  return true;
+}
+
+void WaveStream::Close() {
+  if (file_.is_open()) {
+	file_.close();
+  }
+  file_.clear();
+  format_.clear();
+  dataOffset_ = 0;
+  dataSize_ = 0;
+  readPosition_ = 0;
+  bufferSize_ = 0;
+  buffers_.clear();
+  nextBuffer_ = 0;
+  isEndSubmitted_ = false;
+}
+
+bool WaveStream::Pump(IStreamVoice& voice) {
+  // 送り先が再生し終えたバッファの数だけ補充する
+  while (!isEndSubmitted_ && voice.GetQueuedBufferCount() < kBufferCount) {
+	uint8_t* buffer = buffers_.data() + static_cast<size_t>(nextBuffer_) * bufferSize_;
+	uint32_t size = ReadBuffer(buffer);
+
+	// 末尾まで読んだか、読み込みに失敗したら最後のバッファとして送る
+	bool isEndOfStream = (!isLoop_ && readPosition_ == dataSize_) || size < bufferSize_;
+	if (size == 0) {
+	  // 送るものが無ければ空の最後のバッファは送らずに終える
+	  isEndSubmitted_ = true;
+	  break;
+	}
+
+	voice.SubmitBuffer(buffer, size, isEndOfStream);
+	isEndSubmitted_ = isEndOfStream;
+	nextBuffer_ = (nextBuffer_ + 1) % kBufferCount;
+  }
+
+  return !isEndSubmitted_;
+}
+
+uint32_t WaveStream::ReadBuffer(uint8_t* buffer) {
+  uint32_t filled = 0;
+  while (filled < bufferSize_) {
+	if (readPosition_ == dataSize_) {
+	  if (!isLoop_) {
+		break;
+	  }
+	  // 先頭に戻って続きを埋める
+	  file_.clear();
+	  file_.seekg(static_cast<std::streamoff>(dataOffset_));
+	  readPosition_ = 0;
+	}
+
+	uint64_t remaining = dataSize_ - readPosition_;
+	uint32_t size = static_cast<uint32_t>(
+	  (std::min)(static_cast<uint64_t>(bufferSize_ - filled), remaining));
+	file_.read(reinterpret_cast<char*>(buffer + filled), size);
+	uint32_t readSize = static_cast<uint32_t>(file_.gcount());
+	filled += readSize;
+	readPosition_ += readSize;
+	if (readSize != size) {
+	  break;
+	}
+  }
+  return filled;
+}
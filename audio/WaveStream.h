@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include "SourceVoice.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// WAVファイルのストリーミング読み込み
+/// 波形データを一定の大きさずつ読み込み、少数のバッファを使い回して送り先に送る
+/// 送り先のバッファ数が減った分だけ補充するので、再生し終わったバッファだけが上書きされる
+/// </summary>
+class WaveStream {
+public:
+  // 使い回すバッファ数
+  static const uint32_t kBufferCount = 3;
+  // 1バッファの標準の大きさ（バイト）
+  static const uint32_t kDefaultBufferSize = 64 * 1024;
+
+  /// <summary>
+  /// ファイルを開いて波形データの位置を調べる
+  /// </summary>
+  /// <param name="filePath">ファイルパス</param>
+  /// <param name="bufferSize">1バッファの大きさ（ブロック境界に切り下げる）</param>
+  /// <returns>成否</returns>
+  bool Open(const std::string& filePath, uint32_t bufferSize = kDefaultBufferSize);
+
+  /// <summary>
+  /// ファイルを閉じる
+  /// </summary>
+  void Close();
+
+  /// <summary>
+  /// 空いたバッファに続きを読み込んで送る
+  /// </summary>
+  /// <param name="voice">送り先</param>
+  /// <returns>まだ送るデータが残っていればtrue</returns>
+  bool Pump(IStreamVoice& voice);
+
+  /// <summary>
+  /// ループ再生の設定（末尾まで読んだら先頭に戻る）
+  /// </summary>
+  /// <param name="isLoop">ループ再生するか</param>
+  void SetLoop(bool isLoop) { isLoop_ = isLoop; }
+
+  /// <summary>
+  /// 波形フォーマットの取得（fmtチャンクの中身。WAVEFORMATEXとして扱えるよう最低18バイトある）
+  /// </summary>
+  /// <returns>波形フォーマット</returns>
+  const uint8_t* GetFormatData() const { return format_.data(); }
+
+  /// <summary>
+  /// 最後のバッファまで送ったか
+  /// </summary>
+  /// <returns>送り終わっていればtrue</returns>
+  bool IsEndSubmitted() const { return isEndSubmitted_; }
+
+  uint64_t GetDataSize() const { return dataSize_; }
+  uint32_t GetBufferSize() const { return bufferSize_; }
+
+private:
+  /// <summary>
+  /// バッファ1つ分の読み込み（ループ再生なら先頭に戻って埋める）
+  /// </summary>
+  /// <param name="buffer">読み込み先</param>
+  /// <returns>読み込んだサイズ（バイト）</returns>
+  uint32_t ReadBuffer(uint8_t* buffer);
+
+  // ファイル
+  std::ifstream file_;
+  // 波形フォーマット
+  std::vector<uint8_t> format_;
+  // 波形データの位置
+  uint64_t dataOffset_ = 0;
+  // 波形データのサイズ
+  uint64_t dataSize_ = 0;
+  // 波形データ内の読み込み位置
+  uint64_t readPosition_ = 0;
+  // 1バッファの大きさ
+  uint32_t bufferSize_ = 0;
+  // バッファ（kBufferCount個を連続して確保する）
+  std::vector<uint8_t> buffers_;
+  // 次に使うバッファの番号
+  uint32_t nextBuffer_ = 0;
+  // ループ再生するか
+  bool isLoop_ = false;
+  // 最後のバッファまで送ったか
+  bool isEndSubmitted_ = false;
+};
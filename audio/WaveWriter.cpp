@@ -0,0 +1,89 @@
+﻿#include "WaveWriter.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// ヘッダの大きさ（RIFF + fmt + dataチャンクヘッダ）
+const size_t kHeaderSize = 44;
+// 1サンプルのビット数
+const uint16_t kBitsPerSample = 16;
+// WAVE_FORMAT_PCM
+const uint16_t kFormatTagPcm = 1;
+
+/// <summary>
+/// リトルエンディアンで書き込む
+/// </summary>
+template<typename T> void Put(uint8_t* data, size_t offset, T value) {
+  std::memcpy(data + offset, &value, sizeof(value));
+}
+
+} // namespace
+
+WaveWriter::~WaveWriter() { Close(); }
+
+bool WaveWriter::Open(const std::string& filePath, uint32_t sampleRate, uint16_t channels) {
+  assert(sampleRate > 0 && channels > 0);
+
+  Close();
+  file_.open(filePath, std::ios_base::binary | std::ios_base::trunc);
+  if (file_.fail()) {
+	file_.close();
+	return false;
+  }
+
+  sampleRate_ = sampleRate;
+  channels_ = channels;
+  dataSize_ = 0;
+  // サイズは閉じる時に書き直す
+  WriteHeader();
+  return true;
+}
+
+void WaveWriter::Write(const float* samples, uint32_t frameCount) {
+  if (!file_.is_open()) {
+	return;
+  }
+
+  size_t count = static_cast<size_t>(frameCount) * channels_;
+  converted_.resize(count);
+  for (size_t i = 0; i < count; i++) {
+	float sample = (std::min)((std::max)(samples[i], -1.0f), 1.0f);
+	converted_[i] = static_cast<int16_t>(std::lround(sample * 32767.0f));
+  }
+
+  uint32_t size = static_cast<uint32_t>(count * sizeof(int16_t));
+  file_.write(reinterpret_cast<const char*>(converted_.data()), size);
+  dataSize_ += size;
+}
+
+void WaveWriter::Close() {
+  if (!file_.is_open()) {
+	return;
+  }
+
+  file_.seekp(0);
+  WriteHeader();
+  file_.close();
+}
+
+void WaveWriter::WriteHeader() {
+  uint16_t blockAlign = static_cast<uint16_t>(channels_ * kBitsPerSample / 8);
+
+  uint8_t header[kHeaderSize];
+  std::memcpy(header, "RIFF", 4);
+  Put<uint32_t>(header, 4, static_cast<uint32_t>(kHeaderSize - 8) + dataSize_);
+  std::memcpy(header + 8, "WAVEfmt ", 8);
+  Put<uint32_t>(header, 16, 16);
+  Put<uint16_t>(header, 20, kFormatTagPcm);
+  Put<uint16_t>(header, 22, channels_);
+  Put<uint32_t>(header, 24, sampleRate_);
+  Put<uint32_t>(header, 28, sampleRate_ * blockAlign);
+  Put<uint16_t>(header, 32, blockAlign);
+  Put<uint16_t>(header, 34, kBitsPerSample);
+  std::memcpy(header + 36, "data", 4);
+  Put<uint32_t>(header, 40, dataSize_);
+  file_.write(reinterpret_cast<const char*>(header), kHeaderSize);
+}
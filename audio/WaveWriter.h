@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// WAVファイルの書き出し（16bit PCM）
+/// 浮動小数点の波形を受け取って変換し、閉じる時にヘッダのサイズを書き込む
+/// </summary>
+class WaveWriter {
+public:
+  WaveWriter() = default;
+  ~WaveWriter();
+  WaveWriter(const WaveWriter&) = delete;
+  WaveWriter& operator=(const WaveWriter&) = delete;
+
+  /// <summary>
+  /// ファイルを開いてヘッダを書き込む
+  /// </summary>
+  /// <param name="filePath">ファイルパス</param>
+  /// <param name="sampleRate">サンプリングレート</param>
+  /// <param name="channels">チャンネル数</param>
+  /// <returns>成否</returns>
+  bool Open(const std::string& filePath, uint32_t sampleRate, uint16_t channels);
+
+  /// <summary>
+  /// 波形の書き込み（-1～1の範囲外は切り詰める）
+  /// </summary>
+  /// <param name="samples">波形（チャンネル交互に frameCount * チャンネル数 個）</param>
+  /// <param name="frameCount">フレーム数</param>
+  void Write(const float* samples, uint32_t frameCount);
+
+  /// <summary>
+  /// ヘッダのサイズを書き込んで閉じる
+  /// </summary>
+  void Close();
+
+  bool IsOpen() const { return file_.is_open(); }
+  // 書き込んだ波形データのサイズ（バイト）
+  uint32_t GetDataSize() const { return dataSize_; }
+
+private:
+  /// <summary>
+  /// ヘッダの書き込み
+  /// </summary>
+  void WriteHeader();
+
+  // ファイル
+  std::ofstream file_;
+  // サンプリングレート
+  uint32_t sampleRate_ = 0;
+  // チャンネル数
+  uint16_t channels_ = 0;
+  // 書き込んだ波形データのサイズ（バイト）
+  uint32_t dataSize_ = 0;
+  // 変換結果（Writeの作業用）
+  std::vector<int16_t> converted_;
+};
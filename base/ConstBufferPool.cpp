@@ -0,0 +1,175 @@
+﻿#include "ConstBufferPool.h"
+#include <cassert>
+#include <cstring>
+#include <d3dx12.h>
+#include <utility>
+
+ConstBufferPool::Allocation::~Allocation() { Release(); }
+
+ConstBufferPool::Allocation::Allocation(Allocation&& other) noexcept
+    : index_(other.index_), cpuAddress_(other.cpuAddress_), gpuAddress_(other.gpuAddress_) {
+  other.index_ = SlotAllocator::kInvalidIndex;
+  other.cpuAddress_ = nullptr;
+  other.gpuAddress_ = 0;
+}
+
+ConstBufferPool::Allocation& ConstBufferPool::Allocation::operator=(Allocation&& other) noexcept {
+  if (this != &other) {
+	Release();
+	std::swap(index_, other.index_);
+	std::swap(cpuAddress_, other.cpuAddress_);
+	std::swap(gpuAddress_, other.gpuAddress_);
+  }
+  return *this;
+}
+
+void ConstBufferPool::Allocation::Write(const void* data, size_t size) {
+  assert(IsValid());
+  ConstBufferPool::GetInstance()->Write(*this, data, size);
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS ConstBufferPool::Allocation::GetGPUVirtualAddress() const {
+  const ConstBufferPool* pool = ConstBufferPool::GetInstance();
+  return gpuAddress_ + pool->GetFrameOffset(pool->frameIndex_);
+}
+
+void ConstBufferPool::Allocation::Release() {
+  if (IsValid()) {
+	ConstBufferPool::GetInstance()->Free(index_);
+	index_ = SlotAllocator::kInvalidIndex;
+	cpuAddress_ = nullptr;
+	gpuAddress_ = 0;
+  }
+}
+
+ConstBufferPool* ConstBufferPool::GetInstance() {
+  static ConstBufferPool instance;
+  return &instance;
+}
+
+void ConstBufferPool::Initialize(ID3D12Device* device, uint32_t frameCount) {
+  assert(device);
+  assert(frameCount > 0);
+
+  device_ = device;
+  frameCount_ = frameCount;
+  frameIndex_ = 0;
+  retiredSlots_.resize(frameCount_);
+}
+
+ConstBufferPool::Allocation ConstBufferPool::Allocate(size_t size) {
+  // 1スロットに収まらない定数バッファは扱わない
+  assert(size <= kSlotSize);
+  assert(device_);
+
+  uint32_t index = slotAllocator_.Allocate();
+  // 割り当て管理側でページが増えていたら実体を生成
+  while (pages_.size() < slotAllocator_.GetPageCount()) {
+	CreatePage();
+  }
+
+  const Page& page = pages_[index / kSlotsPerPage];
+  size_t offset = (index % kSlotsPerPage) * kSlotSize;
+
+  // スロットの先頭（フレーム0の実体）を渡す
+  Allocation allocation;
+  allocation.index_ = index;
+  allocation.cpuAddress_ = page.cpuAddress + offset;
+  allocation.gpuAddress_ = page.gpuAddress + offset;
+  return allocation;
+}
+
+void ConstBufferPool::BeginFrame(uint32_t frameIndex) {
+  assert(frameIndex < frameCount_);
+
+  size_t srcOffset = GetFrameOffset(frameIndex_);
+  size_t dstOffset = GetFrameOffset(frameIndex);
+  frameIndex_ = frameIndex;
+
+  // 前のフレームの実体を今回のフレームの実体へ写す
+  for (size_t i = 0; i < propagationJobs_.size();) {
+	PropagationJob& job = propagationJobs_[i];
+	const Page& page = pages_[job.index / kSlotsPerPage];
+	uint8_t* slot = page.cpuAddress + (job.index % kSlotsPerPage) * kSlotSize;
+	memcpy(slot + dstOffset, slot + srcOffset, kSlotSize);
+
+	// 全フレームに行き渡ったら取り除く
+	if (--job.remainingFrames == 0) {
+	  RemovePropagationJob(i);
+	} else {
+	  i++;
+	}
+  }
+
+  // このフレームの実体をGPUが使い終わったので、返却待ちのスロットを解放
+  for (uint32_t index : retiredSlots_[frameIndex_]) {
+	slotAllocator_.Free(index);
+  }
+  retiredSlots_[frameIndex_].clear();
+}
+
+void ConstBufferPool::CreatePage() {
+  HRESULT result;
+
+  Page page;
+
+  // ヒーププロパティ
+  CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+  // リソース設定
+  CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(GetFrameOffset(frameCount_));
+
+  // ページ用のアップロードバッファ生成（フレーム数分の実体を並べる）
+  result = device_->CreateCommittedResource(
+    &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+    IID_PPV_ARGS(&page.resource));
+  assert(SUCCEEDED(result));
+
+  // ページ全体を常時マッピングしておく
+  result = page.resource->Map(0, nullptr, reinterpret_cast<void**>(&page.cpuAddress));
+  assert(SUCCEEDED(result));
+  page.gpuAddress = page.resource->GetGPUVirtualAddress();
+
+  pages_.push_back(std::move(page));
+  jobIndices_.resize(
+    pages_.size() * kSlotsPerPage, static_cast<uint32_t>(SlotAllocator::kInvalidIndex));
+}
+
+void ConstBufferPool::Write(const Allocation& allocation, const void* data, size_t size) {
+  assert(size <= kSlotSize);
+
+  memcpy(allocation.cpuAddress_ + GetFrameOffset(frameIndex_), data, size);
+
+  if (frameCount_ == 1) {
+	return;
+  }
+
+  // 残りのフレームへの伝搬を登録（同じスロットへの書き込みは1つにまとめる）
+  uint32_t& jobIndex = jobIndices_[allocation.index_];
+  if (jobIndex == SlotAllocator::kInvalidIndex) {
+	jobIndex = static_cast<uint32_t>(propagationJobs_.size());
+	propagationJobs_.push_back({allocation.index_, frameCount_ - 1});
+  } else {
+	propagationJobs_[jobIndex].remainingFrames = frameCount_ - 1;
+  }
+}
+
+void ConstBufferPool::Free(uint32_t index) {
+  // 伝搬待ちの書き込みは不要になる
+  if (jobIndices_[index] != SlotAllocator::kInvalidIndex) {
+	RemovePropagationJob(jobIndices_[index]);
+  }
+
+  // 現在のフレームの実体をGPUが使い終わるまで返却しない
+  retiredSlots_[frameIndex_].push_back(index);
+}
+
+void ConstBufferPool::RemovePropagationJob(size_t jobIndex) {
+  jobIndices_[propagationJobs_[jobIndex].index] = SlotAllocator::kInvalidIndex;
+
+  // 末尾と入れ替えて取り除く
+  if (jobIndex != propagationJobs_.size() - 1) {
+	propagationJobs_[jobIndex] = propagationJobs_.back();
+	jobIndices_[propagationJobs_[jobIndex].index] = static_cast<uint32_t>(jobIndex);
+  }
+  propagationJobs_.pop_back();
+}
@@ -0,0 +1,172 @@
+﻿#pragma once
+
+#include "SlotAllocator.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <vector>
+#include <wrl.h>
+
+/// <summary>
+/// 定数バッファプール
+/// 大きなアップロードバッファ(ページ)を256バイト単位のスロットに切り分けて貸し出す
+/// GPUが前のフレームを読んでいる間に書き換えないよう、スロットはフレーム数分の実体を持つ
+/// </summary>
+class ConstBufferPool {
+public:
+  // 1スロットのサイズ（定数バッファの配置アライメント）
+  static const size_t kSlotSize = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+  // 1ページあたりのスロット数（256 * 256バイト = 64KB）
+  static const uint32_t kSlotsPerPage = 256;
+
+  /// <summary>
+  /// 確保したスロット（破棄時にプールへ返却される）
+  /// </summary>
+  class Allocation {
+  public:
+	Allocation() = default;
+	~Allocation();
+	Allocation(Allocation&& other) noexcept;
+	Allocation& operator=(Allocation&& other) noexcept;
+	Allocation(const Allocation&) = delete;
+	Allocation& operator=(const Allocation&) = delete;
+
+	/// <summary>
+	/// プールへ返却
+	/// </summary>
+	void Release();
+
+	/// <summary>
+	/// 書き込み（現在のフレームの実体に書き込み、残りのフレームへは後で伝搬する）
+	/// </summary>
+	/// <param name="data">データ</param>
+	/// <param name="size">サイズ（kSlotSize以下）</param>
+	void Write(const void* data, size_t size);
+
+	bool IsValid() const { return index_ != SlotAllocator::kInvalidIndex; }
+
+	/// <summary>
+	/// 現在のフレームの実体のGPU仮想アドレスを取得
+	/// </summary>
+	/// <returns>GPU仮想アドレス</returns>
+	D3D12_GPU_VIRTUAL_ADDRESS GetGPUVirtualAddress() const;
+
+  private:
+	friend class ConstBufferPool;
+
+	// スロット番号
+	uint32_t index_ = SlotAllocator::kInvalidIndex;
+	// フレーム0の実体のマッピング済みアドレス
+	uint8_t* cpuAddress_ = nullptr;
+	// フレーム0の実体のGPU仮想アドレス
+	D3D12_GPU_VIRTUAL_ADDRESS gpuAddress_ = 0;
+  };
+
+  /// <summary>
+  /// シングルトンインスタンスの取得
+  /// </summary>
+  /// <returns>シングルトンインスタンス</returns>
+  static ConstBufferPool* GetInstance();
+
+  /// <summary>
+  /// 初期化
+  /// </summary>
+  /// <param name="device">デバイス</param>
+  /// <param name="frameCount">同時に処理するフレーム数</param>
+  void Initialize(ID3D12Device* device, uint32_t frameCount);
+
+  /// <summary>
+  /// スロット確保
+  /// </summary>
+  /// <param name="size">定数バッファのサイズ（kSlotSize以下）</param>
+  /// <returns>確保したスロット</returns>
+  Allocation Allocate(size_t size);
+
+  /// <summary>
+  /// フレーム開始処理（そのフレームの実体をGPUが使い終わってから呼ぶ）
+  /// 前のフレームで書き込んだ内容を伝搬し、返却待ちのスロットを解放する
+  /// </summary>
+  /// <param name="frameIndex">フレーム番号</param>
+  void BeginFrame(uint32_t frameIndex);
+
+  uint32_t GetPageCount() const { return slotAllocator_.GetPageCount(); }
+  uint32_t GetUsedCount() const { return slotAllocator_.GetUsedCount(); }
+
+private:
+  ConstBufferPool() = default;
+  ~ConstBufferPool() = default;
+  ConstBufferPool(const ConstBufferPool&) = delete;
+  ConstBufferPool& operator=(const ConstBufferPool&) = delete;
+
+  /// <summary>
+  /// ページ
+  /// </summary>
+  struct Page {
+	// アップロードバッファ
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	// マッピング済みアドレス
+	uint8_t* cpuAddress = nullptr;
+	// GPU仮想アドレス
+	D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;
+  };
+
+  /// <summary>
+  /// 残りのフレームへの書き込み内容の伝搬
+  /// </summary>
+  struct PropagationJob {
+	// スロット番号
+	uint32_t index;
+	// まだ伝搬していないフレーム数
+	uint32_t remainingFrames;
+  };
+
+  // デバイス
+  ID3D12Device* device_ = nullptr;
+  // 同時に処理するフレーム数
+  uint32_t frameCount_ = 1;
+  // 現在のフレーム番号
+  uint32_t frameIndex_ = 0;
+  // スロットの割り当て管理
+  SlotAllocator slotAllocator_{kSlotsPerPage};
+  // ページコンテナ
+  std::vector<Page> pages_;
+  // 伝搬待ちの書き込み（1スロットにつき1つ）
+  std::vector<PropagationJob> propagationJobs_;
+  // スロットごとの伝搬待ちの書き込みの番号（無ければkInvalidIndex）
+  std::vector<uint32_t> jobIndices_;
+  // フレームごとの返却待ちスロット
+  std::vector<std::vector<uint32_t>> retiredSlots_;
+
+  /// <summary>
+  /// ページ生成
+  /// </summary>
+  void CreatePage();
+
+  /// <summary>
+  /// スロットの先頭から指定フレームの実体までのオフセット
+  /// </summary>
+  /// <param name="frameIndex">フレーム番号</param>
+  /// <returns>オフセット（バイト）</returns>
+  size_t GetFrameOffset(uint32_t frameIndex) const {
+	return static_cast<size_t>(frameIndex) * kSlotSize * kSlotsPerPage;
+  }
+
+  /// <summary>
+  /// 書き込み
+  /// </summary>
+  /// <param name="allocation">書き込み先スロット</param>
+  /// <param name="data">データ</param>
+  /// <param name="size">サイズ</param>
+  void Write(const Allocation& allocation, const void* data, size_t size);
+
+  /// <summary>
+  /// スロット解放（GPUが使い終わるまで返却を遅らせる）
+  /// </summary>
+  /// <param name="index">スロット番号</param>
+  void Free(uint32_t index);
+
+  /// <summary>
+  /// 伝搬待ちの書き込みを取り除く
+  /// </summary>
+  /// <param name="jobIndex">伝搬待ちの書き込みの番号</param>
+  void RemovePropagationJob(size_t jobIndex);
+};
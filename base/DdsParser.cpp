@@ -0,0 +1,155 @@
+﻿#include "DdsParser.h"
+#include <DDS.h>
+#include <DirectXTex.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace {
+
+// テクスチャの縦横の上限
+const uint32_t kMaxDimension = 16384;
+
+/// <summary>
+/// 拡張ヘッダが無い古い形式のピクセルフォーマットをDXGIフォーマットに変換する
+/// </summary>
+/// <param name="pixelFormat">ピクセルフォーマット</param>
+/// <returns>DXGIフォーマット（未対応ならDXGI_FORMAT_UNKNOWN）</returns>
+DXGI_FORMAT GetLegacyFormat(const DDS_PIXELFORMAT& pixelFormat) {
+  if (pixelFormat.flags & DDS_FOURCC) {
+	switch (pixelFormat.fourCC) {
+	case MAKEFOURCC('D', 'X', 'T', '1'):
+	  return DXGI_FORMAT_BC1_UNORM;
+	case MAKEFOURCC('D', 'X', 'T', '3'):
+	  return DXGI_FORMAT_BC2_UNORM;
+	case MAKEFOURCC('D', 'X', 'T', '5'):
+	  return DXGI_FORMAT_BC3_UNORM;
+	case MAKEFOURCC('A', 'T', 'I', '1'):
+	case MAKEFOURCC('B', 'C', '4', 'U'):
+	  return DXGI_FORMAT_BC4_UNORM;
+	case MAKEFOURCC('A', 'T', 'I', '2'):
+	case MAKEFOURCC('B', 'C', '5', 'U'):
+	  return DXGI_FORMAT_BC5_UNORM;
+	default:
+	  return DXGI_FORMAT_UNKNOWN;
+	}
+  }
+
+  // 32bitのRGB(A)のみ対応
+  if ((pixelFormat.flags & DDS_RGB) && pixelFormat.RGBBitCount == 32) {
+	if (
+	  pixelFormat.RBitMask == 0x000000ff && pixelFormat.GBitMask == 0x0000ff00 &&
+	  pixelFormat.BBitMask == 0x00ff0000 && pixelFormat.ABitMask == 0xff000000) {
+	  return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+	if (
+	  pixelFormat.RBitMask == 0x00ff0000 && pixelFormat.GBitMask == 0x0000ff00 &&
+	  pixelFormat.BBitMask == 0x000000ff) {
+	  return pixelFormat.ABitMask == 0xff000000 ? DXGI_FORMAT_B8G8R8A8_UNORM
+	                                            : DXGI_FORMAT_B8G8R8X8_UNORM;
+	}
+  }
+
+  return DXGI_FORMAT_UNKNOWN;
+}
+
+} // namespace
+
+bool DdsParser::Parse(const void* data, size_t size, TextureData& textureData) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  size_t offset = 0;
+
+  // マジックナンバーとヘッダ
+  if (size < sizeof(uint32_t) + sizeof(DDS_HEADER)) {
+	return false;
+  }
+  uint32_t magic;
+  memcpy(&magic, bytes, sizeof(magic));
+  if (magic != DDS_MAGIC) {
+	return false;
+  }
+  offset += sizeof(uint32_t);
+
+  // ファイル内のヘッダはアラインされていないのでコピーして読む
+  DDS_HEADER header;
+  memcpy(&header, bytes + offset, sizeof(header));
+  offset += sizeof(header);
+  if (header.size != sizeof(DDS_HEADER) || header.ddspf.size != sizeof(DDS_PIXELFORMAT)) {
+	return false;
+  }
+
+  // キューブマップとボリュームテクスチャは未対応
+  if ((header.caps2 & DDS_CUBEMAP) || (header.caps2 & DDS_FLAGS_VOLUME)) {
+	return false;
+  }
+
+  DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+  if ((header.ddspf.flags & DDS_FOURCC) && header.ddspf.fourCC == MAKEFOURCC('D', 'X', '1', '0')) {
+	// 拡張ヘッダ
+	if (size < offset + sizeof(DDS_HEADER_DXT10)) {
+	  return false;
+	}
+	DDS_HEADER_DXT10 headerDxt10;
+	memcpy(&headerDxt10, bytes + offset, sizeof(headerDxt10));
+	offset += sizeof(headerDxt10);
+
+	if (
+	  headerDxt10.resourceDimension != DDS_DIMENSION_TEXTURE2D || headerDxt10.arraySize != 1 ||
+	  (headerDxt10.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)) {
+	  return false;
+	}
+	format = headerDxt10.dxgiFormat;
+  } else {
+	format = GetLegacyFormat(header.ddspf);
+  }
+  if (format == DXGI_FORMAT_UNKNOWN) {
+	return false;
+  }
+
+  uint32_t mipLevels = (header.flags & DDS_HEADER_FLAGS_MIPMAP) ? header.mipMapCount : 1;
+  if (mipLevels == 0) {
+	mipLevels = 1;
+  }
+  if (
+    header.width == 0 || header.height == 0 || header.width > kMaxDimension ||
+    header.height > kMaxDimension || mipLevels > TextureData::kMaxMipLevels) {
+	return false;
+  }
+  // 1x1まで縮めた完全なミップチェーンより多い段数は壊れたファイル
+  uint32_t fullMipLevels = 0;
+  for (uint32_t size = (std::max)(header.width, header.height); size > 0; size >>= 1) {
+	fullMipLevels++;
+  }
+  if (mipLevels > fullMipLevels) {
+	return false;
+  }
+
+  textureData.format = format;
+  textureData.width = header.width;
+  textureData.height = header.height;
+  textureData.mipLevels = mipLevels;
+
+  // 各ミップレベルはヘッダの後ろに詰めて並んでいる
+  uint32_t width = header.width;
+  uint32_t height = header.height;
+  for (uint32_t i = 0; i < mipLevels; i++) {
+	size_t rowPitch = 0;
+	size_t slicePitch = 0;
+	HRESULT result = ComputePitch(format, width, height, rowPitch, slicePitch);
+	if (FAILED(result) || slicePitch > size - offset) {
+	  return false;
+	}
+
+	TextureData::Subresource& subresource = textureData.subresources[i];
+	subresource.data = bytes + offset;
+	subresource.rowPitch = rowPitch;
+	subresource.slicePitch = slicePitch;
+	offset += slicePitch;
+
+	width = width > 1 ? width / 2 : 1;
+	height = height > 1 ? height / 2 : 1;
+  }
+
+  return true;
+}
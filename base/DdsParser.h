@@ -0,0 +1,21 @@
+﻿#pragma once
+
+#include "TextureData.h"
+#include <cstddef>
+
+/// <summary>
+/// DDSファイルの解析
+/// メモリ上のファイルの中身を検証し、各ミップレベルの画素データを指すTextureDataを作る（メモリ確保なし）
+/// 対応するのはテクスチャ配列・キューブマップでない2Dテクスチャのみ
+/// </summary>
+class DdsParser {
+public:
+  /// <summary>
+  /// 解析
+  /// </summary>
+  /// <param name="data">ファイルの中身</param>
+  /// <param name="size">サイズ（バイト）</param>
+  /// <param name="textureData">解析結果（画素データはdataの中を指す）</param>
+  /// <returns>対応している正しいDDSならtrue</returns>
+  static bool Parse(const void* data, size_t size, TextureData& textureData);
+};
@@ -0,0 +1,124 @@
+﻿#include "DescriptorAllocator.h"
+#include "DirectXCommon.h"
+#include <cassert>
+
+DescriptorAllocator::DescriptorAllocator() : slotAllocator_(kDefaultCapacity) {}
+
+void DescriptorAllocator::Initialize(
+  ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t capacity) {
+  assert(device);
+  // シェーダから見えるのはCBV_SRV_UAVとサンプラーのヒープのみ
+  assert(
+    type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+
+  device_ = device;
+  type_ = type;
+  descriptorSize_ = device_->GetDescriptorHandleIncrementSize(type_);
+
+  // 増やす単位を初期サイズに合わせる
+  slotAllocator_ = SlotAllocator(capacity);
+  retiredHeaps_.clear();
+  capacity_ = 0;
+  Grow(capacity);
+}
+
+uint32_t DescriptorAllocator::Allocate() {
+  uint32_t index = slotAllocator_.Allocate();
+
+  // 空き番号がヒープに収まらなければ倍の大きさで作り直す
+  if (index >= capacity_) {
+	uint32_t capacity = capacity_ * 2;
+	while (capacity <= index) {
+	  capacity *= 2;
+	}
+	Grow(capacity);
+  }
+
+  return index;
+}
+
+void DescriptorAllocator::Free(uint32_t index) {
+  assert(index < capacity_);
+  slotAllocator_.Free(index);
+}
+
+void DescriptorAllocator::Reset() { slotAllocator_.Reset(); }
+
+void DescriptorAllocator::BeginFrame() {
+  frameCount_++;
+
+  // GPUが使い終わった古いヒープを破棄
+  for (size_t i = 0; i < retiredHeaps_.size();) {
+	if (frameCount_ - retiredHeaps_[i].frame >= DirectXCommon::kFrameCount) {
+	  retiredHeaps_[i] = std::move(retiredHeaps_.back());
+	  retiredHeaps_.pop_back();
+	} else {
+	  i++;
+	}
+  }
+}
+
+void DescriptorAllocator::Commit(uint32_t index) {
+  assert(index < capacity_);
+
+  D3D12_CPU_DESCRIPTOR_HANDLE dest = shaderVisibleCpuStart_;
+  dest.ptr += static_cast<SIZE_T>(index) * descriptorSize_;
+  device_->CopyDescriptorsSimple(1, dest, GetCpuHandle(index), type_);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::GetCpuHandle(uint32_t index) const {
+  assert(index < capacity_);
+
+  D3D12_CPU_DESCRIPTOR_HANDLE handle = cpuHeapStart_;
+  handle.ptr += static_cast<SIZE_T>(index) * descriptorSize_;
+  return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorAllocator::GetGpuHandle(uint32_t index) const {
+  assert(index < capacity_);
+
+  D3D12_GPU_DESCRIPTOR_HANDLE handle = shaderVisibleGpuStart_;
+  handle.ptr += static_cast<UINT64>(index) * descriptorSize_;
+  return handle;
+}
+
+void DescriptorAllocator::Grow(uint32_t capacity) {
+  HRESULT result = S_FALSE;
+
+  Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> cpuHeap;
+  Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> shaderVisibleHeap;
+
+  // 書き込み用のCPU専用ヒープ（シェーダから見えるヒープはコピー元にできないので別に持つ）
+  D3D12_DESCRIPTOR_HEAP_DESC descHeapDesc = {};
+  descHeapDesc.Type = type_;
+  descHeapDesc.NumDescriptors = capacity;
+  descHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+  result = device_->CreateDescriptorHeap(&descHeapDesc, IID_PPV_ARGS(&cpuHeap));
+  assert(SUCCEEDED(result));
+
+  // シェーダから見えるヒープ
+  descHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+  result = device_->CreateDescriptorHeap(&descHeapDesc, IID_PPV_ARGS(&shaderVisibleHeap));
+  assert(SUCCEEDED(result));
+
+  // 書き込み済みのデスクリプタを引き継ぐ
+  if (capacity_ > 0) {
+	device_->CopyDescriptorsSimple(
+	  capacity_, cpuHeap->GetCPUDescriptorHandleForHeapStart(), cpuHeapStart_, type_);
+	device_->CopyDescriptorsSimple(
+	  capacity_, shaderVisibleHeap->GetCPUDescriptorHandleForHeapStart(), cpuHeapStart_, type_);
+
+	// 古いシェーダ用ヒープは実行中のコマンドが参照しているかもしれないので残す
+	RetiredHeap retired;
+	retired.heap = std::move(shaderVisibleHeap_);
+	retired.frame = frameCount_;
+	retiredHeaps_.push_back(std::move(retired));
+  }
+
+  cpuHeap_ = std::move(cpuHeap);
+  shaderVisibleHeap_ = std::move(shaderVisibleHeap);
+  cpuHeapStart_ = cpuHeap_->GetCPUDescriptorHandleForHeapStart();
+  shaderVisibleCpuStart_ = shaderVisibleHeap_->GetCPUDescriptorHandleForHeapStart();
+  shaderVisibleGpuStart_ = shaderVisibleHeap_->GetGPUDescriptorHandleForHeapStart();
+  capacity_ = capacity;
+}
@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include "SlotAllocator.h"
+#include <cstdint>
+#include <d3d12.h>
+#include <vector>
+#include <wrl.h>
+
+/// <summary>
+/// デスクリプタの割り当て管理
+/// 書き込み用のCPU専用ヒープと、シェーダから見えるヒープを同じ番号で対にして持つ
+/// 足りなくなったら両方を倍の大きさで作り直し、古いシェーダ用ヒープはGPUが使い終わるまで保持する
+/// </summary>
+class DescriptorAllocator {
+public:
+  // 無効なデスクリプタ番号
+  static const uint32_t kInvalidIndex = SlotAllocator::kInvalidIndex;
+  // 最初に確保するデスクリプタ数（足りなくなるとこの単位で増やす）
+  static const uint32_t kDefaultCapacity = 1024;
+
+  /// <summary>
+  /// コンストラクタ
+  /// </summary>
+  DescriptorAllocator();
+
+  /// <summary>
+  /// 初期化
+  /// </summary>
+  /// <param name="device">デバイス</param>
+  /// <param name="type">ヒープの種類</param>
+  /// <param name="capacity">最初に確保するデスクリプタ数</param>
+  void Initialize(
+    ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t capacity = kDefaultCapacity);
+
+  /// <summary>
+  /// デスクリプタの確保（足りなければヒープを作り直す）
+  /// </summary>
+  /// <returns>デスクリプタ番号</returns>
+  uint32_t Allocate();
+
+  /// <summary>
+  /// デスクリプタの解放（GPUが使い終わってから呼ぶこと）
+  /// </summary>
+  /// <param name="index">デスクリプタ番号</param>
+  void Free(uint32_t index);
+
+  /// <summary>
+  /// 全デスクリプタの解放（ヒープの大きさは維持）
+  /// </summary>
+  void Reset();
+
+  /// <summary>
+  /// フレーム開始処理（GPUが使い終わった古いヒープを破棄する）
+  /// </summary>
+  void BeginFrame();
+
+  /// <summary>
+  /// CPU専用ヒープに書き込んだデスクリプタをシェーダから見えるヒープへコピーする
+  /// </summary>
+  /// <param name="index">デスクリプタ番号</param>
+  void Commit(uint32_t index);
+
+  /// <summary>
+  /// 書き込み用のCPUハンドルの取得（ビューの生成先）
+  /// </summary>
+  /// <param name="index">デスクリプタ番号</param>
+  /// <returns>CPU専用ヒープのハンドル</returns>
+  D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(uint32_t index) const;
+
+  /// <summary>
+  /// シェーダから参照するGPUハンドルの取得
+  /// </summary>
+  /// <param name="index">デスクリプタ番号</param>
+  /// <returns>シェーダから見えるヒープのハンドル</returns>
+  D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(uint32_t index) const;
+
+  ID3D12DescriptorHeap* GetShaderVisibleHeap() const { return shaderVisibleHeap_.Get(); }
+  uint32_t GetCapacity() const { return capacity_; }
+  uint32_t GetUsedCount() const { return slotAllocator_.GetUsedCount(); }
+
+private:
+  /// <summary>
+  /// GPUが使い終わるのを待っている古いヒープ
+  /// </summary>
+  struct RetiredHeap {
+	// シェーダから見えるヒープ
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> heap;
+	// 作り直したフレーム
+	uint64_t frame;
+  };
+
+  /// <summary>
+  /// ヒープの作り直し（中身は引き継ぐ）
+  /// </summary>
+  /// <param name="capacity">新しいデスクリプタ数</param>
+  void Grow(uint32_t capacity);
+
+  // デバイス
+  ID3D12Device* device_ = nullptr;
+  // ヒープの種類
+  D3D12_DESCRIPTOR_HEAP_TYPE type_ = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+  // デスクリプタサイズ
+  UINT descriptorSize_ = 0;
+  // 書き込み用のCPU専用ヒープ
+  Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> cpuHeap_;
+  // シェーダから見えるヒープ
+  Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> shaderVisibleHeap_;
+  // 各ヒープの先頭ハンドル
+  D3D12_CPU_DESCRIPTOR_HANDLE cpuHeapStart_ = {};
+  D3D12_CPU_DESCRIPTOR_HANDLE shaderVisibleCpuStart_ = {};
+  D3D12_GPU_DESCRIPTOR_HANDLE shaderVisibleGpuStart_ = {};
+  // ヒープのデスクリプタ数
+  uint32_t capacity_ = 0;
+  // 空き番号の管理
+  SlotAllocator slotAllocator_;
+  // GPUが使い終わるのを待っている古いヒープ
+  std::vector<RetiredHeap> retiredHeaps_;
+  // フレーム数
+  uint64_t frameCount_ = 0;
+};
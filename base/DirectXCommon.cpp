@@ -1,5 +1,7 @@
 ﻿#include "DirectXCommon.h"
+#include "ConstBufferPool.h"
 #include "SafeDelete.h"
+#include "TextureManager.h"
 #include <cassert>
 #include <vector>
 
@@ -9,6 +11,25 @@
 
 using namespace Microsoft::WRL;
 
+namespace {
+
+/// <summary>
+/// 2つの時刻の差をミリ秒で返す
+/// </summary>
+double ElapsedMilliseconds(
+  const LARGE_INTEGER& begin, const LARGE_INTEGER& end, const LARGE_INTEGER& frequency) {
+  return static_cast<double>(end.QuadPart - begin.QuadPart) * 1000.0 /
+         static_cast<double>(frequency.QuadPart);
+}
+
+} // namespace
+
+DirectXCommon::~DirectXCommon() {
+  if (fenceEvent_) {
+	CloseHandle(fenceEvent_);
+  }
+}
+
 void DirectXCommon::Initialize(WinApp* winApp) {
   // nullptrチェック
   assert(winApp);
@@ -32,6 +53,13 @@ void DirectXCommon::Initialize(WinApp* winApp) {
 
   // フェンス生成
   CreateFence();
+
+  // 一時アップロード用リングバッファ生成
+  CreateUploadRingBuffer();
+
+  // 時間計測の準備
+  QueryPerformanceFrequency(&performanceFrequency_);
+  QueryPerformanceCounter(&lastFrameTime_);
 }
 
 void DirectXCommon::PreDraw() {
@@ -65,6 +93,9 @@ void DirectXCommon::PreDraw() {
   // シザリング矩形の設定
   CD3DX12_RECT rect = CD3DX12_RECT(0, 0, WinApp::kWindowWidth, WinApp::kWindowHeight);
   commandList_->RSSetScissorRects(1, &rect);
+
+  // テクスチャのデスクリプタヒープは記録開始時に1回だけセットする
+  TextureManager::GetInstance()->SetDescriptorHeaps(commandList_.Get());
 }
 
 void DirectXCommon::PostDraw() {
@@ -79,6 +110,9 @@ void DirectXCommon::PostDraw() {
   // 命令のクローズ
   commandList_->Close();
 
+  // 読み込んだテクスチャの転送が終わってから描画するよう待たせる
+  TextureManager::GetInstance()->SubmitUploads(commandQueue_.Get());
+
   // コマンドリストの実行
   ID3D12CommandList* cmdLists[] = {commandList_.Get()}; // コマンドリストの配列
   commandQueue_->ExecuteCommandLists(1, cmdLists);
@@ -99,20 +133,78 @@ void DirectXCommon::PostDraw() {
   }
 #endif
 
-  // コマンドリストの実行完了を待つ
+  // このフレームのコマンド完了時のフェンス値を記録
   commandQueue_->Signal(fence_.Get(), ++fenceVal_);
-  if (fence_->GetCompletedValue() != fenceVal_) {
-	HANDLE event = CreateEvent(nullptr, false, false, nullptr);
-	fence_->SetEventOnCompletion(fenceVal_, event);
-	WaitForSingleObject(event, INFINITE);
-	CloseHandle(event);
+  frames_[frameIndex_].fenceValue = fenceVal_;
+  // このフレームで使った一時アップロード領域にフェンス値を付ける
+  uploadRingAllocator_.FinishFrame(fenceVal_);
+  uint64_t overflowUploadSize = 0;
+  for (OverflowUploadBuffer& overflowBuffer : overflowUploadBuffers_) {
+	if (overflowBuffer.fenceValue == 0) {
+	  overflowBuffer.fenceValue = fenceVal_;
+	  overflowUploadSize += overflowBuffer.resource->GetDesc().Width;
+	}
   }
 
-  commandAllocator_->Reset(); // キューをクリア
-  commandList_->Reset(commandAllocator_.Get(),
+  // 次のフレームコンテキストへ切り替え、GPUがそれを使い終わるまで待つ
+  // （GPUが今回のフレームを処理している間に、CPUは次のフレームを記録できる）
+  frameIndex_ = (frameIndex_ + 1) % kFrameCount;
+  LARGE_INTEGER waitBegin;
+  QueryPerformanceCounter(&waitBegin);
+  WaitForFenceValue(frames_[frameIndex_].fenceValue);
+  LARGE_INTEGER waitEnd;
+  QueryPerformanceCounter(&waitEnd);
+
+  // GPUが通過済みの一時アップロード領域を回収
+  UINT64 completedValue = fence_->GetCompletedValue();
+  uploadRingAllocator_.Reclaim(completedValue);
+  for (size_t i = 0; i < overflowUploadBuffers_.size();) {
+	if (overflowUploadBuffers_[i].fenceValue <= completedValue) {
+	  overflowUploadBuffers_[i] = std::move(overflowUploadBuffers_.back());
+	  overflowUploadBuffers_.pop_back();
+	} else {
+	  i++;
+	}
+  }
+  // 定数バッファプールもこのフレームの実体に切り替え
+  ConstBufferPool::GetInstance()->BeginFrame(frameIndex_);
+  // GPUが使い終わった解放済みテクスチャを破棄
+  TextureManager::GetInstance()->BeginFrame();
+
+  // 統計情報の更新
+  frameStatistics_.frameTime = ElapsedMilliseconds(lastFrameTime_, waitEnd, performanceFrequency_);
+  frameStatistics_.fenceWaitTime = ElapsedMilliseconds(waitBegin, waitEnd, performanceFrequency_);
+  frameStatistics_.framesInFlight = fenceVal_ - completedValue;
+  frameStatistics_.frameCount++;
+  frameStatistics_.overflowUploadSize = overflowUploadSize;
+  lastFrameTime_ = waitEnd;
+
+  ID3D12CommandAllocator* commandAllocator = frames_[frameIndex_].commandAllocator.Get();
+  commandAllocator->Reset(); // キューをクリア
+  commandList_->Reset(commandAllocator,
                       nullptr); // 再びコマンドリストを貯める準備
 }
 
+void DirectXCommon::WaitForGpu() {
+  // 提出済みの全てのコマンドの完了を待つ
+  commandQueue_->Signal(fence_.Get(), ++fenceVal_);
+  WaitForFenceValue(fenceVal_);
+}
+
+DirectXCommon::TransientAllocation
+DirectXCommon::AllocateTransient(size_t size, size_t alignment) {
+  size_t offset = uploadRingAllocator_.Allocate(size, alignment);
+  // 1フレームでリングバッファを使い切ったら専用のバッファに確保する
+  if (offset == RingAllocator::kInvalidOffset) {
+	return AllocateOverflowUpload(size, alignment);
+  }
+
+  TransientAllocation allocation;
+  allocation.cpuAddress = uploadRingMap_ + offset;
+  allocation.gpuAddress = uploadRingBuffer_->GetGPUVirtualAddress() + offset;
+  return allocation;
+}
+
 void DirectXCommon::ClearRenderTarget() {
   UINT bbIndex = swapChain_->GetCurrentBackBufferIndex();
 
@@ -238,14 +330,16 @@ void DirectXCommon::CreateSwapChain() {
 void DirectXCommon::InitializeCommand() {
   HRESULT result = S_FALSE;
 
-  // コマンドアロケータを生成
-  result = device_->CreateCommandAllocator(
-    D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator_));
-  assert(SUCCEEDED(result));
+  // フレームごとにコマンドアロケータを生成
+  for (FrameContext& frame : frames_) {
+	result = device_->CreateCommandAllocator(
+	  D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&frame.commandAllocator));
+	assert(SUCCEEDED(result));
+  }
 
   // コマンドリストを生成
   result = device_->CreateCommandList(
-    0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator_.Get(), nullptr,
+    0, D3D12_COMMAND_LIST_TYPE_DIRECT, frames_[frameIndex_].commandAllocator.Get(), nullptr,
     IID_PPV_ARGS(&commandList_));
   assert(SUCCEEDED(result));
 
@@ -328,4 +422,65 @@ void DirectXCommon::CreateFence() {
   // フェンスの生成
   result = device_->CreateFence(fenceVal_, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence_));
   assert(SUCCEEDED(result));
+
+  // フェンス待ち用イベントは使い回す
+  fenceEvent_ = CreateEvent(nullptr, false, false, nullptr);
+  assert(fenceEvent_);
+}
+
+void DirectXCommon::WaitForFenceValue(UINT64 fenceValue) {
+  if (fence_->GetCompletedValue() < fenceValue) {
+	fence_->SetEventOnCompletion(fenceValue, fenceEvent_);
+	WaitForSingleObject(fenceEvent_, INFINITE);
+  }
+}
+
+void DirectXCommon::CreateUploadRingBuffer() {
+  HRESULT result = S_FALSE;
+
+  // ヒーププロパティ
+  CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+  // リソース設定
+  CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(kUploadRingBufferSize);
+
+  // リングバッファの生成
+  result = device_->CreateCommittedResource(
+    &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+    IID_PPV_ARGS(&uploadRingBuffer_));
+  assert(SUCCEEDED(result));
+
+  // 常時マッピングしておく
+  result = uploadRingBuffer_->Map(0, nullptr, (void**)&uploadRingMap_);
+  assert(SUCCEEDED(result));
+}
+
+DirectXCommon::TransientAllocation
+DirectXCommon::AllocateOverflowUpload(size_t size, size_t alignment) {
+  HRESULT result = S_FALSE;
+
+  // バッファの先頭は64KB境界なので、サイズだけアライメントに揃える
+  size_t bufferSize = (size + alignment - 1) & ~(alignment - 1);
+  if (bufferSize == 0) {
+	bufferSize = alignment;
+  }
+
+  // ヒーププロパティ
+  CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+  // リソース設定
+  CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
+
+  // 専用バッファの生成（記録中のフレームが完了したら破棄する）
+  OverflowUploadBuffer overflowBuffer;
+  result = device_->CreateCommittedResource(
+    &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+    IID_PPV_ARGS(&overflowBuffer.resource));
+  assert(SUCCEEDED(result));
+
+  TransientAllocation allocation;
+  result = overflowBuffer.resource->Map(0, nullptr, &allocation.cpuAddress);
+  assert(SUCCEEDED(result));
+  allocation.gpuAddress = overflowBuffer.resource->GetGPUVirtualAddress();
+
+  overflowUploadBuffers_.push_back(std::move(overflowBuffer));
+  return allocation;
 }
@@ -1,19 +1,59 @@
 ﻿#pragma once
 
 #include <Windows.h>
+#include <cstdint>
 #include <cstdlib>
 #include <d3d12.h>
 #include <d3dx12.h>
 #include <dxgi1_6.h>
 #include <wrl.h>
 
+#include "RingAllocator.h"
 #include "WinApp.h"
 
 /// <summary>
 /// DirectX汎用
 /// </summary>
 class DirectXCommon {
+public: // サブクラス
+  /// <summary>
+  /// フレーム内だけ有効な一時アップロード領域
+  /// </summary>
+  struct TransientAllocation {
+	// CPUから書き込むアドレス
+	void* cpuAddress = nullptr;
+	// GPU仮想アドレス
+	D3D12_GPU_VIRTUAL_ADDRESS gpuAddress = 0;
+  };
+
+  /// <summary>
+  /// フレームの統計情報（プロファイル用）
+  /// </summary>
+  struct FrameStatistics {
+	// 前フレームからの経過時間（ミリ秒）
+	double frameTime = 0.0;
+	// フレームコンテキストが空くまでGPUを待った時間（ミリ秒）
+	double fenceWaitTime = 0.0;
+	// GPUがまだ完了していない提出済みフレーム数
+	uint64_t framesInFlight = 0;
+	// 提出したフレーム数
+	uint64_t frameCount = 0;
+	// リングバッファに入りきらず専用バッファに確保したバイト数
+	uint64_t overflowUploadSize = 0;
+  };
+
+public: // 定数
+  // 同時に処理するフレーム数
+  static const uint32_t kFrameCount = 2;
+  // 一時アップロード用リングバッファのサイズ
+  static const size_t kUploadRingBufferSize = 8 * 1024 * 1024;
+
 public: // メンバ関数
+  /// <summary>
+  /// デストラクタ
+  /// </summary>
+  ~DirectXCommon();
+
   /// <summary>
   /// 初期化
   /// </summary>
@@ -29,6 +69,11 @@ public: // メンバ関数
   /// </summary>
   void PostDraw();
 
+  /// <summary>
+  /// GPUの処理完了を待つ
+  /// </summary>
+  void WaitForGpu();
+
   /// <summary>
   /// レンダーターゲットのクリア
   /// </summary>
@@ -51,6 +96,50 @@ public: // メンバ関数
   /// <returns>描画コマンドリスト</returns>
   ID3D12GraphicsCommandList* GetCommandList() { return commandList_.Get(); }
 
+  /// <summary>
+  /// 一時アップロード領域の確保
+  /// 書き込んだ内容はこのフレームのコマンドがGPUで完了するまで保持され、その後自動で回収される
+  /// リングバッファを使い切った場合は専用のバッファを確保するので、呼び出し側で失敗を扱う必要は無い
+  /// </summary>
+  /// <param name="size">サイズ（バイト）</param>
+  /// <param name="alignment">アライメント（2のべき乗）</param>
+  /// <returns>確保した領域</returns>
+  TransientAllocation AllocateTransient(
+    size_t size, size_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+  /// <summary>
+  /// 現在のフレーム番号の取得
+  /// </summary>
+  /// <returns>フレーム番号（0～kFrameCount-1）</returns>
+  uint32_t GetFrameIndex() const { return frameIndex_; }
+
+  /// <summary>
+  /// フレームの統計情報の取得
+  /// </summary>
+  /// <returns>直近のフレームの統計情報</returns>
+  const FrameStatistics& GetFrameStatistics() const { return frameStatistics_; }
+
+private: // サブクラス
+  /// <summary>
+  /// フレームごとのコマンド記録用データ
+  /// </summary>
+  struct FrameContext {
+	// コマンドアロケータ
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
+	// このフレームのコマンド完了時のフェンス値
+	UINT64 fenceValue = 0;
+  };
+
+  /// <summary>
+  /// リングバッファに入りきらなかった一時アップロード領域の専用バッファ
+  /// </summary>
+  struct OverflowUploadBuffer {
+	// アップロードバッファ
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	// 使い終わった時のフェンス値（0ならまだ記録中のフレームで使っている）
+	UINT64 fenceValue = 0;
+  };
+
 private: // メンバ変数
   // ウィンドウズアプリケーション管理
   WinApp* winApp_;
@@ -59,7 +148,6 @@ private: // メンバ変数
   Microsoft::WRL::ComPtr<IDXGIFactory7> dxgiFactory_;
   Microsoft::WRL::ComPtr<ID3D12Device> device_;
   Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList_;
-  Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator_;
   Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue_;
   Microsoft::WRL::ComPtr<IDXGISwapChain4> swapChain_;
   std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> backBuffers_;
@@ -68,6 +156,26 @@ private: // メンバ変数
   Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> dsvHeap_;
   Microsoft::WRL::ComPtr<ID3D12Fence> fence_;
   UINT64 fenceVal_ = 0;
+  // フェンス待ち用イベント
+  HANDLE fenceEvent_ = nullptr;
+  // フレームコンテキスト
+  FrameContext frames_[kFrameCount];
+  // 現在のフレーム番号
+  uint32_t frameIndex_ = 0;
+  // フレームの統計情報
+  FrameStatistics frameStatistics_;
+  // 時間計測用の周波数
+  LARGE_INTEGER performanceFrequency_{};
+  // 前フレームの描画終了時刻
+  LARGE_INTEGER lastFrameTime_{};
+  // 一時アップロード用リングバッファ
+  Microsoft::WRL::ComPtr<ID3D12Resource> uploadRingBuffer_;
+  // 一時アップロード用リングバッファのマップ先
+  uint8_t* uploadRingMap_ = nullptr;
+  // 一時アップロード用リングバッファの割り当て管理
+  RingAllocator uploadRingAllocator_{kUploadRingBufferSize};
+  // リングバッファに入りきらなかった一時アップロード領域（GPUが使い終わるまで保持する）
+  std::vector<OverflowUploadBuffer> overflowUploadBuffers_;
 
 private: // メンバ関数
   /// <summary>
@@ -99,4 +207,23 @@ private: // メンバ関数
   /// フェンス生成
   /// </summary>
   void CreateFence();
+
+  /// <summary>
+  /// フェンス値に到達するまで待つ
+  /// </summary>
+  /// <param name="fenceValue">フェンス値</param>
+  void WaitForFenceValue(UINT64 fenceValue);
+
+  /// <summary>
+  /// 一時アップロード用リングバッファ生成
+  /// </summary>
+  void CreateUploadRingBuffer();
+
+  /// <summary>
+  /// リングバッファに入りきらなかった一時アップロード領域を専用のバッファに確保する
+  /// </summary>
+  /// <param name="size">サイズ（バイト）</param>
+  /// <param name="alignment">アライメント（2のべき乗）</param>
+  /// <returns>確保した領域</returns>
+  TransientAllocation AllocateOverflowUpload(size_t size, size_t alignment);
 };
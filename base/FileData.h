@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// ファイルの中身を全て読み込む
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="data">読み込み先</param>
+/// <returns>成否</returns>
+inline bool ReadFileData(const std::string& path, std::vector<uint8_t>& data) {
+  std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+  if (!file.is_open()) {
+	return false;
+  }
+
+  data.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0, std::ios_base::beg);
+  file.read(reinterpret_cast<char*>(data.data()), data.size());
+  return file.good();
+}
+
+/// <summary>
+/// ファイルに書き込む（既存のファイルは上書き）
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="data">データ</param>
+/// <param name="size">サイズ（バイト）</param>
+/// <returns>成否</returns>
+inline bool WriteFileData(const std::string& path, const void* data, size_t size) {
+  std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+  if (!file.is_open()) {
+	return false;
+  }
+
+  file.write(static_cast<const char*>(data), size);
+  return file.good();
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// FNV-1a ハッシュの初期値
+const uint64_t kFnv1aOffsetBasis = 14695981039346656037ull;
+// FNV-1a ハッシュの乗数
+const uint64_t kFnv1aPrime = 1099511628211ull;
+
+/// <summary>
+/// バイト列のハッシュ値を求める（FNV-1a 64bit）
+/// </summary>
+/// <param name="data">データ</param>
+/// <param name="size">サイズ（バイト）</param>
+/// <param name="hash">続きから計算する場合の途中のハッシュ値</param>
+/// <returns>ハッシュ値</returns>
+inline uint64_t HashFnv1a(const void* data, size_t size, uint64_t hash = kFnv1aOffsetBasis) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+	hash ^= bytes[i];
+	hash *= kFnv1aPrime;
+  }
+  return hash;
+}
+
+/// <summary>
+/// 文字列のハッシュ値を求める（FNV-1a 64bit）
+/// </summary>
+/// <param name="text">文字列</param>
+/// <returns>ハッシュ値</returns>
+inline uint64_t HashFnv1a(const std::string& text) { return HashFnv1a(text.data(), text.size()); }
@@ -0,0 +1,66 @@
+﻿#include "MappedFile.h"
+#include <utility>
+
+MappedFile::~MappedFile() { Close(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+	Close();
+	std::swap(file_, other.file_);
+	std::swap(mapping_, other.mapping_);
+	std::swap(data_, other.data_);
+	std::swap(size_, other.size_);
+  }
+  return *this;
+}
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+
+  file_ = CreateFileA(
+    path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) {
+	return false;
+  }
+
+  // 空のファイルはマップできない
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file_, &fileSize) || fileSize.QuadPart == 0) {
+	Close();
+	return false;
+  }
+
+  mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_ == nullptr) {
+	Close();
+	return false;
+  }
+
+  data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+  if (data_ == nullptr) {
+	Close();
+	return false;
+  }
+
+  size_ = static_cast<size_t>(fileSize.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+	UnmapViewOfFile(data_);
+	data_ = nullptr;
+  }
+  if (mapping_ != nullptr) {
+	CloseHandle(mapping_);
+	mapping_ = nullptr;
+  }
+  if (file_ != INVALID_HANDLE_VALUE) {
+	CloseHandle(file_);
+	file_ = INVALID_HANDLE_VALUE;
+  }
+  size_ = 0;
+}
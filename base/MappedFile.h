@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// 読み込み専用のメモリマップトファイル
+/// ファイルの中身をコピーせずにポインタで参照できる（ページは触れたときに読み込まれる）
+/// </summary>
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /// <summary>
+  /// ファイルを開いてマップする
+  /// </summary>
+  /// <param name="path">ファイルパス</param>
+  /// <returns>成否（空のファイルは失敗）</returns>
+  bool Open(const std::string& path);
+
+  /// <summary>
+  /// マップを解除してファイルを閉じる
+  /// </summary>
+  void Close();
+
+  bool IsOpen() const { return data_ != nullptr; }
+  const uint8_t* GetData() const { return static_cast<const uint8_t*>(data_); }
+  size_t GetSize() const { return size_; }
+
+private:
+  // ファイルハンドル
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  // ファイルマッピングオブジェクト
+  HANDLE mapping_ = nullptr;
+  // マップした先頭アドレス
+  const void* data_ = nullptr;
+  // ファイルサイズ
+  size_t size_ = 0;
+};
@@ -0,0 +1,276 @@
+﻿#include "MipGenerator.h"
+#include "ThreadPool.h"
+#include <DirectXTex.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+/// <summary>
+/// sRGBから線形への変換
+/// </summary>
+float SrgbToLinear(float value) {
+  return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+/// <summary>
+/// 線形からsRGBへの変換
+/// </summary>
+float LinearToSrgb(float value) {
+  return value <= 0.0031308f ? value * 12.92f
+                             : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+/// <summary>
+/// 色空間の変換テーブル
+/// 線形の値は4画素の合計が16bitに収まる範囲（0～4095*4）で持ち、平均を12bitに丸めて逆変換を引く
+/// </summary>
+struct ConversionTables {
+  // 線形の値の最大
+  static const uint32_t kLinearMax = 4095 * 4;
+  // 逆変換テーブルの要素数
+  static const uint32_t kEncodeSize = 4096;
+
+  // 8bitから線形へ
+  uint16_t srgbToLinear[256];
+  uint16_t unormToLinear[256];
+  // 線形から8bitへ
+  uint8_t linearToSrgb[kEncodeSize];
+  uint8_t linearToUnorm[kEncodeSize];
+
+  ConversionTables() {
+	for (uint32_t i = 0; i < 256; i++) {
+	  float value = i / 255.0f;
+	  srgbToLinear[i] = static_cast<uint16_t>(SrgbToLinear(value) * kLinearMax + 0.5f);
+	  unormToLinear[i] = static_cast<uint16_t>(value * kLinearMax + 0.5f);
+	}
+	for (uint32_t i = 0; i < kEncodeSize; i++) {
+	  float value = static_cast<float>(i) / (kEncodeSize - 1);
+	  linearToSrgb[i] = static_cast<uint8_t>(LinearToSrgb(value) * 255.0f + 0.5f);
+	  linearToUnorm[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+	}
+  }
+};
+
+/// <summary>
+/// 変換テーブルの取得（最初に使うときに作る）
+/// </summary>
+const ConversionTables& GetConversionTables() {
+  static const ConversionTables tables;
+  return tables;
+}
+
+/// <summary>
+/// 縮小に使うワーカースレッドの取得（最初に使うときに作る）
+/// </summary>
+ThreadPool& GetThreadPool() {
+  static ThreadPool threadPool;
+  return threadPool;
+}
+
+/// <summary>
+/// 線形に変換した縮小前の画素を平均して書き込む
+/// </summary>
+/// <param name="rows">線形に変換した縮小前の行</param>
+/// <param name="rowCount">平均する行数</param>
+/// <param name="column">平均する最初の列</param>
+/// <param name="columnCount">平均する列数</param>
+/// <param name="fromLinear">チャンネルごとの逆変換テーブル</param>
+/// <param name="dstPixel">書き込み先の画素</param>
+void AverageBlock(
+  const uint16_t* const* rows, uint32_t rowCount, uint32_t column, uint32_t columnCount,
+  const uint8_t* const* fromLinear, uint8_t* dstPixel) {
+  uint32_t blockSize = rowCount * columnCount;
+  for (uint32_t c = 0; c < 4; c++) {
+	uint32_t sum = 0;
+	for (uint32_t row = 0; row < rowCount; row++) {
+	  for (uint32_t dx = 0; dx < columnCount; dx++) {
+		sum += rows[row][(column + dx) * 4 + c];
+	  }
+	}
+	// 線形の値は4倍で持っているので、平均をさらに4で割って12bitに丸める
+	dstPixel[c] = fromLinear[c][(sum + blockSize * 2) / (blockSize * 4)];
+  }
+}
+
+/// <summary>
+/// DirectXTexの画像から画素データの参照を作る
+/// </summary>
+MipGenerator::Surface MakeSurface(const Image& image) {
+  MipGenerator::Surface surface;
+  surface.pixels = image.pixels;
+  surface.width = static_cast<uint32_t>(image.width);
+  surface.height = static_cast<uint32_t>(image.height);
+  surface.rowPitch = image.rowPitch;
+  return surface;
+}
+
+} // namespace
+
+bool MipGenerator::IsSupported(DXGI_FORMAT format) {
+  switch (format) {
+  case DXGI_FORMAT_R8G8B8A8_UNORM:
+  case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+  case DXGI_FORMAT_B8G8R8A8_UNORM:
+  case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+  case DXGI_FORMAT_B8G8R8X8_UNORM:
+  case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	return true;
+  default:
+	return false;
+  }
+}
+
+bool MipGenerator::Generate(const Image& source, bool isSRGB, ScratchImage& mipChain) {
+  if (!IsSupported(source.format)) {
+	return false;
+  }
+
+  // 1x1まで全てのミップレベルを確保
+  HRESULT result = mipChain.Initialize2D(source.format, source.width, source.height, 1, 0);
+  if (FAILED(result)) {
+	return false;
+  }
+
+  // 最上位はそのままコピー
+  const Image* top = mipChain.GetImage(0, 0, 0);
+  for (size_t y = 0; y < source.height; y++) {
+	std::memcpy(
+	  top->pixels + y * top->rowPitch, source.pixels + y * source.rowPitch, source.width * 4);
+  }
+
+  // 1つ上のミップから順に縮小する
+  size_t mipLevels = mipChain.GetMetadata().mipLevels;
+  for (size_t level = 1; level < mipLevels; level++) {
+	Surface src = MakeSurface(*mipChain.GetImage(level - 1, 0, 0));
+	Surface dst = MakeSurface(*mipChain.GetImage(level, 0, 0));
+
+	// 小さいミップは分割せずにこのスレッドで処理する
+	uint32_t chunkCount = (dst.height + kRowsPerChunk - 1) / kRowsPerChunk;
+	if (chunkCount <= 1) {
+	  Downsample(src, dst, isSRGB, 0, dst.height);
+	  continue;
+	}
+
+	GetThreadPool().ParallelFor(chunkCount, [&src, &dst, isSRGB](uint32_t chunk) {
+	  uint32_t rowBegin = chunk * kRowsPerChunk;
+	  uint32_t rowEnd = (std::min)(rowBegin + kRowsPerChunk, dst.height);
+	  Downsample(src, dst, isSRGB, rowBegin, rowEnd);
+	});
+  }
+
+  return true;
+}
+
+void MipGenerator::Downsample(
+  const Surface& source, const Surface& destination, bool isSRGB, uint32_t rowBegin,
+  uint32_t rowEnd) {
+  const ConversionTables& tables = GetConversionTables();
+
+  // チャンネルごとの変換テーブル（アルファは常に線形）
+  const uint16_t* colorToLinear = isSRGB ? tables.srgbToLinear : tables.unormToLinear;
+  const uint8_t* linearToColor = isSRGB ? tables.linearToSrgb : tables.linearToUnorm;
+  const uint16_t* toLinear[4] = {
+    colorToLinear, colorToLinear, colorToLinear, tables.unormToLinear};
+  const uint8_t* fromLinear[4] = {
+    linearToColor, linearToColor, linearToColor, tables.linearToUnorm};
+
+  // 幅や高さが奇数なら最後の列や行は縮小前の3画素を平均する（1なら同じ画素を2回使う）
+  bool isOddWidth = source.width > 1 && (source.width & 1);
+  bool isOddHeight = source.height > 1 && (source.height & 1);
+
+  // 縮小前の行を線形に変換して置く
+  uint32_t sampleCount = (std::max)(destination.width * 2, source.width);
+  std::vector<uint16_t> linearRows[3];
+  for (std::vector<uint16_t>& linearRow : linearRows) {
+	linearRow.resize(sampleCount * 4);
+  }
+  const uint16_t* rows[3] = {linearRows[0].data(), linearRows[1].data(), linearRows[2].data()};
+
+  // SSE2でまとめて処理する2x2の範囲の幅
+  uint32_t boxWidth = destination.width - (isOddWidth ? 1 : 0);
+
+  for (uint32_t y = rowBegin; y < rowEnd; y++) {
+	uint32_t rowCount = (isOddHeight && y == destination.height - 1) ? 3 : 2;
+	for (uint32_t row = 0; row < rowCount; row++) {
+	  uint32_t srcY = (std::min)(y * 2 + row, source.height - 1);
+	  const uint8_t* srcRow = source.pixels + srcY * source.rowPitch;
+	  uint16_t* linearRow = linearRows[row].data();
+	  for (uint32_t x = 0; x < sampleCount; x++) {
+		const uint8_t* pixel = srcRow + (std::min)(x, source.width - 1) * 4;
+		for (uint32_t c = 0; c < 4; c++) {
+		  linearRow[x * 4 + c] = toLinear[c][pixel[c]];
+		}
+	  }
+	}
+
+	uint8_t* dstRow = destination.pixels + y * destination.rowPitch;
+
+	// 縮小後の2画素（縮小前の2x4画素）ずつSSE2で合計する（3行を平均する行は端数と同じ処理）
+	const __m128i rounding = _mm_set1_epi16(8);
+	uint32_t x = 0;
+	for (; rowCount == 2 && x + 2 <= boxWidth; x += 2) {
+	  const __m128i* src0 = reinterpret_cast<const __m128i*>(rows[0] + x * 8);
+	  const __m128i* src1 = reinterpret_cast<const __m128i*>(rows[1] + x * 8);
+	  // 縦に足す
+	  __m128i left = _mm_add_epi16(_mm_loadu_si128(src0), _mm_loadu_si128(src1));
+	  __m128i right = _mm_add_epi16(_mm_loadu_si128(src0 + 1), _mm_loadu_si128(src1 + 1));
+	  // 横に隣り合う画素を足す
+	  left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+	  right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+	  // 4画素の平均を12bitに丸めて逆変換テーブルの番号にする
+	  __m128i sum = _mm_unpacklo_epi64(left, right);
+	  __m128i index = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 4);
+
+	  alignas(16) uint16_t indices[8];
+	  _mm_store_si128(reinterpret_cast<__m128i*>(indices), index);
+	  for (uint32_t i = 0; i < 8; i++) {
+		dstRow[x * 4 + i] = fromLinear[i & 3][indices[i]];
+	  }
+	}
+
+	// 端数の画素（幅が奇数なら最後の列は縮小前の3列を平均する）
+	for (; x < destination.width; x++) {
+	  uint32_t columnCount = (isOddWidth && x == destination.width - 1) ? 3 : 2;
+	  AverageBlock(rows, rowCount, x * 2, columnCount, fromLinear, dstRow + x * 4);
+	}
+  }
+}
+
+void MipGenerator::DownsampleReference(
+  const Surface& source, const Surface& destination, bool isSRGB) {
+  // 幅や高さが奇数なら最後の列や行は縮小前の3画素を平均する
+  bool isOddWidth = source.width > 1 && (source.width & 1);
+  bool isOddHeight = source.height > 1 && (source.height & 1);
+
+  for (uint32_t y = 0; y < destination.height; y++) {
+	uint32_t rowCount = (isOddHeight && y == destination.height - 1) ? 3 : 2;
+	for (uint32_t x = 0; x < destination.width; x++) {
+	  uint32_t columnCount = (isOddWidth && x == destination.width - 1) ? 3 : 2;
+	  for (uint32_t c = 0; c < 4; c++) {
+		bool isColor = isSRGB && c < 3;
+
+		// 縮小前の画素を線形空間で平均する
+		float sum = 0.0f;
+		for (uint32_t dy = 0; dy < rowCount; dy++) {
+		  for (uint32_t dx = 0; dx < columnCount; dx++) {
+			uint32_t srcX = (std::min)(x * 2 + dx, source.width - 1);
+			uint32_t srcY = (std::min)(y * 2 + dy, source.height - 1);
+			float value = source.pixels[srcY * source.rowPitch + srcX * 4 + c] / 255.0f;
+			sum += isColor ? SrgbToLinear(value) : value;
+		  }
+		}
+		float average = sum / (rowCount * columnCount);
+		float encoded = isColor ? LinearToSrgb(average) : average;
+
+		destination.pixels[y * destination.rowPitch + x * 4 + c] =
+		  static_cast<uint8_t>((std::min)(encoded, 1.0f) * 255.0f + 0.5f);
+	  }
+	}
+  }
+}
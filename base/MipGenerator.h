@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <dxgiformat.h>
+
+namespace DirectX {
+struct Image;
+class ScratchImage;
+}
+
+/// <summary>
+/// ミップマップ生成
+/// 8bitのRGBA（BGRA）画像を2x2のボックスフィルタで縮小する。sRGBの画像は線形空間に変換してから平均する
+/// 幅や高さが奇数なら最後の列や行は縮小前の3画素を平均し、端数の画素を捨てない
+/// 色空間の変換はテーブル引き、平均はSSE2で4画素分ずつ行い、行をまとめて分割して並列に処理する
+/// </summary>
+class MipGenerator {
+public:
+  // 並列処理で1回に受け持つ縮小後の行数
+  static const uint32_t kRowsPerChunk = 32;
+
+  /// <summary>
+  /// 画素データの参照
+  /// </summary>
+  struct Surface {
+	// 画素データの先頭（1画素4バイト）
+	uint8_t* pixels;
+	// 幅
+	uint32_t width;
+	// 高さ
+	uint32_t height;
+	// 1行のバイト数
+	size_t rowPitch;
+  };
+
+  /// <summary>
+  /// 対応している形式か
+  /// </summary>
+  /// <param name="format">形式</param>
+  /// <returns>1画素4バイトの8bit形式ならtrue</returns>
+  static bool IsSupported(DXGI_FORMAT format);
+
+  /// <summary>
+  /// ミップマップ生成（1x1まで全てのミップレベルを作る）
+  /// </summary>
+  /// <param name="source">最上位のミップになる画像</param>
+  /// <param name="isSRGB">色をsRGBとして線形空間で平均するか（アルファは常にそのまま平均する）</param>
+  /// <param name="mipChain">生成先</param>
+  /// <returns>成否（対応していない形式ならfalse）</returns>
+  static bool Generate(
+    const DirectX::Image& source, bool isSRGB, DirectX::ScratchImage& mipChain);
+
+  /// <summary>
+  /// 縮小（縮小後の指定した行だけを書き込む）
+  /// </summary>
+  /// <param name="source">縮小前</param>
+  /// <param name="destination">縮小後（幅と高さは縮小前の半分、最低1）</param>
+  /// <param name="isSRGB">色をsRGBとして線形空間で平均するか</param>
+  /// <param name="rowBegin">書き込む最初の行</param>
+  /// <param name="rowEnd">書き込む最後の行の次</param>
+  static void Downsample(
+    const Surface& source, const Surface& destination, bool isSRGB, uint32_t rowBegin,
+    uint32_t rowEnd);
+
+  /// <summary>
+  /// 縮小の参照実装（浮動小数点で正確に変換する。結果の確認用）
+  /// </summary>
+  /// <param name="source">縮小前</param>
+  /// <param name="destination">縮小後</param>
+  /// <param name="isSRGB">色をsRGBとして線形空間で平均するか</param>
+  static void DownsampleReference(
+    const Surface& source, const Surface& destination, bool isSRGB);
+};
@@ -0,0 +1,65 @@
+﻿#include "RingAllocator.h"
+#include <cassert>
+
+RingAllocator::RingAllocator(size_t capacity) : capacity_(capacity) { assert(capacity_ > 0); }
+
+size_t RingAllocator::Allocate(size_t size, size_t alignment) {
+  assert(size > 0);
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+  // 空になっていれば先頭から使い直す
+  if (usedSize_ == 0) {
+	head_ = 0;
+	tail_ = 0;
+  }
+
+  size_t alignedHead = (head_ + alignment - 1) & ~(alignment - 1);
+  size_t offset = kInvalidOffset;
+  size_t consumed = 0;
+
+  if (head_ >= tail_ && usedSize_ < capacity_) {
+	// 空きは [head, 末尾) と [0, tail)
+	if (alignedHead + size <= capacity_) {
+	  offset = alignedHead;
+	  consumed = alignedHead + size - head_;
+	} else if (size <= tail_) {
+	  // 末尾の余りを捨てて先頭に折り返す
+	  offset = 0;
+	  consumed = capacity_ - head_ + size;
+	}
+  } else if (head_ < tail_) {
+	// 空きは [head, tail)
+	if (alignedHead + size <= tail_) {
+	  offset = alignedHead;
+	  consumed = alignedHead + size - head_;
+	}
+  }
+
+  if (offset == kInvalidOffset) {
+	return kInvalidOffset;
+  }
+
+  head_ = offset + size;
+  usedSize_ += consumed;
+  pendingSize_ += consumed;
+
+  return offset;
+}
+
+void RingAllocator::FinishFrame(uint64_t fenceValue) {
+  if (pendingSize_ == 0) {
+	return;
+  }
+
+  regions_.push_back({fenceValue, pendingSize_});
+  pendingSize_ = 0;
+}
+
+void RingAllocator::Reclaim(uint64_t completedFenceValue) {
+  // 古い順に、GPUが通過済みの領域を解放
+  while (!regions_.empty() && regions_.front().fenceValue <= completedFenceValue) {
+	tail_ = (tail_ + regions_.front().size) % capacity_;
+	usedSize_ -= regions_.front().size;
+	regions_.pop_front();
+  }
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+/// <summary>
+/// フェンス値で寿命を管理するリングバッファの割り当て管理
+/// フレーム中は先頭を進めるだけで確保し、GPUがフェンスを通過したフレーム分をまとめて回収する
+/// GPUリソースには触れないので、フェンス値を与えれば単体で動作確認できる
+/// </summary>
+class RingAllocator {
+public:
+  // 確保失敗を表すオフセット
+  static const size_t kInvalidOffset = SIZE_MAX;
+
+  /// <summary>
+  /// コンストラクタ
+  /// </summary>
+  /// <param name="capacity">容量（バイト）</param>
+  explicit RingAllocator(size_t capacity);
+
+  /// <summary>
+  /// 確保
+  /// </summary>
+  /// <param name="size">サイズ（バイト）</param>
+  /// <param name="alignment">アライメント（2のべき乗）</param>
+  /// <returns>先頭からのオフセット（空きが無ければkInvalidOffset）</returns>
+  size_t Allocate(size_t size, size_t alignment);
+
+  /// <summary>
+  /// 前回呼び出し以降に確保した領域にフェンス値を付ける
+  /// </summary>
+  /// <param name="fenceValue">この領域を使い終わった時にGPUが通過するフェンス値</param>
+  void FinishFrame(uint64_t fenceValue);
+
+  /// <summary>
+  /// GPUが通過済みの領域を回収する
+  /// </summary>
+  /// <param name="completedFenceValue">GPUが通過済みのフェンス値</param>
+  void Reclaim(uint64_t completedFenceValue);
+
+  size_t GetCapacity() const { return capacity_; }
+  size_t GetUsedSize() const { return usedSize_; }
+
+private:
+  /// <summary>
+  /// フェンス値付きの使用中領域
+  /// </summary>
+  struct Region {
+	// 使い終わった時のフェンス値
+	uint64_t fenceValue;
+	// 消費したバイト数（アライメントや折り返しの余りを含む）
+	size_t size;
+  };
+
+  // 容量
+  size_t capacity_;
+  // 次に確保する位置
+  size_t head_ = 0;
+  // 使用中領域の先頭
+  size_t tail_ = 0;
+  // 使用中のバイト数
+  size_t usedSize_ = 0;
+  // フェンス値がまだ付いていない分のバイト数
+  size_t pendingSize_ = 0;
+  // 使用中領域（古い順）
+  std::deque<Region> regions_;
+};
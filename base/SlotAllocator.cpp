@@ -0,0 +1,50 @@
+﻿#include "SlotAllocator.h"
+#include <cassert>
+
+SlotAllocator::SlotAllocator(uint32_t slotsPerPage) : slotsPerPage_(slotsPerPage) {
+  assert(slotsPerPage_ > 0);
+}
+
+uint32_t SlotAllocator::Allocate() {
+  // 空きが無ければページを追加
+  if (freeList_.empty()) {
+	AddPage();
+  }
+
+  uint32_t index = freeList_.back();
+  freeList_.pop_back();
+  isUsed_[index] = true;
+  usedCount_++;
+
+  return index;
+}
+
+void SlotAllocator::Free(uint32_t index) {
+  assert(index < isUsed_.size());
+  assert(isUsed_[index]);
+
+  isUsed_[index] = false;
+  freeList_.push_back(index);
+  usedCount_--;
+}
+
+void SlotAllocator::Reset() {
+  freeList_.clear();
+  // 若い番号から使われるように逆順で積む
+  for (uint32_t i = pageCount_ * slotsPerPage_; i > 0; i--) {
+	freeList_.push_back(i - 1);
+  }
+  isUsed_.assign(isUsed_.size(), false);
+  usedCount_ = 0;
+}
+
+void SlotAllocator::AddPage() {
+  uint32_t begin = pageCount_ * slotsPerPage_;
+  pageCount_++;
+  isUsed_.resize(pageCount_ * slotsPerPage_, false);
+
+  // 若い番号から使われるように逆順で積む
+  for (uint32_t i = slotsPerPage_; i > 0; i--) {
+	freeList_.push_back(begin + i - 1);
+  }
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 固定サイズスロットの割り当て管理（フリーリスト方式）
+/// GPUリソースには触れないので単体で動作確認できる
+/// </summary>
+class SlotAllocator {
+public:
+  // 無効なスロット番号
+  static const uint32_t kInvalidIndex = UINT32_MAX;
+
+  /// <summary>
+  /// コンストラクタ
+  /// </summary>
+  /// <param name="slotsPerPage">1ページあたりのスロット数</param>
+  explicit SlotAllocator(uint32_t slotsPerPage);
+
+  /// <summary>
+  /// スロット確保（空きが無ければページを1つ追加する）
+  /// </summary>
+  /// <returns>スロット番号</returns>
+  uint32_t Allocate();
+
+  /// <summary>
+  /// スロット解放
+  /// </summary>
+  /// <param name="index">スロット番号</param>
+  void Free(uint32_t index);
+
+  /// <summary>
+  /// 全スロット解放（ページ数は維持）
+  /// </summary>
+  void Reset();
+
+  uint32_t GetSlotsPerPage() const { return slotsPerPage_; }
+  uint32_t GetPageCount() const { return pageCount_; }
+  uint32_t GetUsedCount() const { return usedCount_; }
+
+private:
+  // 1ページあたりのスロット数
+  uint32_t slotsPerPage_;
+  // 確保済みページ数
+  uint32_t pageCount_ = 0;
+  // 使用中スロット数
+  uint32_t usedCount_ = 0;
+  // 空きスロット番号（末尾から使う）
+  std::vector<uint32_t> freeList_;
+  // 使用中フラグ（二重解放の検出用）
+  std::vector<bool> isUsed_;
+
+  /// <summary>
+  /// ページ追加
+  /// </summary>
+  void AddPage();
+};
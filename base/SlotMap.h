@@ -0,0 +1,148 @@
+﻿#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 世代番号付きハンドルで要素を引ける固定容量のコンテナ
+/// ハンドルは下位16bitがスロット番号、上位16bitが世代番号なので、探索せずに直接引ける
+/// 削除したスロットは世代を進めるので、古いハンドルで引いても別の要素は返らない
+/// </summary>
+template<typename T> class SlotMap {
+public:
+  // 無効なハンドル
+  static const uint32_t kInvalidHandle = 0;
+  // ハンドル内のスロット番号のビット数
+  static const uint32_t kIndexBits = 16;
+  // ハンドル内のスロット番号のマスク
+  static const uint32_t kIndexMask = (1u << kIndexBits) - 1;
+  // 最大容量
+  static const uint32_t kMaxCapacity = kIndexMask + 1;
+
+  /// <summary>
+  /// 初期化（全要素を削除し、容量分のスロットを確保する）
+  /// </summary>
+  /// <param name="capacity">容量</param>
+  void Initialize(uint32_t capacity) {
+	assert(capacity > 0 && capacity <= kMaxCapacity);
+
+	slots_.assign(capacity, Slot());
+	// 若い番号から使われるように逆順で積む
+	freeIndices_.clear();
+	freeIndices_.reserve(capacity);
+	for (uint32_t i = capacity; i > 0; i--) {
+	  freeIndices_.push_back(i - 1);
+	}
+  }
+
+  /// <summary>
+  /// 要素の追加
+  /// </summary>
+  /// <param name="value">要素</param>
+  /// <returns>ハンドル（満杯ならkInvalidHandle）</returns>
+  uint32_t Insert(const T& value) {
+	if (freeIndices_.empty()) {
+	  return kInvalidHandle;
+	}
+
+	uint32_t index = freeIndices_.back();
+	freeIndices_.pop_back();
+
+	Slot& slot = slots_[index];
+	slot.value = value;
+	slot.isUsed = true;
+	return MakeHandle(index, slot.generation);
+  }
+
+  /// <summary>
+  /// 要素の削除（無効なハンドルなら何もしない）
+  /// </summary>
+  /// <param name="handle">ハンドル</param>
+  /// <returns>削除したらtrue</returns>
+  bool Remove(uint32_t handle) {
+	if (!Contains(handle)) {
+	  return false;
+	}
+
+	uint32_t index = handle & kIndexMask;
+	Slot& slot = slots_[index];
+	slot.value = T();
+	slot.isUsed = false;
+	// 0はkInvalidHandleと区別できなくなるので飛ばす
+	slot.generation++;
+	if (slot.generation == 0) {
+	  slot.generation = 1;
+	}
+	freeIndices_.push_back(index);
+	return true;
+  }
+
+  /// <summary>
+  /// ハンドルが有効か
+  /// </summary>
+  /// <param name="handle">ハンドル</param>
+  /// <returns>要素を指していればtrue</returns>
+  bool Contains(uint32_t handle) const {
+	uint32_t index = handle & kIndexMask;
+	if (index >= slots_.size()) {
+	  return false;
+	}
+	const Slot& slot = slots_[index];
+	return slot.isUsed && MakeHandle(index, slot.generation) == handle;
+  }
+
+  /// <summary>
+  /// 要素の取得
+  /// </summary>
+  /// <param name="handle">ハンドル</param>
+  /// <returns>要素（無効なハンドルならnullptr）</returns>
+  T* Get(uint32_t handle) {
+	return Contains(handle) ? &slots_[handle & kIndexMask].value : nullptr;
+  }
+  const T* Get(uint32_t handle) const {
+	return Contains(handle) ? &slots_[handle & kIndexMask].value : nullptr;
+  }
+
+  /// <summary>
+  /// 全要素に処理を行う
+  /// </summary>
+  /// <param name="func">処理（ハンドルと要素を受け取る）</param>
+  template<typename Func> void ForEach(Func func) {
+	for (uint32_t i = 0; i < slots_.size(); i++) {
+	  Slot& slot = slots_[i];
+	  if (slot.isUsed) {
+		func(MakeHandle(i, slot.generation), slot.value);
+	  }
+	}
+  }
+
+  uint32_t GetCapacity() const { return static_cast<uint32_t>(slots_.size()); }
+  uint32_t GetCount() const { return GetCapacity() - static_cast<uint32_t>(freeIndices_.size()); }
+  bool IsFull() const { return freeIndices_.empty(); }
+
+private:
+  /// <summary>
+  /// スロット
+  /// </summary>
+  struct Slot {
+	// 要素
+	T value = T();
+	// 世代番号（0は使わない）
+	uint16_t generation = 1;
+	// 使用中か
+	bool isUsed = false;
+  };
+
+  /// <summary>
+  /// ハンドルの生成
+  /// </summary>
+  static uint32_t MakeHandle(uint32_t index, uint16_t generation) {
+	return (static_cast<uint32_t>(generation) << kIndexBits) | index;
+  }
+
+  // スロット
+  std::vector<Slot> slots_;
+  // 空いているスロット番号（末尾から使う）
+  std::vector<uint32_t> freeIndices_;
+};
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+/// 固定容量のロックフリーなキュー（書き込み1スレッド、読み出し1スレッド専用）
+/// 書き込み側は読み出し側を待たないので、オーディオのコールバックなど止めたくないスレッドから使える
+/// 容量は2のべき乗で、確保は初期化時のみ
+/// </summary>
+template<typename T> class SpscQueue {
+public:
+  /// <summary>
+  /// 初期化（どちらのスレッドも使っていない時に呼ぶ）
+  /// </summary>
+  /// <param name="capacity">容量（2のべき乗）</param>
+  void Initialize(size_t capacity) {
+	assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+	buffer_.assign(capacity, T());
+	mask_ = capacity - 1;
+	head_.store(0, std::memory_order_relaxed);
+	tail_.store(0, std::memory_order_relaxed);
+  }
+
+  /// <summary>
+  /// 追加（書き込み側のスレッドから呼ぶ）
+  /// </summary>
+  /// <param name="value">値</param>
+  /// <returns>満杯で追加できなければfalse</returns>
+  bool TryPush(const T& value) {
+	size_t tail = tail_.load(std::memory_order_relaxed);
+	if (tail - head_.load(std::memory_order_acquire) > mask_) {
+	  return false;
+	}
+	buffer_[tail & mask_] = value;
+	// 値を書き終えてから読み出し側に見せる
+	tail_.store(tail + 1, std::memory_order_release);
+	return true;
+  }
+
+  /// <summary>
+  /// 取り出し（読み出し側のスレッドから呼ぶ）
+  /// </summary>
+  /// <param name="value">取り出した値</param>
+  /// <returns>空ならfalse</returns>
+  bool TryPop(T& value) {
+	size_t head = head_.load(std::memory_order_relaxed);
+	if (head == tail_.load(std::memory_order_acquire)) {
+	  return false;
+	}
+	value = buffer_[head & mask_];
+	// 値を読み終えてから書き込み側に空きを見せる
+	head_.store(head + 1, std::memory_order_release);
+	return true;
+  }
+
+  size_t GetCapacity() const { return buffer_.size(); }
+
+private:
+  // キャッシュラインのサイズ（読み書きの位置が同じラインに載って奪い合わないようにする）
+  static const size_t kCacheLineSize = 64;
+
+  // 値
+  std::vector<T> buffer_;
+  // 位置を添字にするマスク
+  size_t mask_ = 0;
+  // 読み出し位置（読み出し側だけが進める）
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  // 書き込み位置（書き込み側だけが進める）
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+};
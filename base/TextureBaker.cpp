@@ -0,0 +1,205 @@
+﻿#include "TextureBaker.h"
+#include "FileData.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include <DirectXTex.h>
+#include <Windows.h>
+#include <cctype>
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace {
+
+/// <summary>
+/// 焼き込み済みファイル名の元ファイルに由来する部分
+/// （拡張子を除き、サブディレクトリの区切りは平坦にする）
+/// </summary>
+std::string GetBakedStem(const std::string& fileName) {
+  std::string stem = fileName.substr(0, fileName.find_last_of('.'));
+  for (char& c : stem) {
+	if (c == '/' || c == '\\') {
+	  c = '_';
+	}
+  }
+  return stem;
+}
+
+/// <summary>
+/// 同じ元ファイルを焼き込んだファイル名か（stem_ハッシュ値.dds か stem_ハッシュ値_品質と版.dds）
+/// </summary>
+bool IsBakedFileOf(const std::string& bakedFileName, const std::string& stem) {
+  if (bakedFileName.compare(0, stem.size() + 1, stem + "_") != 0) {
+	return false;
+  }
+
+  // 別の元ファイル（stem_xxx.png など）と区別するため、続きがハッシュ値の形か調べる
+  std::string rest = bakedFileName.substr(stem.size() + 1);
+  const size_t kHashLength = 16;
+  if (rest.size() < kHashLength + 4 || rest.compare(rest.size() - 4, 4, ".dds") != 0) {
+	return false;
+  }
+  for (size_t i = 0; i < kHashLength; i++) {
+	if (!isxdigit(static_cast<unsigned char>(rest[i]))) {
+	  return false;
+	}
+  }
+  std::string suffix = rest.substr(kHashLength, rest.size() - 4 - kHashLength);
+  return suffix.empty() || (suffix[0] == '_' && suffix.find('_', 1) == std::string::npos);
+}
+
+} // namespace
+
+const char* const TextureBaker::kBakedDirectoryName = "baked/";
+
+std::string TextureBaker::GetBakedFilePath(
+  const std::string& directoryPath, const std::string& fileName, uint64_t contentHash,
+  Quality quality) {
+  // 元ファイルの内容のハッシュ値、圧縮品質、焼き込みの版を付ける
+  char keyText[40];
+  snprintf(
+    keyText, sizeof(keyText), "_%016llx_%c%u", static_cast<unsigned long long>(contentHash),
+    quality == Quality::kHigh ? 'h' : 'f', kBakeVersion);
+
+  return directoryPath + kBakedDirectoryName + GetBakedStem(fileName) + keyText + ".dds";
+}
+
+std::string TextureBaker::FindBakedFilePath(
+  const std::string& directoryPath, const std::string& fileName, uint64_t contentHash) {
+  for (Quality quality : {Quality::kHigh, Quality::kFast}) {
+	std::string bakedFilePath = GetBakedFilePath(directoryPath, fileName, contentHash, quality);
+	if (GetFileAttributesA(bakedFilePath.c_str()) != INVALID_FILE_ATTRIBUTES) {
+	  return bakedFilePath;
+	}
+  }
+  return std::string();
+}
+
+bool TextureBaker::Decode(const void* data, size_t size, ScratchImage& image) {
+  HRESULT result;
+
+  // WICテクスチャのロード（読み込み済みのファイルの中身から）
+  result = LoadFromWICMemory(data, size, WIC_FLAGS_NONE, nullptr, image);
+  if (FAILED(result)) {
+	return false;
+  }
+
+  ScratchImage mipChain{};
+  // ミップマップ生成（テクスチャは全てsRGBとして扱うので、色は線形空間で平均する）
+  if (MipGenerator::Generate(*image.GetImage(0, 0, 0), true, mipChain)) {
+	image = std::move(mipChain);
+	return true;
+  }
+
+  // 8bitのRGBA以外（グレースケールや16bitなど）はsRGBとして扱われないので、そのまま平均する
+  result = GenerateMipMaps(
+    image.GetImages(), image.GetImageCount(), image.GetMetadata(), TEX_FILTER_DEFAULT, 0,
+    mipChain);
+  if (SUCCEEDED(result)) {
+	image = std::move(mipChain);
+  }
+
+  return true;
+}
+
+DXGI_FORMAT TextureBaker::SelectFormat(const ScratchImage& image, Quality quality) {
+  const TexMetadata& metadata = image.GetMetadata();
+
+  // ブロック圧縮テクスチャは最上位の幅と高さが4の倍数でなければならない
+  if (metadata.width % 4 != 0 || metadata.height % 4 != 0) {
+	return DXGI_FORMAT_UNKNOWN;
+  }
+
+  if (quality == Quality::kHigh) {
+	return DXGI_FORMAT_BC7_UNORM;
+  }
+
+  // 不透明なら4bit/pixelのBC1、アルファがあれば8bit/pixelのBC3
+  return image.IsAlphaAllOpaque() ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC3_UNORM;
+}
+
+bool TextureBaker::Bake(
+  const std::string& directoryPath, const std::string& fileName, Quality quality) {
+  HRESULT result;
+
+  MappedFile sourceFile;
+  if (!sourceFile.Open(directoryPath + fileName)) {
+	return false;
+  }
+
+  // 同じ内容で焼き込み済みなら何もしない
+  uint64_t contentHash = HashFnv1a(sourceFile.GetData(), sourceFile.GetSize());
+  std::string bakedFilePath = GetBakedFilePath(directoryPath, fileName, contentHash, quality);
+  if (GetFileAttributesA(bakedFilePath.c_str()) != INVALID_FILE_ATTRIBUTES) {
+	return true;
+  }
+
+  ScratchImage image{};
+  if (!Decode(sourceFile.GetData(), sourceFile.GetSize(), image)) {
+	return false;
+  }
+
+  // ブロック圧縮（sRGBとして扱うのは読み込み時なので、ここでは値をそのまま圧縮する）
+  DXGI_FORMAT format = SelectFormat(image, quality);
+  if (format != DXGI_FORMAT_UNKNOWN) {
+	ScratchImage compressed{};
+	result = Compress(
+	  image.GetImages(), image.GetImageCount(), image.GetMetadata(), format,
+	  TEX_COMPRESS_PARALLEL, TEX_THRESHOLD_DEFAULT, compressed);
+	if (FAILED(result)) {
+	  return false;
+	}
+	image = std::move(compressed);
+  }
+
+  // 読み込み時に形式をそのまま使えるよう常に拡張ヘッダを付ける
+  Blob blob;
+  result = SaveToDDSMemory(
+    image.GetImages(), image.GetImageCount(), image.GetMetadata(), DDS_FLAGS_FORCE_DX10_EXT,
+    blob);
+  if (FAILED(result)) {
+	return false;
+  }
+
+  CreateDirectoryA((directoryPath + kBakedDirectoryName).c_str(), nullptr);
+  if (!WriteFileData(bakedFilePath, blob.GetBufferPointer(), blob.GetBufferSize())) {
+	return false;
+  }
+
+  // 元ファイルの変更前や別の品質・古い版で焼き込んだファイルを削除する
+  std::string bakedDirectoryPath = directoryPath + kBakedDirectoryName;
+  std::string stem = GetBakedStem(fileName);
+  std::string bakedFileName = bakedFilePath.substr(bakedDirectoryPath.size());
+  WIN32_FIND_DATAA findData;
+  HANDLE findHandle = FindFirstFileA((bakedDirectoryPath + stem + "_*.dds").c_str(), &findData);
+  if (findHandle != INVALID_HANDLE_VALUE) {
+	do {
+	  if (bakedFileName != findData.cFileName && IsBakedFileOf(findData.cFileName, stem)) {
+		DeleteFileA((bakedDirectoryPath + findData.cFileName).c_str());
+	  }
+	} while (FindNextFileA(findHandle, &findData));
+	FindClose(findHandle);
+  }
+
+  return true;
+}
+
+uint32_t TextureBaker::BakeDirectory(const std::string& directoryPath, Quality quality) {
+  uint32_t failedCount = 0;
+
+  WIN32_FIND_DATAA findData;
+  HANDLE findHandle = FindFirstFileA((directoryPath + "*.png").c_str(), &findData);
+  if (findHandle == INVALID_HANDLE_VALUE) {
+	return failedCount;
+  }
+
+  do {
+	if (!Bake(directoryPath, findData.cFileName, quality)) {
+	  failedCount++;
+	}
+  } while (FindNextFileA(findHandle, &findData));
+
+  FindClose(findHandle);
+  return failedCount;
+}
@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <dxgiformat.h>
+#include <string>
+
+namespace DirectX {
+class ScratchImage;
+}
+
+/// <summary>
+/// テクスチャの焼き込み
+/// PNGなどの画像をミップマップ生成・ブロック圧縮済みのDDSに変換して保存する
+/// 焼き込み先のファイル名には元ファイルの内容のハッシュ値と圧縮品質と焼き込みの版が入るので、
+/// どれかが変わると作り直され、同じ元ファイルの古い焼き込み済みファイルは削除される
+/// </summary>
+class TextureBaker {
+public:
+  // 焼き込み先のディレクトリ名（テクスチャのディレクトリからの相対パス）
+  static const char* const kBakedDirectoryName;
+  // 焼き込みの版（ミップマップ生成や圧縮の結果が変わる変更をしたら進める）
+  // 2: sRGBを線形空間で平均し、奇数の幅や高さの端を3画素で平均するミップマップ生成
+  static const uint32_t kBakeVersion = 2;
+
+  /// <summary>
+  /// 圧縮品質
+  /// </summary>
+  enum class Quality {
+	kFast, // 不透明ならBC1、半透明ならBC3
+	kHigh, // 全てBC7（焼き込みに時間がかかる）
+  };
+
+  /// <summary>
+  /// 焼き込み済みファイルのパスを求める
+  /// </summary>
+  /// <param name="directoryPath">テクスチャのディレクトリパス</param>
+  /// <param name="fileName">元のファイル名</param>
+  /// <param name="contentHash">元ファイルの内容のハッシュ値</param>
+  /// <param name="quality">圧縮品質</param>
+  /// <returns>焼き込み済みファイルのパス</returns>
+  static std::string GetBakedFilePath(
+    const std::string& directoryPath, const std::string& fileName, uint64_t contentHash,
+    Quality quality);
+
+  /// <summary>
+  /// 現在の版で焼き込み済みのファイルを探す（高品質のものを優先する）
+  /// </summary>
+  /// <param name="directoryPath">テクスチャのディレクトリパス</param>
+  /// <param name="fileName">元のファイル名</param>
+  /// <param name="contentHash">元ファイルの内容のハッシュ値</param>
+  /// <returns>焼き込み済みファイルのパス（無ければ空）</returns>
+  static std::string FindBakedFilePath(
+    const std::string& directoryPath, const std::string& fileName, uint64_t contentHash);
+
+  /// <summary>
+  /// 元ファイルの中身をデコードしてミップマップを生成する
+  /// </summary>
+  /// <param name="data">元ファイルの中身</param>
+  /// <param name="size">サイズ（バイト）</param>
+  /// <param name="image">デコード先</param>
+  /// <returns>成否</returns>
+  static bool Decode(const void* data, size_t size, DirectX::ScratchImage& image);
+
+  /// <summary>
+  /// 圧縮形式の選択
+  /// </summary>
+  /// <param name="image">圧縮前の画像</param>
+  /// <param name="quality">圧縮品質</param>
+  /// <returns>圧縮形式（ブロック圧縮できない大きさならDXGI_FORMAT_UNKNOWN）</returns>
+  static DXGI_FORMAT SelectFormat(const DirectX::ScratchImage& image, Quality quality);
+
+  /// <summary>
+  /// 1ファイルの焼き込み（焼き込み済みなら何もしない。同じ元ファイルの古い焼き込みは削除する）
+  /// </summary>
+  /// <param name="directoryPath">テクスチャのディレクトリパス</param>
+  /// <param name="fileName">元のファイル名</param>
+  /// <param name="quality">圧縮品質</param>
+  /// <returns>成否</returns>
+  static bool Bake(
+    const std::string& directoryPath, const std::string& fileName,
+    Quality quality = Quality::kFast);
+
+  /// <summary>
+  /// ディレクトリ内の全PNGの焼き込み
+  /// </summary>
+  /// <param name="directoryPath">テクスチャのディレクトリパス</param>
+  /// <param name="quality">圧縮品質</param>
+  /// <returns>焼き込みに失敗したファイル数</returns>
+  static uint32_t BakeDirectory(const std::string& directoryPath, Quality quality = Quality::kFast);
+};
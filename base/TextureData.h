@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <dxgiformat.h>
+
+/// <summary>
+/// GPUへ転送するテクスチャの中身
+/// 画素データは参照するだけなので、参照先（マップしたファイルやデコード済みの画像）より長く使わないこと
+/// </summary>
+struct TextureData {
+  // ミップレベル数の上限（16384x16384まで）
+  static const uint32_t kMaxMipLevels = 15;
+
+  /// <summary>
+  /// サブリソース（ミップレベル1枚分）
+  /// </summary>
+  struct Subresource {
+	// 画素データの先頭
+	const void* data = nullptr;
+	// 1ラインのサイズ（ブロック圧縮ならブロック1行分）
+	size_t rowPitch = 0;
+	// 1枚のサイズ
+	size_t slicePitch = 0;
+  };
+
+  // 形式
+  DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+  // 最上位ミップレベルの横幅
+  uint32_t width = 0;
+  // 最上位ミップレベルの縦幅
+  uint32_t height = 0;
+  // ミップレベル数
+  uint32_t mipLevels = 0;
+  // ミップレベルごとのサブリソース
+  std::array<Subresource, kMaxMipLevels> subresources;
+};
@@ -0,0 +1,58 @@
+﻿#include "TextureFootprint.h"
+#include <DirectXTex.h>
+
+using namespace DirectX;
+
+namespace {
+
+/// <summary>
+/// アライメントに切り上げる
+/// </summary>
+/// <param name="value">値</param>
+/// <param name="alignment">アライメント（2の累乗）</param>
+/// <returns>切り上げた値</returns>
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+bool TextureFootprint::Compute(
+  DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mipLevels,
+  TextureFootprint& footprint) {
+  if (mipLevels == 0 || mipLevels > TextureData::kMaxMipLevels) {
+	return false;
+  }
+
+  // ブロック圧縮形式は4x4ピクセル単位で配置する
+  uint32_t blockSize = IsCompressed(format) ? 4 : 1;
+
+  footprint.mipLevels = mipLevels;
+  uint64_t offset = 0;
+  for (uint32_t i = 0; i < mipLevels; i++) {
+	size_t rowSize = 0;
+	size_t sliceSize = 0;
+	HRESULT result = ComputePitch(format, width, height, rowSize, sliceSize);
+	if (FAILED(result)) {
+	  return false;
+	}
+
+	Subresource& subresource = footprint.subresources[i];
+	subresource.offset = AlignUp(offset, kPlacementAlignment);
+	subresource.width = static_cast<uint32_t>(AlignUp(width, blockSize));
+	subresource.height = static_cast<uint32_t>(AlignUp(height, blockSize));
+	subresource.rowPitch = static_cast<uint32_t>(AlignUp(rowSize, kRowPitchAlignment));
+	subresource.rowCount = static_cast<uint32_t>(ComputeScanlines(format, height));
+	subresource.rowSize = rowSize;
+
+	// 最後のラインの後ろの詰め物は必要ない
+	uint64_t paddedSize = static_cast<uint64_t>(subresource.rowPitch) * (subresource.rowCount - 1);
+	offset = subresource.offset + paddedSize + subresource.rowSize;
+
+	width = width > 1 ? width / 2 : 1;
+	height = height > 1 ? height / 2 : 1;
+  }
+  footprint.totalSize = offset;
+
+  return true;
+}
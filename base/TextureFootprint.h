@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "TextureData.h"
+#include <array>
+#include <cstdint>
+#include <dxgiformat.h>
+
+/// <summary>
+/// テクスチャをアップロードバッファに並べるときの配置
+/// ID3D12Device::GetCopyableFootprints と同じ計算をCPUだけで行うので単体で動作確認できる
+/// </summary>
+struct TextureFootprint {
+  // 1ラインの配置アライメント（D3D12_TEXTURE_DATA_PITCH_ALIGNMENT）
+  static const uint32_t kRowPitchAlignment = 256;
+  // サブリソース先頭の配置アライメント（D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT）
+  static const uint32_t kPlacementAlignment = 512;
+
+  /// <summary>
+  /// サブリソース（ミップレベル1枚分）の配置
+  /// </summary>
+  struct Subresource {
+	// バッファ先頭からのオフセット
+	uint64_t offset = 0;
+	// 横幅（ブロック圧縮ならブロック単位に切り上げ）
+	uint32_t width = 0;
+	// 縦幅（ブロック圧縮ならブロック単位に切り上げ）
+	uint32_t height = 0;
+	// 1ラインの間隔（kRowPitchAlignmentの倍数）
+	uint32_t rowPitch = 0;
+	// ライン数（ブロック圧縮ならブロック行数）
+	uint32_t rowCount = 0;
+	// 1ラインの実データのサイズ
+	uint64_t rowSize = 0;
+  };
+
+  // ミップレベル数
+  uint32_t mipLevels = 0;
+  // 全サブリソースに必要なバッファサイズ（最後のラインの詰め物は含まない）
+  uint64_t totalSize = 0;
+  // ミップレベルごとの配置
+  std::array<Subresource, TextureData::kMaxMipLevels> subresources;
+
+  /// <summary>
+  /// 配置の計算
+  /// </summary>
+  /// <param name="format">形式</param>
+  /// <param name="width">最上位ミップレベルの横幅</param>
+  /// <param name="height">最上位ミップレベルの縦幅</param>
+  /// <param name="mipLevels">ミップレベル数</param>
+  /// <param name="footprint">計算結果</param>
+  /// <returns>成否（未対応の形式やミップレベル数が多すぎる場合は失敗）</returns>
+  static bool Compute(
+    DXGI_FORMAT format, uint32_t width, uint32_t height, uint32_t mipLevels,
+    TextureFootprint& footprint);
+};
@@ -1,155 +1,588 @@
 ﻿#include "TextureManager.h"
+#include "DdsParser.h"
+#include "DirectXCommon.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "TextureBaker.h"
+#include "ThreadPool.h"
 #include <DirectXTex.h>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 
 using namespace DirectX;
 
+namespace {
+
+/// <summary>
+/// デコード済みの画像を参照するTextureDataを作る
+/// </summary>
+/// <param name="image">デコード済みの画像</param>
+/// <param name="textureData">作成先</param>
+/// <returns>成否</returns>
+bool MakeTextureData(const ScratchImage& image, TextureData& textureData) {
+  const TexMetadata& metadata = image.GetMetadata();
+  if (metadata.mipLevels > TextureData::kMaxMipLevels) {
+	return false;
+  }
+
+  textureData.format = metadata.format;
+  textureData.width = static_cast<uint32_t>(metadata.width);
+  textureData.height = static_cast<uint32_t>(metadata.height);
+  textureData.mipLevels = static_cast<uint32_t>(metadata.mipLevels);
+  for (size_t i = 0; i < metadata.mipLevels; i++) {
+	const Image* img = image.GetImage(i, 0, 0);
+	textureData.subresources[i].data = img->pixels;
+	textureData.subresources[i].rowPitch = img->rowPitch;
+	textureData.subresources[i].slicePitch = img->slicePitch;
+  }
+  return true;
+}
+
+/// <summary>
+/// テクスチャの中身の準備
+/// 焼き込み済みのDDSがあればマップして画素データを直接参照し、無ければ元ファイルをデコードする
+/// </summary>
+/// <param name="bakedFilePath">焼き込み済みファイルのパス</param>
+/// <param name="sourceFile">マップした元ファイル</param>
+/// <param name="bakedFile">焼き込み済みファイルのマップ先</param>
+/// <param name="image">デコード先</param>
+/// <param name="textureData">テクスチャの中身（bakedFileかimageを参照する）</param>
+/// <returns>成否</returns>
+bool PrepareTextureData(
+  const std::string& bakedFilePath, const MappedFile& sourceFile, MappedFile& bakedFile,
+  ScratchImage& image, TextureData& textureData) {
+  if (
+    !bakedFilePath.empty() && bakedFile.Open(bakedFilePath) &&
+    DdsParser::Parse(bakedFile.GetData(), bakedFile.GetSize(), textureData)) {
+	return true;
+  }
+  bakedFile.Close();
+
+  if (!TextureBaker::Decode(sourceFile.GetData(), sourceFile.GetSize(), image)) {
+	return false;
+  }
+  return MakeTextureData(image, textureData);
+}
+
+/// <summary>
+/// 指定したミップレベル以降だけを参照するTextureDataを作る
+/// </summary>
+/// <param name="textureData">全ミップを参照するテクスチャの中身</param>
+/// <param name="firstMip">先頭にするミップレベル</param>
+/// <returns>切り出したテクスチャの中身</returns>
+TextureData SliceMips(const TextureData& textureData, uint32_t firstMip) {
+  assert(firstMip < textureData.mipLevels);
+
+  TextureData sliced = textureData;
+  sliced.width = (std::max)(textureData.width >> firstMip, 1u);
+  sliced.height = (std::max)(textureData.height >> firstMip, 1u);
+  sliced.mipLevels = textureData.mipLevels - firstMip;
+  for (uint32_t i = 0; i < sliced.mipLevels; i++) {
+	sliced.subresources[i] = textureData.subresources[firstMip + i];
+  }
+  return sliced;
+}
+
+/// <summary>
+/// ストリーミングで常に常駐させるミップレベルを求める
+/// </summary>
+/// <param name="textureData">テクスチャの中身</param>
+/// <returns>大きさがkStreamingMinSize以下になる最初のミップレベル</returns>
+uint32_t GetMinResidentMip(const TextureData& textureData) {
+  uint32_t mip = 0;
+  while (mip + 1 < textureData.mipLevels) {
+	uint32_t width = (std::max)(textureData.width >> mip, 1u);
+	uint32_t height = (std::max)(textureData.height >> mip, 1u);
+	if ((std::max)(width, height) <= TextureManager::kStreamingMinSize) {
+	  break;
+	}
+
+	// ブロック圧縮ではリソースの大きさが4の倍数でなければならない
+	uint32_t nextWidth = (std::max)(width >> 1, 1u);
+	uint32_t nextHeight = (std::max)(height >> 1, 1u);
+	if (IsCompressed(textureData.format) && (nextWidth % 4 != 0 || nextHeight % 4 != 0)) {
+	  break;
+	}
+	mip++;
+  }
+  return mip;
+}
+
+} // namespace
+
+const char* const TextureManager::kPlaceholderFileName = "white1x1.png";
+
 uint32_t TextureManager::Load(const std::string& fileName) {
   return TextureManager::GetInstance()->LoadInternal(fileName);
 }
 
+void TextureManager::Unload(uint32_t textureHandle) {
+  TextureManager::GetInstance()->UnloadInternal(textureHandle);
+}
+
+uint32_t TextureManager::LoadAsync(const std::string& fileName) {
+  return TextureManager::GetInstance()->LoadAsyncInternal(fileName);
+}
+
+uint32_t TextureManager::LoadStreaming(const std::string& fileName) {
+  return TextureManager::GetInstance()->LoadStreamingInternal(fileName);
+}
+
+uint32_t TextureManager::LoadFromImage(const std::string& name, const ScratchImage& image) {
+  return TextureManager::GetInstance()->LoadFromImageInternal(name, image);
+}
+
 TextureManager* TextureManager::GetInstance() {
   static TextureManager instance;
   return &instance;
 }
 
-void TextureManager::Initialize(ID3D12Device* device, std::string directoryPath) {
+TextureManager::TextureManager() = default;
+
+TextureManager::~TextureManager() = default;
+
+void TextureManager::Initialize(
+  ID3D12Device* device, std::string directoryPath, size_t uploadBudget) {
   assert(device);
 
   device_ = device;
   directoryPath_ = directoryPath;
 
-  // デスクリプタサイズを取得
-  descriptorHandleIncrementSize =
-    device_->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+  // テクスチャ転送の初期化
+  uploader_.Initialize(device_, uploadBudget);
+
+  // シェーダリソースビュー用のデスクリプタヒープを生成
+  descriptorAllocator_.Initialize(device_, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
   // 全テクスチャリセット
   ResetAll();
+
+  // 既定のテクスチャを最初のスロットに読み込んでおく（以後解放しない）
+  uint32_t defaultHandle = LoadInternal(kPlaceholderFileName);
+  assert(defaultHandle == kDefaultTextureHandle);
 }
 
 void TextureManager::ResetAll() {
-  HRESULT result = S_FALSE;
-
-  // デスクリプタヒープを生成
-  D3D12_DESCRIPTOR_HEAP_DESC descHeapDesc = {};
-  descHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-  descHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE; // シェーダから見えるように
-  descHeapDesc.NumDescriptors = kNumDescriptors; // シェーダーリソースビュー1つ
-  result = device_->CreateDescriptorHeap(&descHeapDesc, IID_PPV_ARGS(&descriptorHeap_)); // 生成
-  assert(SUCCEEDED(result));
+  // 読み込み中の結果は捨てる（全てのワーカーが終わるのを待ってから取り出す）
+  if (threadPool_) {
+	threadPool_->WaitIdle();
+  }
+  std::vector<AsyncLoadResult> results;
+  {
+	std::lock_guard<std::mutex> lock(asyncResultMutex_);
+	results.swap(asyncResults_);
+  }
+
+  // 全テクスチャを解放する（GPUが使っているかもしれないので、リソースとデスクリプタと
+  // スロットは解放済みテクスチャとしてフレームが進んでから破棄する）
+  // 既定のテクスチャはハンドルを変えずに残す
+  for (size_t i = 0; i < textures_.size(); i++) {
+	uint32_t handle = MakeHandle(static_cast<uint32_t>(i), textures_[i].generation);
+	if (handle != kDefaultTextureHandle && IsValid(handle)) {
+	  ReleaseTexture(handle);
+	}
+  }
+
+  // 捨てた結果を待っていたスロットはここで空ける
+  for (const AsyncLoadResult& loadResult : results) {
+	freeIndices_.push_back(GetIndex(loadResult.handle));
+  }
+}
+
+void TextureManager::BeginFrame() {
+  frameCount_++;
+
+  // GPUが使い終わったテクスチャを破棄してスロットを空ける
+  for (size_t i = 0; i < retiredTextures_.size();) {
+	if (frameCount_ - retiredTextures_[i].frame >= DirectXCommon::kFrameCount) {
+	  if (retiredTextures_[i].releasesSlot) {
+		freeIndices_.push_back(retiredTextures_[i].index);
+	  }
+	  descriptorAllocator_.Free(retiredTextures_[i].descriptorIndex);
+	  retiredTextures_[i] = std::move(retiredTextures_.back());
+	  retiredTextures_.pop_back();
+	} else {
+	  i++;
+	}
+  }
+
+  // 作り直す前の古いデスクリプタヒープを破棄
+  descriptorAllocator_.BeginFrame();
+
+  // ワーカースレッドで完了した読み込みのGPUリソースを生成する
+  FinalizeAsyncLoads();
+
+  // 報告された使用状況とメモリ予算から常駐させるミップを決めて作り直す
+  streamer_.Update(frameCount_, residencyChanges_);
+  for (const TextureStreamer::ResidencyChange& change : residencyChanges_) {
+	ApplyResidency(change.id, change.residentMip);
+  }
+}
+
+void TextureManager::ReportUsage(uint32_t textureHandle, float screenSize) {
+  if (!IsValid(textureHandle) || screenSize <= 0.0f) {
+	return;
+  }
 
-  indexNextDescriptorHeap = 0;
+  uint32_t index = GetIndex(textureHandle);
+  if (!textures_[index].isStreaming) {
+	return;
+  }
+
+  // 画面上の大きさに対してテクスチャが何倍大きいかでミップレベルを決める
+  const TextureData& textureData = streamingSources_.at(index)->textureData;
+  float textureSize = static_cast<float>((std::max)(textureData.width, textureData.height));
+  uint32_t mip = 0;
+  if (textureSize > screenSize) {
+	mip = static_cast<uint32_t>(std::log2(textureSize / screenSize));
+  }
+  mip = (std::min)(mip, textureData.mipLevels - 1);
+
+  streamer_.ReportUsage(index, mip, frameCount_);
+}
+
+void TextureManager::SubmitUploads(ID3D12CommandQueue* graphicsQueue) {
+  uploader_.Submit(graphicsQueue);
+}
+
+void TextureManager::WaitForAsyncLoads() {
+  if (threadPool_) {
+	threadPool_->WaitIdle();
+  }
+  FinalizeAsyncLoads();
+}
 
-  // 全テクスチャを初期化
-  for (size_t i = 0; i < kNumDescriptors; i++) {
-	textures_[i].resource.Reset();
-	textures_[i].cpuDescHandleSRV.ptr = 0;
-	textures_[i].gpuDescHandleSRV.ptr = 0;
-	textures_[i].name.clear();
+bool TextureManager::IsValid(uint32_t textureHandle) const {
+  uint32_t index = GetIndex(textureHandle);
+  if (index >= textures_.size()) {
+	return false;
   }
+
+  const Texture& texture = textures_[index];
+  return (texture.resource || texture.isLoading || texture.isFailed) &&
+         MakeHandle(index, texture.generation) == textureHandle;
+}
+
+bool TextureManager::IsLoaded(uint32_t textureHandle) const {
+  return IsValid(textureHandle) && textures_[GetIndex(textureHandle)].resource;
+}
+
+bool TextureManager::IsFailed(uint32_t textureHandle) const {
+  return IsValid(textureHandle) && textures_[GetIndex(textureHandle)].isFailed;
 }
 
 const D3D12_RESOURCE_DESC TextureManager::GetResoureDesc(uint32_t textureHandle) {
 
-  assert(textureHandle < textures_.size());
-  Texture& texture = textures_.at(textureHandle);
-  return texture.resource->GetDesc();
+  assert(IsValid(textureHandle));
+  Texture& texture = textures_.at(GetIndex(textureHandle));
+  // 読み込み中と失敗時は代わりのテクスチャの情報を返す
+  if (texture.isLoading || texture.isFailed) {
+	return GetResoureDesc(kDefaultTextureHandle);
+  }
+
+  // ストリーミング中は全ミップが常駐しているときの情報を返す
+  D3D12_RESOURCE_DESC resourceDesc = texture.resource->GetDesc();
+  if (texture.isStreaming) {
+	const TextureData& textureData = streamingSources_.at(GetIndex(textureHandle))->textureData;
+	resourceDesc.Width = textureData.width;
+	resourceDesc.Height = textureData.height;
+	resourceDesc.MipLevels = static_cast<UINT16>(textureData.mipLevels);
+  }
+  return resourceDesc;
 }
 
 void TextureManager::SetGraphicsRootDescriptorTable(
-  ID3D12GraphicsCommandList* commandList, UINT rootParamIndex,
-  uint32_t textureHandle) { // デスクリプタヒープの配列
-  assert(textureHandle < textures_.size());
-  ID3D12DescriptorHeap* ppHeaps[] = {descriptorHeap_.Get()};
-  commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+  ID3D12GraphicsCommandList* commandList, UINT rootParamIndex, uint32_t textureHandle) {
+  assert(IsValid(textureHandle));
+  uint32_t descriptorIndex = GetDescriptorIndex(textureHandle);
+
+  // 記録中にヒープが作り直されていたらセットし直す
+  if (boundDescriptorHeap_ != descriptorAllocator_.GetShaderVisibleHeap()) {
+	SetDescriptorHeaps(commandList);
+  }
 
   // シェーダリソースビューをセット
   commandList->SetGraphicsRootDescriptorTable(
-    rootParamIndex, textures_[textureHandle].gpuDescHandleSRV);
+    rootParamIndex, descriptorAllocator_.GetGpuHandle(descriptorIndex));
+}
+
+void TextureManager::SetDescriptorHeaps(ID3D12GraphicsCommandList* commandList) {
+  // デスクリプタヒープの配列
+  ID3D12DescriptorHeap* ppHeaps[] = {descriptorAllocator_.GetShaderVisibleHeap()};
+  commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+  boundDescriptorHeap_ = ppHeaps[0];
+}
+
+uint32_t TextureManager::GetDescriptorIndex(uint32_t textureHandle) {
+  assert(IsValid(textureHandle));
+
+  // 読み込み中と失敗時は代わりのテクスチャのビューを参照する
+  const Texture& texture = textures_[GetIndex(textureHandle)];
+  if (texture.isLoading || texture.isFailed) {
+	return GetDescriptorIndex(kDefaultTextureHandle);
+  }
+  return texture.descriptorIndex;
 }
 
 uint32_t TextureManager::LoadInternal(const std::string& fileName) {
 
-  assert(indexNextDescriptorHeap < kNumDescriptors);
-  uint32_t handle = indexNextDescriptorHeap;
+  // 読み込み済みテクスチャを名前で検索
+  auto itName = nameToHandle_.find(fileName);
+  if (itName != nameToHandle_.end()) {
+	return AddReference(itName->second);
+  }
 
-  // 読み込み済みテクスチャを検索
-  auto it = std::find_if(textures_.begin(), textures_.end(), [&](const auto& texture) {
-	return texture.name == fileName;
-  });
-  if (it != textures_.end()) {
-	// 読み込み済みテクスチャの要素番号を取得
-	handle = static_cast<uint32_t>(std::distance(textures_.begin(), it));
-	return handle;
+  // ディレクトリパスとファイル名を連結してフルパスを得る
+  std::string fullPath = directoryPath_ + fileName;
+
+  // ファイルをマップする（中身はコピーしない）
+  MappedFile sourceFile;
+  bool isOpened = sourceFile.Open(fullPath);
+  assert(isOpened);
+
+  // 同じ内容のテクスチャが別名で読み込み済みならそれを使う
+  uint64_t contentHash = HashFnv1a(sourceFile.GetData(), sourceFile.GetSize());
+  auto itContent = contentHashToHandle_.find(contentHash);
+  if (itContent != contentHashToHandle_.end()) {
+	RegisterName(itContent->second, fileName);
+	return AddReference(itContent->second);
   }
 
+  uint32_t handle = AllocateHandle();
+
   // 書き込むテクスチャの参照
-  Texture& texture = textures_.at(handle);
-  texture.name = fileName;
+  Texture& texture = textures_.at(GetIndex(handle));
+  texture.contentHash = contentHash;
+
+  // 焼き込み済みのDDSを参照するか、デコードとミップマップ生成を行う
+  MappedFile bakedFile;
+  ScratchImage scratchImg{};
+  TextureData textureData;
+  bool isPrepared = PrepareTextureData(
+    TextureBaker::FindBakedFilePath(directoryPath_, fileName, contentHash), sourceFile, bakedFile,
+    scratchImg, textureData);
+  assert(isPrepared);
+
+  CreateTextureResource(handle, textureData);
+
+  // 索引に登録
+  RegisterName(handle, fileName);
+  contentHashToHandle_.emplace(contentHash, handle);
+
+  return AddReference(handle);
+}
+
+uint32_t TextureManager::LoadAsyncInternal(const std::string& fileName) {
+
+  // 読み込み済み・読み込み中のテクスチャを名前で検索
+  auto itName = nameToHandle_.find(fileName);
+  if (itName != nameToHandle_.end()) {
+	return AddReference(itName->second);
+  }
+
+  // ワーカースレッドはメインスレッドの分を残して生成
+  if (!threadPool_) {
+	threadPool_ = std::make_unique<ThreadPool>();
+  }
+
+  uint32_t handle = AllocateHandle();
+
+  // 読み込み完了までは代わりのテクスチャのビューを参照する
+  Texture& texture = textures_.at(GetIndex(handle));
+  texture.isLoading = true;
+
+  RegisterName(handle, fileName);
+
+  // ファイルのマップとデコードとミップマップ生成はワーカースレッドで行う
+  std::string directoryPath = directoryPath_;
+  threadPool_->Enqueue([this, handle, directoryPath, fileName]() {
+	AsyncLoadResult loadResult;
+	loadResult.handle = handle;
+	loadResult.contentHash = 0;
+	loadResult.bakedFile = std::make_unique<MappedFile>();
+	loadResult.image = std::make_unique<ScratchImage>();
+	loadResult.succeeded = false;
+
+	MappedFile sourceFile;
+	if (sourceFile.Open(directoryPath + fileName)) {
+	  loadResult.contentHash = HashFnv1a(sourceFile.GetData(), sourceFile.GetSize());
+	  loadResult.succeeded = PrepareTextureData(
+	    TextureBaker::FindBakedFilePath(directoryPath, fileName, loadResult.contentHash),
+	    sourceFile, *loadResult.bakedFile, *loadResult.image, loadResult.textureData);
+	}
+
+	std::lock_guard<std::mutex> lock(asyncResultMutex_);
+	asyncResults_.push_back(std::move(loadResult));
+  });
+
+  return AddReference(handle);
+}
+
+uint32_t TextureManager::LoadStreamingInternal(const std::string& fileName) {
+
+  // 読み込み済みテクスチャを名前で検索
+  auto itName = nameToHandle_.find(fileName);
+  if (itName != nameToHandle_.end()) {
+	return AddReference(itName->second);
+  }
 
   // ディレクトリパスとファイル名を連結してフルパスを得る
   std::string fullPath = directoryPath_ + fileName;
 
-  // ユニコード文字列に変換
-  wchar_t wfilePath[256];
-  MultiByteToWideChar(CP_ACP, 0, fullPath.c_str(), -1, wfilePath, _countof(wfilePath));
+  MappedFile sourceFile;
+  bool isOpened = sourceFile.Open(fullPath);
+  assert(isOpened);
 
-  HRESULT result;
+  // 同じ内容のテクスチャが別名で読み込み済みならそれを使う
+  uint64_t contentHash = HashFnv1a(sourceFile.GetData(), sourceFile.GetSize());
+  auto itContent = contentHashToHandle_.find(contentHash);
+  if (itContent != contentHashToHandle_.end()) {
+	RegisterName(itContent->second, fileName);
+	return AddReference(itContent->second);
+  }
 
-  TexMetadata metadata{};
-  ScratchImage scratchImg{};
+  uint32_t handle = AllocateHandle();
+  uint32_t index = GetIndex(handle);
+
+  // 書き込むテクスチャの参照
+  Texture& texture = textures_.at(index);
+  texture.contentHash = contentHash;
+
+  // 細かいミップを後から転送できるよう、全ミップを参照したまま保持する
+  std::unique_ptr<StreamingSource> source = std::make_unique<StreamingSource>();
+  source->bakedFile = std::make_unique<MappedFile>();
+  source->image = std::make_unique<ScratchImage>();
+  bool isPrepared = PrepareTextureData(
+    TextureBaker::FindBakedFilePath(directoryPath_, fileName, contentHash), sourceFile,
+    *source->bakedFile, *source->image, source->textureData);
+  assert(isPrepared);
+
+  // 最初は粗いミップだけを転送する
+  const TextureData& textureData = source->textureData;
+  uint32_t minResidentMip = GetMinResidentMip(textureData);
+  CreateTextureResource(handle, SliceMips(textureData, minResidentMip));
+
+  // 常駐管理に登録
+  uint64_t mipSizes[TextureData::kMaxMipLevels];
+  for (uint32_t i = 0; i < textureData.mipLevels; i++) {
+	mipSizes[i] = textureData.subresources[i].slicePitch;
+  }
+  streamer_.Register(index, mipSizes, textureData.mipLevels, minResidentMip);
+  texture.isStreaming = true;
+  streamingSources_.emplace(index, std::move(source));
+
+  // 索引に登録
+  RegisterName(handle, fileName);
+  contentHashToHandle_.emplace(contentHash, handle);
+
+  return AddReference(handle);
+}
+
+uint32_t TextureManager::LoadFromImageInternal(
+  const std::string& name, const ScratchImage& image) {
+
+  // 読み込み済みテクスチャを名前で検索
+  auto itName = nameToHandle_.find(name);
+  if (itName != nameToHandle_.end()) {
+	return AddReference(itName->second);
+  }
+
+  TextureData textureData;
+  bool isPrepared = MakeTextureData(image, textureData);
+  assert(isPrepared);
+
+  uint32_t handle = AllocateHandle();
 
-  // WICテクスチャのロード
-  result = LoadFromWICFile(wfilePath, WIC_FLAGS_NONE, &metadata, scratchImg);
-  assert(SUCCEEDED(result));  
+  CreateTextureResource(handle, textureData);
 
-  ScratchImage mipChain{};
-  // ミップマップ生成
-  result = GenerateMipMaps(
-    scratchImg.GetImages(), scratchImg.GetImageCount(), scratchImg.GetMetadata(),
-    TEX_FILTER_DEFAULT, 0, mipChain);
-  if (SUCCEEDED(result)) {
-	scratchImg = std::move(mipChain);
-	metadata = scratchImg.GetMetadata();	
+  // ファイルの内容が無いので名前だけで引けるようにする
+  RegisterName(handle, name);
+
+  return AddReference(handle);
+}
+
+void TextureManager::ApplyResidency(uint32_t index, uint32_t residentMip) {
+  Texture& texture = textures_.at(index);
+  assert(texture.isStreaming);
+
+  // 古いリソースとビューはGPUが使い終わってから破棄する
+  RetiredTexture retired;
+  retired.resource = std::move(texture.resource);
+  retired.index = index;
+  retired.descriptorIndex = texture.descriptorIndex;
+  retired.frame = frameCount_;
+  retired.releasesSlot = false;
+  retiredTextures_.push_back(std::move(retired));
+
+  // 指定したミップ以降だけを持つリソースを新しいビューで作り直す
+  CreateTextureResource(
+    MakeHandle(index, texture.generation),
+    SliceMips(streamingSources_.at(index)->textureData, residentMip));
+}
+
+void TextureManager::FinalizeAsyncLoads() {
+  std::vector<AsyncLoadResult> results;
+  {
+	std::lock_guard<std::mutex> lock(asyncResultMutex_);
+	results.swap(asyncResults_);
   }
 
+  for (AsyncLoadResult& loadResult : results) {
+	uint32_t index = GetIndex(loadResult.handle);
+	Texture& texture = textures_[index];
+
+	// 読み込み中に解放されていたらスロットを空けるだけ
+	if (!texture.isLoading || MakeHandle(index, texture.generation) != loadResult.handle) {
+	  freeIndices_.push_back(index);
+	  continue;
+	}
+
+	// 失敗したら読み込み中を解除し、解放されるまで代わりのテクスチャのまま描画する
+	texture.isLoading = false;
+	if (!loadResult.succeeded) {
+	  texture.isFailed = true;
+	  OutputDebugStringA(("Failed to load texture: " + texture.names.front() + "\n").c_str());
+	  continue;
+	}
+
+	CreateTextureResource(loadResult.handle, loadResult.textureData);
+	texture.contentHash = loadResult.contentHash;
+
+	// 同じ内容のテクスチャが読み込み済みなら索引はそちらを優先する
+	contentHashToHandle_.emplace(loadResult.contentHash, loadResult.handle);
+  }
+}
+
+void TextureManager::CreateTextureResource(
+  uint32_t textureHandle, const TextureData& textureData) {
+  HRESULT result;
+
+  // 書き込むテクスチャの参照
+  Texture& texture = textures_.at(GetIndex(textureHandle));
+
   // 読み込んだディフューズテクスチャをSRGBとして扱う
-  metadata.format = MakeSRGB(metadata.format);
+  DXGI_FORMAT format = MakeSRGB(textureData.format);
 
   // リソース設定
   CD3DX12_RESOURCE_DESC texresDesc = CD3DX12_RESOURCE_DESC::Tex2D(
-    metadata.format, metadata.width, (UINT)metadata.height, (UINT16)metadata.arraySize,
-    (UINT16)metadata.mipLevels);
+    format, textureData.width, textureData.height, 1, (UINT16)textureData.mipLevels);
 
-  // ヒーププロパティ
-  CD3DX12_HEAP_PROPERTIES heapProps =
-    CD3DX12_HEAP_PROPERTIES(D3D12_CPU_PAGE_PROPERTY_WRITE_BACK, D3D12_MEMORY_POOL_L0);
+  // ヒーププロパティ（GPU専用のメモリに置く）
+  CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
 
   // テクスチャ用バッファの生成
   result = device_->CreateCommittedResource(
     &heapProps, D3D12_HEAP_FLAG_NONE, &texresDesc,
-    D3D12_RESOURCE_STATE_GENERIC_READ, // テクスチャ用指定
+    D3D12_RESOURCE_STATE_COMMON, // コピーキューと描画キューで暗黙に状態遷移させる
     nullptr, IID_PPV_ARGS(&texture.resource));
   assert(SUCCEEDED(result));
 
-  // テクスチャバッファにデータ転送
-  for (size_t i = 0; i < metadata.mipLevels; i++) {
-	const Image* img = scratchImg.GetImage(i, 0, 0); // 生データ抽出
-	result = texture.resource->WriteToSubresource(
-	  (UINT)i,
-	  nullptr,              // 全領域へコピー
-	  img->pixels,          // 元データアドレス
-	  (UINT)img->rowPitch,  // 1ラインサイズ
-	  (UINT)img->slicePitch // 1枚サイズ
-	);
-	assert(SUCCEEDED(result));
-  }  
+  // テクスチャバッファにデータ転送（マップしたファイルやデコード済みの画像から直接）
+  uploader_.Upload(texture.resource.Get(), textureData);
 
   // シェーダリソースビュー作成
-  texture.cpuDescHandleSRV = CD3DX12_CPU_DESCRIPTOR_HANDLE(
-    descriptorHeap_->GetCPUDescriptorHandleForHeapStart(), handle, descriptorHandleIncrementSize);
-  texture.gpuDescHandleSRV = CD3DX12_GPU_DESCRIPTOR_HANDLE(
-    descriptorHeap_->GetGPUDescriptorHandleForHeapStart(), handle, descriptorHandleIncrementSize);
+  texture.descriptorIndex = descriptorAllocator_.Allocate();
 
   D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{}; // 設定構造体
   D3D12_RESOURCE_DESC resDesc = texture.resource->GetDesc();
@@ -157,14 +590,108 @@ uint32_t TextureManager::LoadInternal(const std::string& fileName) {
   srvDesc.Format = resDesc.Format;
   srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
   srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D; // 2Dテクスチャ
-  srvDesc.Texture2D.MipLevels = (UINT)metadata.mipLevels;
+  srvDesc.Texture2D.MipLevels = textureData.mipLevels;
 
   device_->CreateShaderResourceView(
     texture.resource.Get(), //ビューと関連付けるバッファ
     &srvDesc,               //テクスチャ設定情報
-    texture.cpuDescHandleSRV);
+    descriptorAllocator_.GetCpuHandle(texture.descriptorIndex));
+  descriptorAllocator_.Commit(texture.descriptorIndex);
+}
+
+uint32_t TextureManager::AllocateHandle() {
+  uint32_t index = 0;
+  if (!freeIndices_.empty()) {
+	// 解放済みのスロットを再利用
+	index = freeIndices_.back();
+	freeIndices_.pop_back();
+  } else {
+	// 空きが無ければスロットを追加
+	assert(textures_.size() <= kHandleIndexMask);
+	index = static_cast<uint32_t>(textures_.size());
+	textures_.emplace_back();
+  }
+
+  return MakeHandle(index, textures_[index].generation);
+}
+
+void TextureManager::UnloadInternal(uint32_t textureHandle) {
+  assert(IsValid(textureHandle));
 
-  indexNextDescriptorHeap++;
+  // 既定のテクスチャは代わりのテクスチャとしても使うので解放しない
+  if (textureHandle == kDefaultTextureHandle) {
+	return;
+  }
+
+  // 他の読み込みからも参照されていれば参照数を減らすだけ
+  Texture& texture = textures_[GetIndex(textureHandle)];
+  assert(texture.refCount > 0);
+  texture.refCount--;
+  if (texture.refCount > 0) {
+	return;
+  }
+
+  ReleaseTexture(textureHandle);
+}
+
+void TextureManager::ReleaseTexture(uint32_t textureHandle) {
+  uint32_t index = GetIndex(textureHandle);
+  Texture& texture = textures_[index];
+  texture.refCount = 0;
+
+  // 索引から取り除く（別名で登録したものも含む）
+  for (const std::string& name : texture.names) {
+	nameToHandle_.erase(name);
+  }
+  texture.names.clear();
+  auto itContent = contentHashToHandle_.find(texture.contentHash);
+  if (itContent != contentHashToHandle_.end() && itContent->second == textureHandle) {
+	contentHashToHandle_.erase(itContent);
+  }
+
+  // 読み込みに失敗していたらリソースは無いのですぐにスロットを空ける
+  if (texture.isFailed) {
+	texture.isFailed = false;
+	texture.generation++;
+	freeIndices_.push_back(index);
+	return;
+  }
+
+  // 読み込み中ならスロットは読み込み完了時に空ける
+  if (texture.isLoading) {
+	texture.isLoading = false;
+	texture.generation++;
+	return;
+  }
+
+  // ストリーミングの常駐管理から外す
+  if (texture.isStreaming) {
+	streamer_.Unregister(index);
+	streamingSources_.erase(index);
+	texture.isStreaming = false;
+  }
+
+  // GPUが使い終わるまでリソースとスロットを保持しておく
+  RetiredTexture retired;
+  retired.resource = std::move(texture.resource);
+  retired.index = index;
+  retired.descriptorIndex = texture.descriptorIndex;
+  retired.frame = frameCount_;
+  retired.releasesSlot = true;
+  retiredTextures_.push_back(std::move(retired));
+
+  // 世代を進めて古いハンドルを無効にする
+  texture.generation++;
+  texture.descriptorIndex = DescriptorAllocator::kInvalidIndex;
+  texture.contentHash = 0;
+}
+
+uint32_t TextureManager::AddReference(uint32_t textureHandle) {
+  textures_[GetIndex(textureHandle)].refCount++;
+  return textureHandle;
+}
 
-  return handle;
+void TextureManager::RegisterName(uint32_t textureHandle, const std::string& name) {
+  nameToHandle_.emplace(name, textureHandle);
+  textures_[GetIndex(textureHandle)].names.push_back(name);
 }
@@ -1,18 +1,48 @@
 ﻿#pragma once
 
-#include <array>
+#include "DescriptorAllocator.h"
+#include "TextureData.h"
+#include "TextureStreamer.h"
+#include "TextureUploader.h"
+#include <cstdint>
 #include <d3dx12.h>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <wrl.h>
 
+namespace DirectX {
+class ScratchImage;
+}
+
+class MappedFile;
+class ThreadPool;
+
 /// <summary>
 /// テクスチャマネージャ
+/// テクスチャハンドルは下位16bitがスロット番号、上位16bitが世代番号
+/// 解放したスロットは世代番号を進めて再利用するので、解放済みのハンドルは無効として検出できる
+/// 同じテクスチャを返した読み込みの回数を参照数として数え、同じ回数Unloadしたら解放する
+/// 非同期読み込みではデコードとミップマップ生成をワーカースレッドで行い、
+/// GPUリソースの生成は描画スレッドのフレーム開始処理で行う
+/// シェーダリソースビューは必要に応じて大きくなる1つのデスクリプタヒープに置く
+/// ストリーミング読み込みでは粗いミップだけを常駐させ、描画時に報告された画面上の大きさと
+/// メモリ予算に応じて細かいミップを入れ替える
 /// </summary>
 class TextureManager {
 public:
-  // デスクリプターの数
-  static const size_t kNumDescriptors = 256;
+  // ハンドル内のスロット番号のビット数
+  static const uint32_t kHandleIndexBits = 16;
+  // ハンドル内のスロット番号のマスク
+  static const uint32_t kHandleIndexMask = (1u << kHandleIndexBits) - 1;
+  // 読み込み完了まで代わりに使うテクスチャのファイル名
+  static const char* const kPlaceholderFileName;
+  // 既定のテクスチャ（kPlaceholderFileName）のハンドル（初期化時に読み込み、全テクスチャリセットでも残す）
+  static const uint32_t kDefaultTextureHandle = 0;
+  // ストリーミング読み込みで常に常駐させるミップの大きさの上限（ピクセル）
+  static const uint32_t kStreamingMinSize = 64;
 
   /// <summary>
   /// テクスチャ
@@ -20,12 +50,22 @@ public:
   struct Texture {
 	// テクスチャリソース
 	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
-	// シェーダリソースビューのハンドル(CPU)
-	CD3DX12_CPU_DESCRIPTOR_HANDLE cpuDescHandleSRV;
-	// シェーダリソースビューのハンドル(CPU)
-	CD3DX12_GPU_DESCRIPTOR_HANDLE gpuDescHandleSRV;
-	// 名前
-	std::string name;
+	// シェーダリソースビューのデスクリプタ番号
+	uint32_t descriptorIndex = DescriptorAllocator::kInvalidIndex;
+	// 索引に登録した名前（同じ内容の別名も含む）
+	std::vector<std::string> names;
+	// 参照数（このテクスチャを返した読み込みの回数）
+	uint32_t refCount = 0;
+	// ファイル内容のハッシュ値
+	uint64_t contentHash = 0;
+	// 世代番号（解放するたびに進める）
+	uint16_t generation = 0;
+	// 非同期読み込み中か
+	bool isLoading = false;
+	// 非同期読み込みに失敗したか（解放するまで代わりのテクスチャで描画する）
+	bool isFailed = false;
+	// ミップをストリーミングしているか
+	bool isStreaming = false;
   };
 
   /// <summary>
@@ -35,6 +75,35 @@ public:
   /// <returns>テクスチャハンドル</returns>
   static uint32_t Load(const std::string& fileName);
 
+  /// <summary>
+  /// 非同期読み込み（読み込み完了までは白テクスチャで描画される）
+  /// </summary>
+  /// <param name="fileName">ファイル名</param>
+  /// <returns>テクスチャハンドル</returns>
+  static uint32_t LoadAsync(const std::string& fileName);
+
+  /// <summary>
+  /// ストリーミング読み込み（最初は粗いミップだけを転送し、使われ方に応じて細かいミップを入れ替える）
+  /// </summary>
+  /// <param name="fileName">ファイル名</param>
+  /// <returns>テクスチャハンドル</returns>
+  static uint32_t LoadStreaming(const std::string& fileName);
+
+  /// <summary>
+  /// メモリ上の画像から読み込み（同じ名前が読み込み済みならそれを返す）
+  /// </summary>
+  /// <param name="name">名前</param>
+  /// <param name="image">画像（転送用にコピーするので呼び出し後に破棄してよい）</param>
+  /// <returns>テクスチャハンドル</returns>
+  static uint32_t LoadFromImage(const std::string& name, const DirectX::ScratchImage& image);
+
+  /// <summary>
+  /// 解放（参照数を減らし、0になったらGPUが使い終わってからスロットを再利用する。
+  /// 既定のテクスチャは解放しない）
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  static void Unload(uint32_t textureHandle);
+
   /// <summary>
   /// シングルトンインスタンスの取得
   /// </summary>
@@ -45,18 +114,90 @@ public:
   /// システム初期化
   /// </summary>
   /// <param name="device">デバイス</param>
-  void Initialize(ID3D12Device* device, std::string directoryPath = "Resources/");
+  /// <param name="directoryPath">テクスチャのディレクトリパス</param>
+  /// <param name="uploadBudget">1回の転送でまとめるアップロードバッファのサイズ</param>
+  void Initialize(
+    ID3D12Device* device, std::string directoryPath = "Resources/",
+    size_t uploadBudget = TextureUploader::kDefaultBudget);
 
   /// <summary>
-  /// 全テクスチャリセット
+  /// 全テクスチャリセット（既定のテクスチャ以外を解放し、GPUが使い終わってからスロットを再利用する）
   /// </summary>
   void ResetAll();
-    
+
+  /// <summary>
+  /// フレーム開始処理（GPUが使い終わった解放済みテクスチャの破棄と非同期読み込みの完了処理）
+  /// </summary>
+  void BeginFrame();
+
+  /// <summary>
+  /// 使用状況の報告（ストリーミング読み込みしたテクスチャ以外は何もしない）
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  /// <param name="screenSize">テクスチャ全体が画面上に描かれる大きさ（ピクセル）</param>
+  void ReportUsage(uint32_t textureHandle, float screenSize);
+
+  /// <summary>
+  /// ストリーミングのメモリ予算の設定
+  /// </summary>
+  /// <param name="budget">予算（バイト）</param>
+  void SetStreamingBudget(size_t budget) { streamer_.SetBudget(budget); }
+
+  /// <summary>
+  /// ストリーミングの常駐管理の取得
+  /// </summary>
+  /// <returns>常駐管理</returns>
+  const TextureStreamer& GetStreamer() const { return streamer_; }
+
+  /// <summary>
+  /// 読み込んだテクスチャの転送をコピーキューで実行し、描画キューに完了を待たせる
+  /// </summary>
+  /// <param name="graphicsQueue">描画キュー</param>
+  void SubmitUploads(ID3D12CommandQueue* graphicsQueue);
+
+  /// <summary>
+  /// 全ての非同期読み込みが終わるまで待つ
+  /// </summary>
+  void WaitForAsyncLoads();
+
+  /// <summary>
+  /// テクスチャハンドルが有効か
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  /// <returns>読み込み済みか読み込み中か読み込みに失敗したテクスチャを指していればtrue</returns>
+  bool IsValid(uint32_t textureHandle) const;
+
+  /// <summary>
+  /// 読み込みが完了しているか
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  /// <returns>読み込み済みのテクスチャを指していればtrue</returns>
+  bool IsLoaded(uint32_t textureHandle) const;
+
+  /// <summary>
+  /// 非同期読み込みに失敗したか
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  /// <returns>読み込みに失敗したテクスチャを指していればtrue</returns>
+  bool IsFailed(uint32_t textureHandle) const;
+
+  /// <summary>
+  /// テクスチャのディレクトリパスの取得
+  /// </summary>
+  /// <returns>ディレクトリパス</returns>
+  const std::string& GetDirectoryPath() const { return directoryPath_; }
+
+  /// <summary>
+  /// 読み込み済みのテクスチャ数の取得
+  /// </summary>
+  /// <returns>テクスチャ数</returns>
+  size_t GetLoadedCount() const { return contentHashToHandle_.size(); }
+
   /// <summary>
   /// リソース情報取得
   /// </summary>
   /// <param name="textureHandle">テクスチャハンドル</param>
-  /// <returns>リソース情報</returns>
+  /// <returns>リソース情報（読み込み中と失敗時は代わりのテクスチャの情報）</returns>
   const D3D12_RESOURCE_DESC GetResoureDesc(uint32_t textureHandle);
 
   /// <summary>
@@ -68,28 +209,204 @@ public:
   void SetGraphicsRootDescriptorTable(
     ID3D12GraphicsCommandList* commandList, UINT rootParamIndex, uint32_t textureHandle);
 
+  /// <summary>
+  /// デスクリプタヒープをセット（コマンドリストの記録開始時に1回呼ぶ）
+  /// </summary>
+  /// <param name="commandList">コマンドリスト</param>
+  void SetDescriptorHeaps(ID3D12GraphicsCommandList* commandList);
+
+  /// <summary>
+  /// デスクリプタ番号の取得（シェーダからヒープ全体を配列として参照する場合に使う）
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  /// <returns>デスクリプタ番号（読み込み中と失敗時は代わりのテクスチャの番号）</returns>
+  uint32_t GetDescriptorIndex(uint32_t textureHandle);
+
+  /// <summary>
+  /// デスクリプタヒープ先頭のGPUハンドルの取得（ヒープ全体を1つのテーブルとしてセットする場合に使う）
+  /// </summary>
+  /// <returns>GPUハンドル</returns>
+  D3D12_GPU_DESCRIPTOR_HANDLE GetDescriptorHeapStart() const {
+	return descriptorAllocator_.GetGpuHandle(0);
+  }
+
 private:
-  TextureManager() = default;
-  ~TextureManager() = default;
+  /// <summary>
+  /// GPUが使い終わるのを待っているテクスチャ
+  /// </summary>
+  struct RetiredTexture {
+	// テクスチャリソース
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	// スロット番号
+	uint32_t index;
+	// シェーダリソースビューのデスクリプタ番号
+	uint32_t descriptorIndex;
+	// 解放したフレーム
+	uint64_t frame;
+	// 破棄したらスロットを空けるか（ミップの入れ替えではスロットはそのまま使う）
+	bool releasesSlot;
+  };
+
+  /// <summary>
+  /// 非同期読み込みの結果
+  /// </summary>
+  struct AsyncLoadResult {
+	// テクスチャハンドル
+	uint32_t handle;
+	// ファイル内容のハッシュ値
+	uint64_t contentHash;
+	// マップした焼き込み済みファイル
+	std::unique_ptr<MappedFile> bakedFile;
+	// デコード済みの画像（焼き込み済みファイルが無い場合）
+	std::unique_ptr<DirectX::ScratchImage> image;
+	// テクスチャの中身（bakedFileかimageを参照する）
+	TextureData textureData;
+	// 成否
+	bool succeeded;
+  };
+
+  /// <summary>
+  /// ストリーミングの転送元（全ミップを保持し続ける）
+  /// </summary>
+  struct StreamingSource {
+	// マップした焼き込み済みファイル
+	std::unique_ptr<MappedFile> bakedFile;
+	// デコード済みの画像（焼き込み済みファイルが無い場合）
+	std::unique_ptr<DirectX::ScratchImage> image;
+	// テクスチャの中身（bakedFileかimageを参照する）
+	TextureData textureData;
+  };
+
+  TextureManager();
+  ~TextureManager();
   TextureManager(const TextureManager&) = delete;
   TextureManager& operator=(const TextureManager&) = delete;
 
   // デバイス
   ID3D12Device* device_;
-  // デスクリプタサイズ
-  UINT descriptorHandleIncrementSize = 0u;
   // ディレクトリパス
   std::string directoryPath_;
-  // デスクリプタヒープ
-  Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap_;
-  // 次に使うデスクリプタヒープの番号
-  uint32_t indexNextDescriptorHeap = 0u;
+  // シェーダリソースビューのデスクリプタ
+  DescriptorAllocator descriptorAllocator_;
+  // コマンドリストにセット済みのデスクリプタヒープ（ヒープが作り直されたらセットし直す）
+  ID3D12DescriptorHeap* boundDescriptorHeap_ = nullptr;
+  // テクスチャ転送
+  TextureUploader uploader_;
   // テクスチャコンテナ
-  std::array<Texture, kNumDescriptors> textures_;
+  std::vector<Texture> textures_;
+  // 名前からハンドルへの索引
+  std::unordered_map<std::string, uint32_t> nameToHandle_;
+  // ファイル内容のハッシュ値からハンドルへの索引
+  std::unordered_map<uint64_t, uint32_t> contentHashToHandle_;
+  // 再利用できるスロット番号
+  std::vector<uint32_t> freeIndices_;
+  // GPUが使い終わるのを待っているテクスチャ
+  std::vector<RetiredTexture> retiredTextures_;
+  // フレーム数
+  uint64_t frameCount_ = 0;
+  // ストリーミングの常駐管理
+  TextureStreamer streamer_;
+  // ストリーミングの転送元（スロット番号から引く）
+  std::unordered_map<uint32_t, std::unique_ptr<StreamingSource>> streamingSources_;
+  // 常駐ミップの変更（毎フレーム使い回す）
+  std::vector<TextureStreamer::ResidencyChange> residencyChanges_;
+  // 非同期読み込み結果の排他制御
+  std::mutex asyncResultMutex_;
+  // ワーカースレッドで完了した非同期読み込みの結果
+  std::vector<AsyncLoadResult> asyncResults_;
+  // 非同期読み込み用のワーカースレッド（結果より先に破棄する）
+  std::unique_ptr<ThreadPool> threadPool_;
+
+  /// <summary>
+  /// ハンドルの生成
+  /// </summary>
+  /// <param name="index">スロット番号</param>
+  /// <param name="generation">世代番号</param>
+  /// <returns>テクスチャハンドル</returns>
+  static uint32_t MakeHandle(uint32_t index, uint16_t generation) {
+	return (static_cast<uint32_t>(generation) << kHandleIndexBits) | index;
+  }
+
+  /// <summary>
+  /// ハンドルからスロット番号を取り出す
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  /// <returns>スロット番号</returns>
+  static uint32_t GetIndex(uint32_t textureHandle) { return textureHandle & kHandleIndexMask; }
+
+  /// <summary>
+  /// ハンドルの確保（空きスロットを優先して使う）
+  /// </summary>
+  /// <returns>テクスチャハンドル</returns>
+  uint32_t AllocateHandle();
+
+  /// <summary>
+  /// 参照を増やす
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  /// <returns>テクスチャハンドル</returns>
+  uint32_t AddReference(uint32_t textureHandle);
+
+  /// <summary>
+  /// 名前を索引に登録する
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  /// <param name="name">名前</param>
+  void RegisterName(uint32_t textureHandle, const std::string& name);
+
+  /// <summary>
+  /// 解放（参照数を減らし、0になったら破棄する）
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  void UnloadInternal(uint32_t textureHandle);
+
+  /// <summary>
+  /// 参照数に関わらず破棄する
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  void ReleaseTexture(uint32_t textureHandle);
 
   /// <summary>
   /// 読み込み
   /// </summary>
   /// <param name="fileName">ファイル名</param>
   uint32_t LoadInternal(const std::string& fileName);
+
+  /// <summary>
+  /// 非同期読み込み
+  /// </summary>
+  /// <param name="fileName">ファイル名</param>
+  uint32_t LoadAsyncInternal(const std::string& fileName);
+
+  /// <summary>
+  /// ストリーミング読み込み
+  /// </summary>
+  /// <param name="fileName">ファイル名</param>
+  uint32_t LoadStreamingInternal(const std::string& fileName);
+
+  /// <summary>
+  /// メモリ上の画像から読み込み
+  /// </summary>
+  /// <param name="name">名前</param>
+  /// <param name="image">画像</param>
+  uint32_t LoadFromImageInternal(const std::string& name, const DirectX::ScratchImage& image);
+
+  /// <summary>
+  /// 常駐ミップの変更（指定したミップ以降だけを持つリソースに作り直す）
+  /// </summary>
+  /// <param name="index">スロット番号</param>
+  /// <param name="residentMip">常駐させる最も細かいミップレベル</param>
+  void ApplyResidency(uint32_t index, uint32_t residentMip);
+
+  /// <summary>
+  /// 完了した非同期読み込みのGPUリソースを生成する
+  /// </summary>
+  void FinalizeAsyncLoads();
+
+  /// <summary>
+  /// テクスチャリソースとシェーダリソースビューを生成する
+  /// </summary>
+  /// <param name="textureHandle">テクスチャハンドル</param>
+  /// <param name="textureData">テクスチャの中身</param>
+  void CreateTextureResource(uint32_t textureHandle, const TextureData& textureData);
 };
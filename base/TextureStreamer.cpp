@@ -0,0 +1,156 @@
+﻿#include "TextureStreamer.h"
+#include <algorithm>
+#include <cassert>
+
+TextureStreamer::TextureStreamer(size_t budget) : budget_(budget) {}
+
+void TextureStreamer::Register(
+  uint32_t id, const uint64_t* mipSizes, uint32_t mipLevels, uint32_t minResidentMip) {
+  assert(mipSizes);
+  assert(mipLevels > 0 && mipLevels <= TextureData::kMaxMipLevels);
+  assert(minResidentMip < mipLevels);
+  assert(entries_.count(id) == 0);
+
+  Entry entry;
+  // 粗い方から足し込んで、各ミップレベル以降のサイズを求める
+  uint64_t size = 0;
+  for (uint32_t i = mipLevels; i > 0; i--) {
+	size += mipSizes[i - 1];
+	entry.residentSizes[i - 1] = size;
+  }
+  entry.minResidentMip = minResidentMip;
+  entry.residentMip = minResidentMip;
+  entry.requestedMip = minResidentMip;
+  entry.lastUsedFrame = 0;
+
+  residentSize_ += entry.residentSizes[minResidentMip];
+  entries_.emplace(id, entry);
+}
+
+void TextureStreamer::Unregister(uint32_t id) {
+  auto it = entries_.find(id);
+  assert(it != entries_.end());
+
+  residentSize_ -= it->second.residentSizes[it->second.residentMip];
+  entries_.erase(it);
+}
+
+void TextureStreamer::Reset() {
+  entries_.clear();
+  residentSize_ = 0;
+}
+
+void TextureStreamer::ReportUsage(uint32_t id, uint32_t requestedMip, uint64_t frame) {
+  auto it = entries_.find(id);
+  if (it == entries_.end()) {
+	return;
+  }
+
+  Entry& entry = it->second;
+  if (entry.lastUsedFrame == frame) {
+	entry.requestedMip = (std::min)(entry.requestedMip, requestedMip);
+  } else {
+	entry.requestedMip = requestedMip;
+	entry.lastUsedFrame = frame;
+  }
+}
+
+void TextureStreamer::Update(uint64_t frame, std::vector<ResidencyChange>& changes) {
+  changes.clear();
+
+  // 更新前の常駐ミップ（最後に差分だけを変更として返す）
+  std::unordered_map<uint32_t, uint32_t> previousMips;
+  // 細かいミップを読み込みたいテクスチャ
+  std::vector<uint32_t> loadCandidates;
+  // 追い出せる細かいミップを持つテクスチャ
+  std::vector<uint32_t> evictCandidates;
+
+  for (auto& pair : entries_) {
+	Entry& entry = pair.second;
+	previousMips.emplace(pair.first, entry.residentMip);
+
+	// しばらく使われていなければ最小限まで落とす
+	uint32_t targetMip = entry.minResidentMip;
+	if (frame - entry.lastUsedFrame <= kUsageTimeoutFrames) {
+	  targetMip = (std::min)(entry.requestedMip, entry.minResidentMip);
+	}
+
+	// 要求より細かいミップは先に手放す
+	if (targetMip > entry.residentMip) {
+	  SetResidentMip(entry, targetMip);
+	} else if (targetMip < entry.residentMip) {
+	  loadCandidates.push_back(pair.first);
+	}
+	if (entry.residentMip < entry.minResidentMip) {
+	  evictCandidates.push_back(pair.first);
+	}
+  }
+
+  // 最近使われたものを優先して読み込む
+  std::sort(loadCandidates.begin(), loadCandidates.end(), [this](uint32_t a, uint32_t b) {
+	return entries_.at(a).lastUsedFrame > entries_.at(b).lastUsedFrame;
+  });
+  // 最後に使われたのが古いものから追い出す
+  std::sort(evictCandidates.begin(), evictCandidates.end(), [this](uint32_t a, uint32_t b) {
+	return entries_.at(a).lastUsedFrame < entries_.at(b).lastUsedFrame;
+  });
+
+  for (uint32_t id : loadCandidates) {
+	Entry& entry = entries_.at(id);
+	uint32_t targetMip = (std::min)(entry.requestedMip, entry.minResidentMip);
+
+	// 自分より古いテクスチャから追い出せるサイズ
+	uint64_t evictableSize = 0;
+	for (uint32_t evictId : evictCandidates) {
+	  const Entry& evictEntry = entries_.at(evictId);
+	  if (evictEntry.lastUsedFrame >= entry.lastUsedFrame) {
+		break;
+	  }
+	  evictableSize +=
+	    evictEntry.residentSizes[evictEntry.residentMip] -
+	    evictEntry.residentSizes[evictEntry.minResidentMip];
+	}
+
+	// 予算に収まる最も細かいミップを探す
+	for (uint32_t mip = targetMip; mip < entry.residentMip; mip++) {
+	  uint64_t requiredSize = entry.residentSizes[mip] - entry.residentSizes[entry.residentMip];
+	  if (residentSize_ + requiredSize > budget_ + evictableSize) {
+		continue;
+	  }
+
+	  // 足りない分だけ古いものから追い出す
+	  for (uint32_t evictId : evictCandidates) {
+		if (residentSize_ + requiredSize <= budget_) {
+		  break;
+		}
+		Entry& evictEntry = entries_.at(evictId);
+		if (evictEntry.lastUsedFrame >= entry.lastUsedFrame) {
+		  break;
+		}
+		SetResidentMip(evictEntry, evictEntry.minResidentMip);
+	  }
+
+	  SetResidentMip(entry, mip);
+	  break;
+	}
+  }
+
+  // 変更があったものだけ返す
+  for (const auto& pair : entries_) {
+	if (pair.second.residentMip != previousMips.at(pair.first)) {
+	  changes.push_back({pair.first, pair.second.residentMip});
+	}
+  }
+}
+
+uint32_t TextureStreamer::GetResidentMip(uint32_t id) const {
+  auto it = entries_.find(id);
+  assert(it != entries_.end());
+  return it->second.residentMip;
+}
+
+void TextureStreamer::SetResidentMip(Entry& entry, uint32_t mip) {
+  residentSize_ -= entry.residentSizes[entry.residentMip];
+  residentSize_ += entry.residentSizes[mip];
+  entry.residentMip = mip;
+}
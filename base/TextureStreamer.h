@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include "TextureData.h"
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// テクスチャストリーミングの常駐管理
+/// テクスチャごとに常駐させる最も細かいミップレベルを、画面上の大きさから求めた要求と
+/// メモリ予算から決める。予算を超えるときは最後に使われたのが古いものから細かいミップを追い出す
+/// GPUには触れないので単体で動作確認・計測できる
+/// </summary>
+class TextureStreamer {
+public:
+  // 常駐させるミップの合計サイズの標準の予算
+  static const size_t kDefaultBudget = 256 * 1024 * 1024;
+  // この間使われなかったテクスチャは最小限のミップまで落とす（フレーム）
+  static const uint64_t kUsageTimeoutFrames = 60;
+
+  /// <summary>
+  /// 常駐ミップの変更
+  /// </summary>
+  struct ResidencyChange {
+	// テクスチャの識別番号
+	uint32_t id;
+	// 新しく常駐させる最も細かいミップレベル
+	uint32_t residentMip;
+  };
+
+  /// <summary>
+  /// コンストラクタ
+  /// </summary>
+  /// <param name="budget">予算（バイト）</param>
+  explicit TextureStreamer(size_t budget = kDefaultBudget);
+
+  /// <summary>
+  /// テクスチャの登録（最初は粗いミップだけ常駐している状態にする）
+  /// </summary>
+  /// <param name="id">テクスチャの識別番号</param>
+  /// <param name="mipSizes">ミップレベルごとのサイズ（バイト）</param>
+  /// <param name="mipLevels">ミップレベル数</param>
+  /// <param name="minResidentMip">常に常駐させる最も細かいミップレベル</param>
+  void Register(uint32_t id, const uint64_t* mipSizes, uint32_t mipLevels, uint32_t minResidentMip);
+
+  /// <summary>
+  /// テクスチャの登録解除
+  /// </summary>
+  /// <param name="id">テクスチャの識別番号</param>
+  void Unregister(uint32_t id);
+
+  /// <summary>
+  /// 全テクスチャの登録解除
+  /// </summary>
+  void Reset();
+
+  /// <summary>
+  /// 使用状況の報告（同じフレームに複数回報告されたら最も細かい要求を採用する）
+  /// </summary>
+  /// <param name="id">テクスチャの識別番号</param>
+  /// <param name="requestedMip">描画に必要な最も細かいミップレベル</param>
+  /// <param name="frame">現在のフレーム</param>
+  void ReportUsage(uint32_t id, uint32_t requestedMip, uint64_t frame);
+
+  /// <summary>
+  /// 常駐ミップの更新
+  /// </summary>
+  /// <param name="frame">現在のフレーム</param>
+  /// <param name="changes">常駐ミップを変更するテクスチャの一覧</param>
+  void Update(uint64_t frame, std::vector<ResidencyChange>& changes);
+
+  /// <summary>
+  /// 常駐している最も細かいミップレベルの取得
+  /// </summary>
+  /// <param name="id">テクスチャの識別番号</param>
+  /// <returns>ミップレベル</returns>
+  uint32_t GetResidentMip(uint32_t id) const;
+
+  void SetBudget(size_t budget) { budget_ = budget; }
+  size_t GetBudget() const { return budget_; }
+  uint64_t GetResidentSize() const { return residentSize_; }
+
+private:
+  /// <summary>
+  /// テクスチャごとの常駐情報
+  /// </summary>
+  struct Entry {
+	// そのミップレベル以降を全て常駐させたときのサイズ
+	std::array<uint64_t, TextureData::kMaxMipLevels> residentSizes;
+	// 常に常駐させる最も細かいミップレベル
+	uint32_t minResidentMip;
+	// 常駐している最も細かいミップレベル
+	uint32_t residentMip;
+	// 要求された最も細かいミップレベル
+	uint32_t requestedMip;
+	// 最後に使われたフレーム
+	uint64_t lastUsedFrame;
+  };
+
+  /// <summary>
+  /// 常駐ミップの変更（合計サイズも更新する）
+  /// </summary>
+  /// <param name="entry">常駐情報</param>
+  /// <param name="mip">新しく常駐させる最も細かいミップレベル</param>
+  void SetResidentMip(Entry& entry, uint32_t mip);
+
+  // 予算
+  size_t budget_;
+  // 常駐しているミップの合計サイズ
+  uint64_t residentSize_ = 0;
+  // テクスチャごとの常駐情報
+  std::unordered_map<uint32_t, Entry> entries_;
+};
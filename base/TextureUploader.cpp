@@ -0,0 +1,180 @@
+﻿#include "TextureUploader.h"
+#include "TextureFootprint.h"
+#include <cassert>
+#include <cstring>
+#include <d3dx12.h>
+
+using namespace Microsoft::WRL;
+
+static_assert(
+  TextureFootprint::kRowPitchAlignment == D3D12_TEXTURE_DATA_PITCH_ALIGNMENT &&
+    TextureFootprint::kPlacementAlignment == D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT,
+  "配置のアライメントがD3D12と一致しない");
+
+TextureUploader::~TextureUploader() {
+  if (fenceEvent_ != nullptr) {
+	CloseHandle(fenceEvent_);
+  }
+}
+
+void TextureUploader::Initialize(ID3D12Device* device, size_t budget) {
+  assert(device);
+  assert(budget >= TextureFootprint::kPlacementAlignment);
+
+  HRESULT result = S_FALSE;
+
+  device_ = device;
+  budget_ = budget;
+
+  // コピー専用のコマンドキューを生成
+  D3D12_COMMAND_QUEUE_DESC cmdQueueDesc{};
+  cmdQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+  result = device_->CreateCommandQueue(&cmdQueueDesc, IID_PPV_ARGS(&copyQueue_));
+  assert(SUCCEEDED(result));
+
+  result = device_->CreateCommandAllocator(
+    D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&commandAllocator_));
+  assert(SUCCEEDED(result));
+
+  result = device_->CreateCommandList(
+    0, D3D12_COMMAND_LIST_TYPE_COPY, commandAllocator_.Get(), nullptr,
+    IID_PPV_ARGS(&commandList_));
+  assert(SUCCEEDED(result));
+  // 最初の記録開始でリセットするので閉じておく
+  commandList_->Close();
+
+  // フェンスの生成
+  result = device_->CreateFence(
+    submittedFenceValue_, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence_));
+  assert(SUCCEEDED(result));
+  fenceEvent_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+  assert(fenceEvent_ != nullptr);
+
+  // アップロードバッファは常にマップしておく
+  stagingMap_ = CreateStagingBuffer(budget_, stagingBuffer_);
+  stagingOffset_ = 0;
+  isRecording_ = false;
+}
+
+void TextureUploader::Upload(ID3D12Resource* texture, const TextureData& textureData) {
+  assert(texture);
+
+  TextureFootprint footprint;
+  bool isComputed = TextureFootprint::Compute(
+    textureData.format, textureData.width, textureData.height, textureData.mipLevels,
+    footprint);
+  assert(isComputed);
+
+  // アップロードバッファの残りに収まらなければ、それまでの分を先に転送する
+  const size_t alignment = TextureFootprint::kPlacementAlignment;
+  size_t offset = (stagingOffset_ + alignment - 1) & ~(alignment - 1);
+  if (isRecording_ && offset + footprint.totalSize > budget_) {
+	Execute();
+	offset = 0;
+  }
+  if (!isRecording_) {
+	BeginRecording();
+	offset = 0;
+  }
+
+  // アップロードバッファより大きいテクスチャは専用の一時バッファを使う
+  ID3D12Resource* stagingBuffer = stagingBuffer_.Get();
+  uint8_t* stagingMap = stagingMap_;
+  if (footprint.totalSize > budget_) {
+	oversizedBuffers_.emplace_back();
+	stagingMap =
+	  CreateStagingBuffer(static_cast<size_t>(footprint.totalSize), oversizedBuffers_.back());
+	stagingBuffer = oversizedBuffers_.back().Get();
+	offset = 0;
+  } else {
+	stagingOffset_ = offset + static_cast<size_t>(footprint.totalSize);
+  }
+
+  for (uint32_t i = 0; i < footprint.mipLevels; i++) {
+	const TextureFootprint::Subresource& layout = footprint.subresources[i];
+	const TextureData::Subresource& source = textureData.subresources[i];
+
+	// 1ラインずつ配置アライメントに合わせて並べる
+	uint8_t* dest = stagingMap + offset + layout.offset;
+	const uint8_t* src = static_cast<const uint8_t*>(source.data);
+	for (uint32_t row = 0; row < layout.rowCount; row++) {
+	  memcpy(
+	    dest + static_cast<size_t>(layout.rowPitch) * row, src + source.rowPitch * row,
+	    static_cast<size_t>(layout.rowSize));
+	}
+
+	// テクスチャへのコピー命令
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT placedFootprint{};
+	placedFootprint.Offset = offset + layout.offset;
+	placedFootprint.Footprint.Format = textureData.format;
+	placedFootprint.Footprint.Width = layout.width;
+	placedFootprint.Footprint.Height = layout.height;
+	placedFootprint.Footprint.Depth = 1;
+	placedFootprint.Footprint.RowPitch = layout.rowPitch;
+
+	CD3DX12_TEXTURE_COPY_LOCATION destLocation(texture, i);
+	CD3DX12_TEXTURE_COPY_LOCATION srcLocation(stagingBuffer, placedFootprint);
+	commandList_->CopyTextureRegion(&destLocation, 0, 0, 0, &srcLocation, nullptr);
+  }
+}
+
+void TextureUploader::Submit(ID3D12CommandQueue* graphicsQueue) {
+  assert(graphicsQueue);
+
+  if (isRecording_) {
+	Execute();
+  }
+
+  // 転送が終わるまで描画キューを待たせる（CPUは待たない）
+  if (waitedFenceValue_ < submittedFenceValue_) {
+	graphicsQueue->Wait(fence_.Get(), submittedFenceValue_);
+	waitedFenceValue_ = submittedFenceValue_;
+  }
+}
+
+void TextureUploader::WaitIdle() {
+  if (fence_->GetCompletedValue() < submittedFenceValue_) {
+	fence_->SetEventOnCompletion(submittedFenceValue_, fenceEvent_);
+	WaitForSingleObject(fenceEvent_, INFINITE);
+  }
+  oversizedBuffers_.clear();
+}
+
+void TextureUploader::Execute() {
+  assert(isRecording_);
+
+  commandList_->Close();
+  ID3D12CommandList* cmdLists[] = {commandList_.Get()};
+  copyQueue_->ExecuteCommandLists(1, cmdLists);
+  copyQueue_->Signal(fence_.Get(), ++submittedFenceValue_);
+
+  isRecording_ = false;
+}
+
+void TextureUploader::BeginRecording() {
+  // アップロードバッファとコマンドアロケータを使い回すので前回の転送を待つ
+  WaitIdle();
+
+  commandAllocator_->Reset();
+  commandList_->Reset(commandAllocator_.Get(), nullptr);
+  stagingOffset_ = 0;
+  isRecording_ = true;
+}
+
+uint8_t* TextureUploader::CreateStagingBuffer(size_t size, ComPtr<ID3D12Resource>& buffer) {
+  HRESULT result = S_FALSE;
+
+  CD3DX12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+  CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+  result = device_->CreateCommittedResource(
+    &heapProps, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+    IID_PPV_ARGS(&buffer));
+  assert(SUCCEEDED(result));
+
+  // 書き込み専用なので読み込み範囲は空
+  uint8_t* map = nullptr;
+  CD3DX12_RANGE readRange(0, 0);
+  result = buffer->Map(0, &readRange, reinterpret_cast<void**>(&map));
+  assert(SUCCEEDED(result));
+  return map;
+}
@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include "TextureData.h"
+#include <Windows.h>
+#include <cstdint>
+#include <d3d12.h>
+#include <vector>
+#include <wrl.h>
+
+/// <summary>
+/// テクスチャのアップロード
+/// 画素データをアップロードバッファに並べ、コピーキューでデフォルトヒープのテクスチャへまとめて転送する
+/// 転送の完了は描画キューにGPU側で待たせるので、CPUは転送を待たない
+/// </summary>
+class TextureUploader {
+public:
+  // アップロードバッファの標準サイズ（1回の転送でまとめる量の上限）
+  static const size_t kDefaultBudget = 32 * 1024 * 1024;
+
+  /// <summary>
+  /// デストラクタ
+  /// </summary>
+  ~TextureUploader();
+
+  /// <summary>
+  /// 初期化
+  /// </summary>
+  /// <param name="device">デバイス</param>
+  /// <param name="budget">アップロードバッファのサイズ</param>
+  void Initialize(ID3D12Device* device, size_t budget = kDefaultBudget);
+
+  /// <summary>
+  /// 転送の予約（アップロードバッファが足りなければそれまでの分を先に転送する）
+  /// </summary>
+  /// <param name="texture">転送先のテクスチャ（COMMON状態で生成したもの）</param>
+  /// <param name="textureData">テクスチャの中身</param>
+  void Upload(ID3D12Resource* texture, const TextureData& textureData);
+
+  /// <summary>
+  /// 予約した転送をコピーキューで実行し、描画キューに完了を待たせる
+  /// </summary>
+  /// <param name="graphicsQueue">転送したテクスチャを使う描画キュー</param>
+  void Submit(ID3D12CommandQueue* graphicsQueue);
+
+  /// <summary>
+  /// 提出済みの転送が終わるまで待つ
+  /// </summary>
+  void WaitIdle();
+
+  size_t GetBudget() const { return budget_; }
+
+private:
+  /// <summary>
+  /// 予約した転送をコピーキューで実行する
+  /// </summary>
+  void Execute();
+
+  /// <summary>
+  /// コマンドの記録を始める（前回の転送が終わるまで待ってアップロードバッファを再利用する）
+  /// </summary>
+  void BeginRecording();
+
+  /// <summary>
+  /// アップロードバッファの生成
+  /// </summary>
+  /// <param name="size">サイズ</param>
+  /// <param name="buffer">生成先</param>
+  /// <returns>マップしたアドレス</returns>
+  uint8_t* CreateStagingBuffer(size_t size, Microsoft::WRL::ComPtr<ID3D12Resource>& buffer);
+
+  // デバイス
+  ID3D12Device* device_ = nullptr;
+  // コピーキュー
+  Microsoft::WRL::ComPtr<ID3D12CommandQueue> copyQueue_;
+  // コマンドアロケータ
+  Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator_;
+  // コマンドリスト
+  Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList_;
+  // フェンス
+  Microsoft::WRL::ComPtr<ID3D12Fence> fence_;
+  // フェンス待ち用のイベント
+  HANDLE fenceEvent_ = nullptr;
+  // 最後に提出した転送のフェンス値
+  UINT64 submittedFenceValue_ = 0;
+  // 描画キューに待たせたフェンス値
+  UINT64 waitedFenceValue_ = 0;
+  // アップロードバッファ
+  Microsoft::WRL::ComPtr<ID3D12Resource> stagingBuffer_;
+  // マップしたアップロードバッファ
+  uint8_t* stagingMap_ = nullptr;
+  // アップロードバッファのサイズ
+  size_t budget_ = 0;
+  // アップロードバッファの使用済みサイズ
+  size_t stagingOffset_ = 0;
+  // アップロードバッファに収まらないテクスチャ用の一時バッファ（転送完了まで保持）
+  std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> oversizedBuffers_;
+  // コマンドを記録中か
+  bool isRecording_ = false;
+};
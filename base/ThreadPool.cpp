@@ -0,0 +1,116 @@
+﻿#include "ThreadPool.h"
+#include <Windows.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <objbase.h>
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+  if (threadCount == 0) {
+	// メインスレッドの分を残す
+	uint32_t coreCount = std::thread::hardware_concurrency();
+	threadCount = (std::max)(coreCount, 2u) - 1;
+  }
+
+  for (uint32_t i = 0; i < threadCount; i++) {
+	threads_.emplace_back(&ThreadPool::WorkerMain, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+	std::lock_guard<std::mutex> lock(mutex_);
+	isStopping_ = true;
+  }
+  jobAvailable_.notify_all();
+
+  for (std::thread& thread : threads_) {
+	thread.join();
+  }
+}
+
+void ThreadPool::Enqueue(std::function<void()> job) {
+  assert(job);
+
+  {
+	std::lock_guard<std::mutex> lock(mutex_);
+	jobs_.push_back(std::move(job));
+  }
+  jobAvailable_.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return jobs_.empty() && activeJobCount_ == 0; });
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& body) {
+  assert(body);
+  if (count == 0) {
+	return;
+  }
+
+  // 遅れて始まったワーカーが参照しても良いよう、進み具合は共有で持つ
+  struct State {
+	std::atomic<uint32_t> next{0};
+	std::atomic<uint32_t> completed{0};
+	std::mutex mutex;
+	std::condition_variable finished;
+  };
+  std::shared_ptr<State> state = std::make_shared<State>();
+
+  // 空いている番号を取っては実行する（全て取られた後に始まった場合は何もしない）
+  auto run = [state, count, &body]() {
+	for (uint32_t i = state->next++; i < count; i = state->next++) {
+	  body(i);
+	  if (++state->completed == count) {
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->finished.notify_all();
+	  }
+	}
+  };
+
+  uint32_t helperCount = (std::min)(count - 1, GetThreadCount());
+  for (uint32_t i = 0; i < helperCount; i++) {
+	Enqueue(run);
+  }
+  run();
+
+  // ワーカーが実行中の分が終わるまで待つ
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->finished.wait(lock, [&state, count] { return state->completed == count; });
+}
+
+void ThreadPool::WorkerMain() {
+  // WICなどを使えるようにCOMを初期化
+  HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+  assert(SUCCEEDED(result));
+
+  while (true) {
+	std::function<void()> job;
+	{
+	  std::unique_lock<std::mutex> lock(mutex_);
+	  jobAvailable_.wait(lock, [this] { return isStopping_ || !jobs_.empty(); });
+	  // 残った処理を全て終えてから終了する
+	  if (jobs_.empty()) {
+		break;
+	  }
+	  job = std::move(jobs_.front());
+	  jobs_.pop_front();
+	  activeJobCount_++;
+	}
+
+	job();
+
+	{
+	  std::lock_guard<std::mutex> lock(mutex_);
+	  activeJobCount_--;
+	  if (jobs_.empty() && activeJobCount_ == 0) {
+		idle_.notify_all();
+	  }
+	}
+  }
+
+  CoUninitialize();
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// ワーカースレッドプール
+/// 各ワーカーはCOMを初期化済みなので、WICなどCOMを使う処理もそのまま投入できる
+/// </summary>
+class ThreadPool {
+public:
+  /// <summary>
+  /// コンストラクタ
+  /// </summary>
+  /// <param name="threadCount">ワーカースレッド数（0ならCPUのコア数-1、最低1）</param>
+  explicit ThreadPool(uint32_t threadCount = 0);
+
+  /// <summary>
+  /// デストラクタ（投入済みの処理が終わるのを待ってスレッドを終了する）
+  /// </summary>
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// <summary>
+  /// 処理の投入
+  /// </summary>
+  /// <param name="job">ワーカースレッドで実行する処理</param>
+  void Enqueue(std::function<void()> job);
+
+  /// <summary>
+  /// 投入済みの処理が全て終わるまで待つ
+  /// </summary>
+  void WaitIdle();
+
+  /// <summary>
+  /// 0からcount-1までの処理を並列に実行し、全て終わるまで待つ
+  /// 呼び出したスレッドも処理を受け持つので、ワーカースレッドの中から呼んでも止まらない
+  /// </summary>
+  /// <param name="count">処理の数</param>
+  /// <param name="body">番号を受け取って実行する処理</param>
+  void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& body);
+
+  uint32_t GetThreadCount() const { return static_cast<uint32_t>(threads_.size()); }
+
+private:
+  /// <summary>
+  /// ワーカースレッドの本体
+  /// </summary>
+  void WorkerMain();
+
+  // ワーカースレッド
+  std::vector<std::thread> threads_;
+  // 排他制御
+  std::mutex mutex_;
+  // 処理が投入された通知
+  std::condition_variable jobAvailable_;
+  // 全ての処理が終わった通知
+  std::condition_variable idle_;
+  // 未実行の処理
+  std::deque<std::function<void()>> jobs_;
+  // 実行中の処理の数
+  uint32_t activeJobCount_ = 0;
+  // 終了要求
+  bool isStopping_ = false;
+};
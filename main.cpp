@@ -1,6 +1,10 @@
 ﻿#include "Audio.h"
+#include "ConstBufferPool.h"
 #include "DirectXCommon.h"
 #include "GameScene.h"
+#include "SoundBank.h"
+#include "SpriteBatch.h"
+#include "TextureBaker.h"
 #include "TextureManager.h"
 #include "WinApp.h"
 
@@ -30,20 +34,36 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
   // オーディオの初期化
   audio = Audio::GetInstance();
   audio->Initialize();
+#ifdef _DEBUG
+  // Resources/の全WAVを1つのサウンドバンクにまとめる（WAVが変わっていなければ何もしない）
+  SoundBank::Build("Resources/");
+#endif
+  // サウンドバンクがあれば開く（無いか元のWAVから変わっていれば、LoadWaveが個別のファイルを読む）
+  audio->LoadBank();
+
+  // 定数バッファプールの初期化
+  ConstBufferPool::GetInstance()->Initialize(dxCommon->GetDevice(), DirectXCommon::kFrameCount);
+
+#ifdef _DEBUG
+  // テクスチャをミップマップ付きの圧縮DDSに焼き込む（焼き込み済みのものは飛ばす）
+  TextureBaker::BakeDirectory("Resources/");
+#endif
 
   // テクスチャマネージャの初期化
   TextureManager::GetInstance()->Initialize(dxCommon->GetDevice());
   TextureManager::Load("white1x1.png");
 
   // スプライト静的初期化
-  Sprite::StaticInitialize(dxCommon->GetDevice(), WinApp::kWindowWidth, WinApp::kWindowHeight);
+  Sprite::StaticInitialize(dxCommon, WinApp::kWindowWidth, WinApp::kWindowHeight);
+  // スプライト一括描画静的初期化
+  SpriteBatch::StaticInitialize(dxCommon, WinApp::kWindowWidth, WinApp::kWindowHeight);
 
   // デバッグテキスト初期化
   debugText = new DebugText();
   debugText->Initialize();
 
   // 3Dオブジェクト静的初期化
-  Model::StaticInitialize(dxCommon->GetDevice(), WinApp::kWindowWidth, WinApp::kWindowHeight); 
+  Model::StaticInitialize(dxCommon, WinApp::kWindowWidth, WinApp::kWindowHeight); 
   #pragma endregion
 
   // ゲームシーンの初期化
@@ -59,6 +79,8 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 
 	// 入力関連の毎フレーム処理
 	input->Update();
+	// オーディオの毎フレーム処理
+	audio->Update();
 	// ゲームシーンの毎フレーム処理
 	gameScene->Update();
 
@@ -70,6 +92,9 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	dxCommon->PostDraw();
   }
 
+  // GPUの処理完了を待ってから解放する
+  dxCommon->WaitForGpu();
+
   // 各種解放
   SafeDelete(gameScene);
   SafeDelete(debugText);
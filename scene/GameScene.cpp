@@ -16,8 +16,8 @@ void GameScene::Initialize(
 	audio_ = audio;
 	debugText_ = debugText;
 
-	// ファイル名を指定してテクスチャを読み込む
-	textureHandle_ = TextureManager::Load("player.png");
+	// ファイル名を指定してテクスチャを読み込む（読み込み完了までは白テクスチャで描画される）
+	textureHandle_ = TextureManager::LoadAsync("player.png");
 
 	// 3Dモデルの生成
 	model_ = Model::Create();